@@ -43,6 +43,11 @@ using namespace ns3;
  * range, thereby breaking the topology.  By default, this will result in
  * stopping ping replies reception after sequence number 33. If the step size is reduced
  * to cover the gap, then also the following pings can be received.
+ *
+ * The converged AODV state can be saved once and used to warm-start later runs:
+ *
+ * ./ns3 run "aodv-example --saveState=aodv.state --saveTime=8"
+ * ./ns3 run "aodv-example --restoreState=aodv.state"
  */
 class AodvExample
 {
@@ -75,6 +80,12 @@ class AodvExample
     bool pcap;
     /// Print routes if true
     bool printRoutes;
+    /// File to save the AODV state to, none if empty
+    std::string saveState;
+    /// Time to save the AODV state at, seconds
+    double saveTime;
+    /// File to restore the AODV state from, none if empty
+    std::string restoreState;
 
     // network
     /// nodes used in the example
@@ -115,7 +126,8 @@ AodvExample::AodvExample()
       step(50),
       totalTime(100),
       pcap(true),
-      printRoutes(true)
+      printRoutes(true),
+      saveTime(8)
 {
 }
 
@@ -133,6 +145,9 @@ AodvExample::Configure(int argc, char** argv)
     cmd.AddValue("size", "Number of nodes.", size);
     cmd.AddValue("time", "Simulation time, s.", totalTime);
     cmd.AddValue("step", "Grid step, m", step);
+    cmd.AddValue("saveState", "Save the AODV state to this file.", saveState);
+    cmd.AddValue("saveTime", "Time to save the AODV state at, s.", saveTime);
+    cmd.AddValue("restoreState", "Restore the AODV state from this file.", restoreState);
 
     cmd.Parse(argc, argv);
     return true;
@@ -231,6 +246,16 @@ AodvExample::InstallInternetStack()
             Create<OutputStreamWrapper>("aodv.routes", std::ios::out);
         Ipv4RoutingHelper::PrintRoutingTableAllAt(Seconds(8), routingStream);
     }
+
+    if (!saveState.empty())
+    {
+        AodvHelper::SaveRoutingStateAt(Seconds(saveTime), nodes, saveState);
+    }
+    if (!restoreState.empty())
+    {
+        std::cout << "Restored AODV state of "
+                  << AodvHelper::RestoreRoutingState(nodes, restoreState) << " nodes.\n";
+    }
 }
 
 void
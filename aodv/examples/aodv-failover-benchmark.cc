@@ -0,0 +1,270 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Route repair with and without multipath failover under high mobility.
+ */
+
+#include "ns3/aodv-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/yans-wifi-helper.h"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+using namespace ns3;
+
+/// What the benchmark counts during a run
+struct FailoverStats
+{
+    Time outageThreshold;            //!< Delivery gap counted as a route repair
+    std::map<uint64_t, Time> lastRx; //!< Time of the last packet delivered, per flow
+    uint64_t delivered;              //!< Data packets delivered
+    uint64_t outages;                //!< Delivery gaps longer than outageThreshold
+    Time outageTime;                 //!< Total length of these gaps
+    uint64_t control;                //!< AODV packets sent
+    uint64_t requests;               //!< RREQs sent, originated or forwarded
+    uint64_t errors;                 //!< RERRs sent
+};
+
+/**
+ * Count an AODV packet sent by a node
+ * @param stats the counters
+ * @param header the IP header of the packet
+ * @param packet the packet, without its IP header
+ * @param interface the sending interface
+ */
+static void
+CountControl(FailoverStats* stats,
+             const Ipv4Header& header,
+             Ptr<const Packet> packet,
+             uint32_t interface)
+{
+    if (header.GetProtocol() != UdpL4Protocol::PROT_NUMBER)
+    {
+        return;
+    }
+    Ptr<Packet> copy = packet->Copy();
+    UdpHeader udp;
+    copy->RemoveHeader(udp);
+    if (udp.GetDestinationPort() != aodv::RoutingProtocol::AODV_PORT)
+    {
+        return;
+    }
+    aodv::TypeHeader type;
+    copy->RemoveHeader(type);
+    ++stats->control;
+    stats->requests += type.IsValid() && type.Get() == aodv::AODVTYPE_RREQ;
+    stats->errors += type.IsValid() && type.Get() == aodv::AODVTYPE_RERR;
+}
+
+/**
+ * Count a data packet delivered to a node, and the gap since the previous
+ * packet of its flow if it is long enough to be a route repair
+ * @param stats the counters
+ * @param header the IP header of the packet
+ * @param packet the packet, without its IP header
+ * @param interface the receiving interface
+ */
+static void
+CountDelivery(FailoverStats* stats,
+              const Ipv4Header& header,
+              Ptr<const Packet> packet,
+              uint32_t interface)
+{
+    if (header.GetProtocol() != UdpL4Protocol::PROT_NUMBER)
+    {
+        return;
+    }
+    Ptr<Packet> copy = packet->Copy();
+    UdpHeader udp;
+    copy->RemoveHeader(udp);
+    if (udp.GetDestinationPort() == aodv::RoutingProtocol::AODV_PORT)
+    {
+        return;
+    }
+    uint64_t flow = (static_cast<uint64_t>(header.GetSource().Get()) << 16) |
+                    udp.GetDestinationPort();
+    ++stats->delivered;
+    auto it = stats->lastRx.find(flow);
+    if (it != stats->lastRx.end())
+    {
+        Time gap = Simulator::Now() - it->second;
+        if (gap > stats->outageThreshold)
+        {
+            ++stats->outages;
+            stats->outageTime += gap;
+        }
+    }
+    stats->lastRx[flow] = Simulator::Now();
+}
+
+/**
+ * @ingroup aodv-examples
+ * @ingroup examples
+ * @brief Multipath failover benchmark.
+ *
+ * Places the nodes as the high-mobility research scenario does, at random in
+ * a 500 m square, moving with RandomWalk2d at 5-15 m/s, and runs AODV with
+ * multipath routes enabled, first without and then with the
+ * MultipathFailover attribute. Constant bit rate UDP flows run between
+ * random pairs of nodes. For each setting the benchmark reports, averaged
+ * over the runs:
+ * - the delivery ratio of the data packets;
+ * - the route repairs, taken as the gaps in the delivery of a flow longer
+ *   than --outage, and their mean length, which includes the time to detect
+ *   the link break;
+ * - the AODV control overhead: all AODV packets sent, and the RREQs and RERRs
+ *   among them.
+ *
+ * ./ns3 run "aodv-failover-benchmark --nodes=50 --flows=10 --time=100 --runs=3"
+ *
+ * @param argc is the command line argument count
+ * @param argv is the command line arguments
+ * @return 0 on success
+ */
+int
+main(int argc, char** argv)
+{
+    uint32_t nodeCount = 50;
+    uint32_t flowCount = 10;
+    double range = 100;
+    double totalTime = 100;
+    double interval = 0.1;
+    double outage = 0.5;
+    uint32_t packetSize = 512;
+    uint32_t runs = 3;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("nodes", "Number of nodes.", nodeCount);
+    cmd.AddValue("flows", "Number of UDP flows.", flowCount);
+    cmd.AddValue("range", "Radio range, meters.", range);
+    cmd.AddValue("time", "Simulation time, s.", totalTime);
+    cmd.AddValue("interval", "Interval between the packets of a flow, s.", interval);
+    cmd.AddValue("outage", "Shortest delivery gap counted as a route repair, s.", outage);
+    cmd.AddValue("packetSize", "UDP payload size, bytes.", packetSize);
+    cmd.AddValue("runs", "Number of runs per setting, with different random streams.", runs);
+    cmd.Parse(argc, argv);
+
+    const double start = 10;
+
+    std::cout << std::left << std::setw(10) << "failover" << std::right << std::setw(10)
+              << "PDR(%)" << std::setw(10) << "repairs" << std::setw(12) << "repair(ms)"
+              << std::setw(10) << "control" << std::setw(10) << "RREQ" << std::setw(10)
+              << "RERR" << "\n";
+    for (bool failover : {false, true})
+    {
+        double sent = 0;
+        FailoverStats total = {Seconds(outage), {}, 0, 0, Time(), 0, 0, 0};
+        for (uint32_t run = 1; run <= runs; ++run)
+        {
+            RngSeedManager::SetRun(run);
+
+            NodeContainer nodes;
+            nodes.Create(nodeCount);
+            MobilityHelper mobility;
+            mobility.SetPositionAllocator(
+                "ns3::RandomRectanglePositionAllocator",
+                "X",
+                StringValue("ns3::UniformRandomVariable[Min=0.0|Max=500.0]"),
+                "Y",
+                StringValue("ns3::UniformRandomVariable[Min=0.0|Max=500.0]"));
+            mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+                                      "Bounds",
+                                      RectangleValue(Rectangle(0, 500, 0, 500)),
+                                      "Distance",
+                                      DoubleValue(150.0),
+                                      "Speed",
+                                      StringValue("ns3::UniformRandomVariable[Min=5.0|Max=15.0]"));
+            mobility.Install(nodes);
+
+            WifiMacHelper wifiMac;
+            wifiMac.SetType("ns3::AdhocWifiMac");
+            YansWifiChannelHelper wifiChannel;
+            wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+            wifiChannel.AddPropagationLoss("ns3::RangePropagationLossModel",
+                                           "MaxRange",
+                                           DoubleValue(range));
+            YansWifiPhyHelper wifiPhy;
+            wifiPhy.SetChannel(wifiChannel.Create());
+            WifiHelper wifi;
+            wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                         "DataMode",
+                                         StringValue("OfdmRate6Mbps"),
+                                         "RtsCtsThreshold",
+                                         UintegerValue(0));
+            NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, nodes);
+
+            AodvHelper aodv;
+            aodv.Set("MultipathFailover", BooleanValue(failover));
+            InternetStackHelper stack;
+            stack.SetRoutingHelper(aodv);
+            stack.Install(nodes);
+            Ipv4AddressHelper address;
+            address.SetBase("10.0.0.0", "255.0.0.0");
+            Ipv4InterfaceContainer interfaces = address.Assign(devices);
+
+            FailoverStats stats = {Seconds(outage), {}, 0, 0, Time(), 0, 0, 0};
+            for (uint32_t i = 0; i < nodeCount; ++i)
+            {
+                Ptr<aodv::RoutingProtocol> routing = DynamicCast<aodv::RoutingProtocol>(
+                    nodes.Get(i)->GetObject<Ipv4>()->GetRoutingProtocol());
+                routing->SetMultipathEnabled(true);
+                Ptr<Ipv4L3Protocol> ipv4 = nodes.Get(i)->GetObject<Ipv4L3Protocol>();
+                ipv4->TraceConnectWithoutContext("SendOutgoing",
+                                                 MakeBoundCallback(&CountControl, &stats));
+                ipv4->TraceConnectWithoutContext("LocalDeliver",
+                                                 MakeBoundCallback(&CountDelivery, &stats));
+            }
+
+            // Flows between random distinct pairs of nodes
+            Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable>();
+            std::vector<Ptr<UdpClient>> clients;
+            for (uint32_t f = 0; f < flowCount && nodeCount > 1; ++f)
+            {
+                uint32_t src = pick->GetInteger(0, nodeCount - 1);
+                uint32_t dst = (src + pick->GetInteger(1, nodeCount - 1)) % nodeCount;
+                UdpServerHelper server(9 + f);
+                ApplicationContainer serverApp = server.Install(nodes.Get(dst));
+                serverApp.Start(Seconds(0));
+
+                UdpClientHelper client(interfaces.GetAddress(dst), 9 + f);
+                client.SetAttribute("MaxPackets", UintegerValue(0xffffffff));
+                client.SetAttribute("Interval", TimeValue(Seconds(interval)));
+                client.SetAttribute("PacketSize", UintegerValue(packetSize));
+                ApplicationContainer clientApp = client.Install(nodes.Get(src));
+                clients.push_back(DynamicCast<UdpClient>(clientApp.Get(0)));
+                clientApp.Start(Seconds(start + 0.1 * f));
+                clientApp.Stop(Seconds(totalTime - 1));
+            }
+
+            Simulator::Stop(Seconds(totalTime));
+            Simulator::Run();
+            for (const auto& client : clients)
+            {
+                sent += client->GetTotalTx() / packetSize;
+            }
+            total.delivered += stats.delivered;
+            total.outages += stats.outages;
+            total.outageTime += stats.outageTime;
+            total.control += stats.control;
+            total.requests += stats.requests;
+            total.errors += stats.errors;
+            Simulator::Destroy();
+        }
+        double repair =
+            total.outages > 0 ? total.outageTime.GetMilliSeconds() / double(total.outages) : 0;
+        std::cout << std::left << std::setw(10) << (failover ? "on" : "off") << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(10)
+                  << (sent > 0 ? 100 * total.delivered / sent : 0) << std::setprecision(0)
+                  << std::setw(10) << double(total.outages) / runs << std::setw(12) << repair
+                  << std::setw(10) << double(total.control) / runs << std::setw(10)
+                  << double(total.requests) / runs << std::setw(10)
+                  << double(total.errors) / runs << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Throughput and reordering of single path and multipath AODV forwarding.
+ */
+
+#include "ns3/aodv-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/yans-wifi-helper.h"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+using namespace ns3;
+
+/// Packets delivered to the benchmark flows and how many of them came out of order
+struct Reordering
+{
+    uint16_t firstPort;                   //!< Port of the first flow
+    uint16_t lastPort;                    //!< Port of the last flow
+    std::map<uint64_t, uint32_t> highest; //!< Highest sequence number seen, per flow
+    uint64_t delivered;                   //!< Data packets delivered
+    uint64_t reordered;                   //!< Data packets delivered after a later one
+};
+
+/**
+ * Count a packet delivered to a node as reordered if a packet sent after it
+ * in the same flow arrived first. UDP packets are numbered by UdpClient, TCP
+ * segments by their sequence number; packets of other ports are ignored.
+ * @param stats the counters
+ * @param header the IP header of the packet
+ * @param packet the packet, without its IP header
+ * @param interface the receiving interface
+ */
+static void
+CountReordering(Reordering* stats,
+                const Ipv4Header& header,
+                Ptr<const Packet> packet,
+                uint32_t interface)
+{
+    Ptr<Packet> copy = packet->Copy();
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint32_t seq;
+    if (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
+    {
+        UdpHeader udp;
+        copy->RemoveHeader(udp);
+        srcPort = udp.GetSourcePort();
+        dstPort = udp.GetDestinationPort();
+        if (dstPort < stats->firstPort || dstPort > stats->lastPort)
+        {
+            return;
+        }
+        SeqTsHeader seqTs;
+        copy->RemoveHeader(seqTs);
+        seq = seqTs.GetSeq();
+    }
+    else if (header.GetProtocol() == TcpL4Protocol::PROT_NUMBER)
+    {
+        TcpHeader tcp;
+        copy->RemoveHeader(tcp);
+        srcPort = tcp.GetSourcePort();
+        dstPort = tcp.GetDestinationPort();
+        if (dstPort < stats->firstPort || dstPort > stats->lastPort || copy->GetSize() == 0)
+        {
+            return;
+        }
+        seq = tcp.GetSequenceNumber().GetValue();
+    }
+    else
+    {
+        return;
+    }
+    uint64_t flow = (static_cast<uint64_t>(header.GetSource().Get()) << 32) |
+                    (static_cast<uint32_t>(srcPort) << 16) | dstPort;
+    ++stats->delivered;
+    auto it = stats->highest.find(flow);
+    if (it == stats->highest.end())
+    {
+        stats->highest[flow] = seq;
+    }
+    else if (seq < it->second)
+    {
+        ++stats->reordered;
+    }
+    else
+    {
+        it->second = seq;
+    }
+}
+
+/**
+ * @ingroup aodv-examples
+ * @ingroup examples
+ * @brief Multipath forwarding throughput and reordering benchmark.
+ *
+ * Places the nodes as the high-density research scenario does, on a grid five
+ * nodes wide with 25 m spacing, and runs AODV with multipath routes enabled
+ * under each MultipathForwarding mode in turn. Constant bit rate UDP flows, or
+ * with --workload=tcp BulkSend TCP flows, cross the grid between opposite
+ * corners and edges. The radio range is
+ * limited by a RangePropagationLossModel; it defaults to 40 m, so that the
+ * flows take several hops and have alternative next hops (with the 200 m of
+ * the research scenario the whole grid is a single hop). For each mode the
+ * benchmark reports the packets sent and received, the delivery ratio (UDP
+ * only), the delivered throughput (the goodput, for TCP) and the share of data
+ * packets delivered after a packet sent later in the same flow, summed over the
+ * flows and averaged over the runs:
+ *
+ * ./ns3 run "aodv-multipath-benchmark --nodes=25 --flows=4 --time=30 --runs=3"
+ * ./ns3 run "aodv-multipath-benchmark --workload=tcp"
+ *
+ * @param argc is the command line argument count
+ * @param argv is the command line arguments
+ * @return 0 on success
+ */
+int
+main(int argc, char** argv)
+{
+    uint32_t nodeCount = 25;
+    uint32_t flowCount = 4;
+    double range = 40;
+    double totalTime = 30;
+    double interval = 0.02;
+    uint32_t packetSize = 512;
+    uint32_t runs = 3;
+    std::string workload = "udp";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("nodes", "Number of nodes.", nodeCount);
+    cmd.AddValue("flows", "Number of flows.", flowCount);
+    cmd.AddValue("range", "Radio range, meters.", range);
+    cmd.AddValue("time", "Simulation time, s.", totalTime);
+    cmd.AddValue("interval", "Interval between the packets of a flow, s.", interval);
+    cmd.AddValue("packetSize", "UDP payload or TCP send size, bytes.", packetSize);
+    cmd.AddValue("runs", "Number of runs per mode, with different random streams.", runs);
+    cmd.AddValue("workload", "Flows to run: udp (constant bit rate) or tcp (BulkSend).", workload);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(workload != "udp" && workload != "tcp", "Unknown workload " << workload);
+    bool tcp = workload == "tcp";
+
+    const std::pair<aodv::MultipathSelection, const char*> modes[] = {
+        {aodv::SINGLE_PATH, "SinglePath"},
+        {aodv::WEIGHTED_ROUND_ROBIN, "WeightedRoundRobin"},
+        {aodv::FLOW_HASH, "FlowHash"},
+        {aodv::FLOW_PINNED, "FlowPinned"},
+    };
+    const double start = 5;
+
+    std::cout << std::left << std::setw(20) << "mode" << std::right << std::setw(10) << "sent"
+              << std::setw(10) << "received" << std::setw(10) << "PDR(%)" << std::setw(16)
+              << (tcp ? "goodput(kbps)" : "throughput(kbps)") << std::setw(14) << "reordered(%)"
+              << "\n";
+    for (const auto& mode : modes)
+    {
+        double sent = 0;
+        double received = 0;
+        double bytes = 0;
+        double reordered = 0;
+        for (uint32_t run = 1; run <= runs; ++run)
+        {
+            RngSeedManager::SetRun(run);
+
+            NodeContainer nodes;
+            nodes.Create(nodeCount);
+            MobilityHelper mobility;
+            mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                          "MinX",
+                                          DoubleValue(0.0),
+                                          "MinY",
+                                          DoubleValue(0.0),
+                                          "DeltaX",
+                                          DoubleValue(25.0),
+                                          "DeltaY",
+                                          DoubleValue(25.0),
+                                          "GridWidth",
+                                          UintegerValue(5),
+                                          "LayoutType",
+                                          StringValue("RowFirst"));
+            mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+            mobility.Install(nodes);
+
+            WifiMacHelper wifiMac;
+            wifiMac.SetType("ns3::AdhocWifiMac");
+            YansWifiChannelHelper wifiChannel;
+            wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+            wifiChannel.AddPropagationLoss("ns3::RangePropagationLossModel",
+                                           "MaxRange",
+                                           DoubleValue(range));
+            YansWifiPhyHelper wifiPhy;
+            wifiPhy.SetChannel(wifiChannel.Create());
+            WifiHelper wifi;
+            wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                         "DataMode",
+                                         StringValue("OfdmRate6Mbps"),
+                                         "RtsCtsThreshold",
+                                         UintegerValue(0));
+            NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, nodes);
+
+            AodvHelper aodv;
+            aodv.Set("MultipathForwarding", EnumValue(mode.first));
+            InternetStackHelper stack;
+            stack.SetRoutingHelper(aodv);
+            stack.Install(nodes);
+            Ipv4AddressHelper address;
+            address.SetBase("10.0.0.0", "255.0.0.0");
+            Ipv4InterfaceContainer interfaces = address.Assign(devices);
+            for (uint32_t i = 0; i < nodeCount; ++i)
+            {
+                Ptr<aodv::RoutingProtocol> routing = DynamicCast<aodv::RoutingProtocol>(
+                    nodes.Get(i)->GetObject<Ipv4>()->GetRoutingProtocol());
+                routing->SetMultipathEnabled(true);
+            }
+
+            // Flow f runs from node f to the node mirrored through the grid centre
+            std::vector<Ptr<UdpServer>> servers;
+            std::vector<Ptr<UdpClient>> clients;
+            std::vector<Ptr<PacketSink>> sinks;
+            Reordering reordering = {9, static_cast<uint16_t>(9 + flowCount - 1), {}, 0, 0};
+            for (uint32_t f = 0; f < flowCount && f < nodeCount / 2; ++f)
+            {
+                uint32_t dst = nodeCount - 1 - f;
+                nodes.Get(dst)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+                    "LocalDeliver",
+                    MakeBoundCallback(&CountReordering, &reordering));
+                if (tcp)
+                {
+                    PacketSinkHelper sink("ns3::TcpSocketFactory",
+                                          InetSocketAddress(Ipv4Address::GetAny(), 9 + f));
+                    ApplicationContainer sinkApp = sink.Install(nodes.Get(dst));
+                    sinkApp.Start(Seconds(0));
+                    sinks.push_back(DynamicCast<PacketSink>(sinkApp.Get(0)));
+
+                    BulkSendHelper source("ns3::TcpSocketFactory",
+                                          InetSocketAddress(interfaces.GetAddress(dst), 9 + f));
+                    source.SetAttribute("MaxBytes", UintegerValue(0));
+                    source.SetAttribute("SendSize", UintegerValue(packetSize));
+                    ApplicationContainer sourceApp = source.Install(nodes.Get(f));
+                    sourceApp.Start(Seconds(start + 0.1 * f));
+                    sourceApp.Stop(Seconds(totalTime - 1));
+                    continue;
+                }
+                UdpServerHelper server(9 + f);
+                ApplicationContainer serverApp = server.Install(nodes.Get(dst));
+                serverApp.Start(Seconds(0));
+                servers.push_back(DynamicCast<UdpServer>(serverApp.Get(0)));
+
+                UdpClientHelper client(interfaces.GetAddress(dst), 9 + f);
+                client.SetAttribute("MaxPackets", UintegerValue(0xffffffff));
+                client.SetAttribute("Interval", TimeValue(Seconds(interval)));
+                client.SetAttribute("PacketSize", UintegerValue(packetSize));
+                ApplicationContainer clientApp = client.Install(nodes.Get(f));
+                clients.push_back(DynamicCast<UdpClient>(clientApp.Get(0)));
+                clientApp.Start(Seconds(start + 0.1 * f));
+                clientApp.Stop(Seconds(totalTime - 1));
+            }
+
+            Simulator::Stop(Seconds(totalTime));
+            Simulator::Run();
+            for (const auto& server : servers)
+            {
+                received += server->GetReceived();
+            }
+            for (const auto& client : clients)
+            {
+                sent += client->GetTotalTx() / packetSize;
+            }
+            for (const auto& sink : sinks)
+            {
+                bytes += sink->GetTotalRx();
+            }
+            if (reordering.delivered > 0)
+            {
+                reordered += 100.0 * reordering.reordered / reordering.delivered;
+            }
+            Simulator::Destroy();
+        }
+        sent /= runs;
+        received /= runs;
+        bytes /= runs;
+        reordered /= runs;
+        if (!tcp)
+        {
+            bytes = received * packetSize;
+        }
+        double throughput = bytes * 8 / (totalTime - 1 - start) / 1000;
+        std::cout << std::left << std::setw(20) << mode.second << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(10) << sent << std::setw(10) << received
+                  << std::setprecision(1) << std::setw(10)
+                  << (sent > 0 ? 100 * received / sent : 0) << std::setw(16) << throughput
+                  << std::setprecision(2) << std::setw(14) << reordered << "\n";
+    }
+    return 0;
+}
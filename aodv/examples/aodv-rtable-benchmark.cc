@@ -0,0 +1,675 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Micro-benchmarks for the AODV routing table data structures.
+ */
+
+#include "ns3/aodv-address-map.h"
+#include "ns3/aodv-rtable.h"
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace ns3;
+using namespace ns3::aodv;
+
+/**
+ * @ingroup aodv-examples
+ * @ingroup examples
+ * @brief Routing table container micro-benchmark.
+ *
+ * Compares the hash table now backing aodv::RoutingTable with the std::map
+ * it replaced. For each table size the destinations are consecutive hosts of
+ * 10.0.0.0/8, as in a large ad hoc subnet. The benchmark reports the mean time
+ * per insert, per lookup (hits and misses interleaved) and per erase, in
+ * nanoseconds:
+ *
+ * ./ns3 run "aodv-rtable-benchmark --sizes=100,1000,10000 --lookups=1000000"
+ *
+ * The churn benchmark then measures link-break handling under high mobility.
+ * Nodes move with RandomWalk2d at 5-15 m/s, as in the high-mobility research
+ * scenario, over an area sized for the requested mean node degree. Node 0 keeps
+ * a route to every other node through the neighbor closest to it. Whenever a
+ * neighbor moves out of range, the destinations routed through it are looked up
+ * with RoutingTable::GetListOfDestinationWithNextHop, which uses the next hop
+ * index, and with a scan of the whole table as before the index existed. The
+ * affected routes are then moved to a new next hop with RoutingTable::Update,
+ * which also maintains the lifetime queue and the index:
+ *
+ * ./ns3 run "aodv-rtable-benchmark --churnNodes=100,1000,10000 --churnTime=60"
+ *
+ * The grid benchmark finally measures the memory held by the routing tables of
+ * every node of a square grid, in the default layout and in the compact one
+ * (RoutingProtocol attribute CompactRoutingTable). Each node keeps a route to
+ * gridRoutes destinations spread over the grid, through its neighbor towards
+ * the destination. The growth of the resident set while the tables are built
+ * is reported per network and per route, along with the peak resident set.
+ * Each layout is built in a child process of its own:
+ *
+ * ./ns3 run "aodv-rtable-benchmark --gridNodes=1000,5000,10000 --gridRoutes=100"
+ *
+ * The scoring benchmark last rescores the multipath paths of a node, four per
+ * destination, after a change of the weights of the composite score. The
+ * metrics of the paths are kept in a PathScoreBatch, as in the routing table.
+ * It compares scoring each path on its own with the scalar code, as
+ * MultipathRouteEntry::SetWeights() does, with scoring all of them in one SIMD
+ * pass and handing the scores back to the entries, as
+ * RoutingTable::SetMultipathWeights() does. The time of the SIMD pass alone is
+ * reported too. All times are per path:
+ *
+ * ./ns3 run "aodv-rtable-benchmark --scorePaths=1000,10000 --scoreRounds=100"
+ */
+class RtableBenchmark
+{
+  public:
+    RtableBenchmark();
+    /**
+     * @brief Configure script parameters
+     * @param argc is the command line argument count
+     * @param argv is the command line arguments
+     * @return true on successful configuration
+     */
+    bool Configure(int argc, char** argv);
+    /// Run all benchmarks
+    void Run();
+    /// Run the link-break churn benchmark
+    void RunChurn();
+    /// Run the grid memory benchmark
+    void RunGrid();
+    /// Run the path scoring benchmark
+    void RunScoring();
+
+  private:
+    /// Mean cost of each operation, nanoseconds
+    struct Result
+    {
+        double insert;     ///< per insertion
+        double lookup;     ///< per lookup
+        double erase;      ///< per erasure
+        uint64_t checksum; ///< defeats dead code elimination
+    };
+
+    /**
+     * Benchmark one container type
+     * @param size number of routes
+     * @return the measured costs
+     */
+    template <typename Table>
+    Result Measure(uint32_t size);
+
+    /// Results of the churn benchmark, times in nanoseconds
+    struct ChurnResult
+    {
+        uint64_t breaks;  ///< number of link breaks
+        uint64_t updates; ///< number of rerouted entries
+        double scan;      ///< per break, full table scan
+        double index;     ///< per break, next hop index
+        double update;    ///< per rerouted entry
+    };
+
+    /**
+     * Run the churn benchmark on one network size
+     * @param nodes number of nodes
+     * @return the measured costs
+     */
+    ChurnResult Churn(uint32_t nodes);
+
+    /**
+     * Fill the routing tables of a grid network
+     * @param nodes number of nodes
+     * @param compact whether the tables use the compact layout
+     * @return the growth of the resident set, bytes
+     */
+    uint64_t Grid(uint32_t nodes, bool compact);
+
+    /// Results of the scoring benchmark, nanoseconds per path
+    struct ScoreResult
+    {
+        double scalar;     ///< scoring each path on its own
+        double batch;      ///< scoring the batch and applying the scores
+        double kernel;     ///< scoring the batch
+    };
+
+    /**
+     * Run the scoring benchmark on one number of paths
+     * @param paths number of paths
+     * @return the measured costs
+     */
+    ScoreResult Score(uint32_t paths);
+
+    /// @return the resident set of the process, bytes, or 0 if unknown
+    static uint64_t GetResident();
+
+    /// Comma separated table sizes
+    std::string m_sizes;
+    /// Number of lookups per table size
+    uint32_t m_lookups;
+    /// Comma separated network sizes of the churn benchmark
+    std::string m_churnNodes;
+    /// Simulated time of the churn benchmark, seconds
+    double m_churnTime;
+    /// Mean node degree of the churn benchmark
+    double m_degree;
+    /// Radio range of the churn benchmark, meters
+    double m_range;
+    /// Comma separated network sizes of the grid benchmark
+    std::string m_gridNodes;
+    /// Routes per node in the grid benchmark
+    uint32_t m_gridRoutes;
+    /// Comma separated path counts of the scoring benchmark
+    std::string m_scorePaths;
+    /// Rescorings per path count
+    uint32_t m_scoreRounds;
+};
+
+RtableBenchmark::RtableBenchmark()
+    : m_sizes("100,1000,10000"),
+      m_lookups(1000000),
+      m_churnNodes("100,1000"),
+      m_churnTime(60),
+      m_degree(10),
+      m_range(200),
+      m_gridNodes("1000,5000,10000"),
+      m_gridRoutes(100),
+      m_scorePaths("1000,10000"),
+      m_scoreRounds(100)
+{
+}
+
+bool
+RtableBenchmark::Configure(int argc, char** argv)
+{
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("sizes", "Comma separated list of routing table sizes.", m_sizes);
+    cmd.AddValue("lookups", "Number of lookups per table size.", m_lookups);
+    cmd.AddValue("churnNodes", "Comma separated list of churn network sizes.", m_churnNodes);
+    cmd.AddValue("churnTime", "Simulated time of each churn run, s.", m_churnTime);
+    cmd.AddValue("degree", "Mean number of neighbors in the churn runs.", m_degree);
+    cmd.AddValue("range", "Radio range in the churn runs, m.", m_range);
+    cmd.AddValue("gridNodes", "Comma separated list of grid network sizes.", m_gridNodes);
+    cmd.AddValue("gridRoutes", "Number of routes per node in the grid runs.", m_gridRoutes);
+    cmd.AddValue("scorePaths", "Comma separated list of multipath path counts.", m_scorePaths);
+    cmd.AddValue("scoreRounds", "Number of rescorings per path count.", m_scoreRounds);
+    cmd.Parse(argc, argv);
+    return true;
+}
+
+template <typename Table>
+RtableBenchmark::Result
+RtableBenchmark::Measure(uint32_t size)
+{
+    typedef std::chrono::steady_clock Clock;
+    const uint32_t base = Ipv4Address("10.0.0.1").Get();
+    Result result = {0, 0, 0, 0};
+
+    std::vector<RoutingTableEntry> entries;
+    entries.reserve(size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        entries.emplace_back(/*dev=*/nullptr,
+                             /*dst=*/Ipv4Address(base + i),
+                             /*vSeqNo=*/true,
+                             /*seqNo=*/i,
+                             /*iface=*/Ipv4InterfaceAddress(),
+                             /*hops=*/1 + i % 8,
+                             /*nextHop=*/Ipv4Address(base + i % 16),
+                             /*lifetime=*/Seconds(10));
+    }
+
+    Table table;
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        table.insert(std::make_pair(entries[i].GetDestination(), entries[i]));
+    }
+    auto stop = Clock::now();
+    result.insert = std::chrono::duration<double, std::nano>(stop - start).count() / size;
+
+    // Every fourth lookup misses: the address lies just outside the table
+    uint32_t key = 0;
+    start = Clock::now();
+    for (uint32_t i = 0; i < m_lookups; ++i)
+    {
+        key = (key + 7919) % (size + size / 4 + 1);
+        auto it = table.find(Ipv4Address(base + key));
+        if (it != table.end())
+        {
+            result.checksum += it->second.GetHop();
+        }
+    }
+    stop = Clock::now();
+    result.lookup = std::chrono::duration<double, std::nano>(stop - start).count() / m_lookups;
+
+    start = Clock::now();
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        result.checksum += table.erase(entries[(i * 7919) % size].GetDestination());
+    }
+    stop = Clock::now();
+    result.erase = std::chrono::duration<double, std::nano>(stop - start).count() / size;
+    return result;
+}
+
+RtableBenchmark::ChurnResult
+RtableBenchmark::Churn(uint32_t nodes)
+{
+    typedef std::chrono::steady_clock Clock;
+    const uint32_t base = Ipv4Address("10.0.0.1").Get();
+    const Time step = MilliSeconds(100);
+    ChurnResult result = {0, 0, 0, 0, 0};
+
+    double side = std::sqrt(nodes * M_PI * m_range * m_range / m_degree);
+    std::ostringstream uniform;
+    uniform << "ns3::UniformRandomVariable[Min=0.0|Max=" << side << "]";
+    NodeContainer c;
+    c.Create(nodes);
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
+                                  "X",
+                                  StringValue(uniform.str()),
+                                  "Y",
+                                  StringValue(uniform.str()));
+    mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+                              "Bounds",
+                              RectangleValue(Rectangle(0, side, 0, side)),
+                              "Distance",
+                              DoubleValue(150.0),
+                              "Speed",
+                              StringValue("ns3::UniformRandomVariable[Min=5.0|Max=15.0]"));
+    mobility.Install(c);
+    std::vector<Ptr<MobilityModel>> position;
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        position.push_back(c.Get(i)->GetObject<MobilityModel>());
+    }
+
+    RoutingTable rtable(Seconds(3));
+    AddressMap<RoutingTableEntry> scanned;
+    std::vector<uint32_t> neighbors;
+    std::vector<bool> isNeighbor(nodes, false);
+
+    // Route to dst through the current neighbor closest to it
+    auto reroute = [&](uint32_t dst) {
+        uint32_t nextHop = dst;
+        if (!isNeighbor[dst])
+        {
+            double best = std::numeric_limits<double>::max();
+            for (uint32_t n : neighbors)
+            {
+                double d = CalculateDistance(position[n]->GetPosition(),
+                                             position[dst]->GetPosition());
+                if (d < best)
+                {
+                    best = d;
+                    nextHop = n;
+                }
+            }
+        }
+        RoutingTableEntry rt(/*dev=*/nullptr,
+                             /*dst=*/Ipv4Address(base + dst),
+                             /*vSeqNo=*/true,
+                             /*seqNo=*/0,
+                             /*iface=*/Ipv4InterfaceAddress(),
+                             /*hops=*/isNeighbor[dst] ? 1 : 2,
+                             /*nextHop=*/Ipv4Address(base + nextHop),
+                             /*lifetime=*/Seconds(m_churnTime + 10));
+        scanned.insert(std::make_pair(rt.GetDestination(), rt)).first->second = rt;
+        auto start = Clock::now();
+        if (!rtable.Update(rt))
+        {
+            rtable.AddRoute(rt);
+        }
+        result.update += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        ++result.updates;
+    };
+
+    for (Time now = Seconds(0); now < Seconds(m_churnTime); now += step)
+    {
+        Simulator::Stop(step);
+        Simulator::Run();
+
+        std::vector<uint32_t> lost;
+        std::vector<uint32_t> gained;
+        neighbors.clear();
+        for (uint32_t n = 1; n < nodes; ++n)
+        {
+            bool inRange = CalculateDistance(position[0]->GetPosition(),
+                                             position[n]->GetPosition()) < m_range;
+            if (inRange)
+            {
+                neighbors.push_back(n);
+            }
+            if (inRange != isNeighbor[n])
+            {
+                (inRange ? gained : lost).push_back(n);
+                isNeighbor[n] = inRange;
+            }
+        }
+        for (uint32_t n : lost)
+        {
+            Ipv4Address nextHop(base + n);
+            std::map<Ipv4Address, uint32_t> unreachable;
+            auto start = Clock::now();
+            for (auto i = scanned.begin(); i != scanned.end(); ++i)
+            {
+                if (i->second.GetNextHop() == nextHop)
+                {
+                    unreachable.insert(std::make_pair(i->first, i->second.GetSeqNo()));
+                }
+            }
+            auto stop = Clock::now();
+            result.scan += std::chrono::duration<double, std::nano>(stop - start).count();
+            size_t affected = unreachable.size();
+
+            start = Clock::now();
+            rtable.GetListOfDestinationWithNextHop(nextHop, unreachable);
+            stop = Clock::now();
+            result.index += std::chrono::duration<double, std::nano>(stop - start).count();
+            NS_ABORT_MSG_IF(unreachable.size() != affected, "Next hop index disagrees with scan");
+            ++result.breaks;
+
+            for (const auto& i : unreachable)
+            {
+                reroute(i.first.Get() - base);
+            }
+        }
+        for (uint32_t n : gained)
+        {
+            reroute(n);
+        }
+        if (now.IsZero())
+        {
+            // Initial routes to every node
+            for (uint32_t n = 1; n < nodes; ++n)
+            {
+                if (!isNeighbor[n])
+                {
+                    reroute(n);
+                }
+            }
+        }
+    }
+    Simulator::Destroy();
+
+    if (result.breaks)
+    {
+        result.scan /= result.breaks;
+        result.index /= result.breaks;
+    }
+    if (result.updates)
+    {
+        result.update /= result.updates;
+    }
+    return result;
+}
+
+uint64_t
+RtableBenchmark::GetResident()
+{
+    // Second field of statm: resident pages
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (!(statm >> size >> resident))
+    {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+uint64_t
+RtableBenchmark::Grid(uint32_t nodes, bool compact)
+{
+    const uint32_t base = Ipv4Address("10.0.0.1").Get();
+    const uint32_t side = std::ceil(std::sqrt(nodes));
+    const uint32_t routes = std::min(m_gridRoutes, nodes - 1);
+    uint64_t before = GetResident();
+
+    std::vector<std::unique_ptr<RoutingTable>> tables;
+    tables.reserve(nodes);
+    for (uint32_t n = 0; n < nodes; ++n)
+    {
+        tables.emplace_back(new RoutingTable(Seconds(3)));
+        RoutingTable& rtable = *tables.back();
+        rtable.SetCompact(compact);
+        uint32_t x = n % side;
+        uint32_t y = n / side;
+        for (uint32_t r = 1; r <= routes; ++r)
+        {
+            uint32_t dst = (n + r * (nodes / routes)) % nodes;
+            if (dst == n)
+            {
+                continue;
+            }
+            uint32_t dx = dst % side;
+            uint32_t dy = dst / side;
+            // First step of an x-then-y walk towards dst
+            uint32_t nextHop = dx > x ? n + 1 : dx < x ? n - 1 : dy > y ? n + side : n - side;
+            RoutingTableEntry rt(
+                /*dev=*/nullptr,
+                /*dst=*/Ipv4Address(base + dst),
+                /*vSeqNo=*/true,
+                /*seqNo=*/r,
+                /*iface=*/Ipv4InterfaceAddress(),
+                /*hops=*/(dx > x ? dx - x : x - dx) + (dy > y ? dy - y : y - dy),
+                /*nextHop=*/Ipv4Address(base + nextHop),
+                /*lifetime=*/Seconds(10 + r % 7));
+            rtable.AddRoute(rt);
+        }
+    }
+    uint64_t after = GetResident();
+    return after > before ? after - before : 0;
+}
+
+RtableBenchmark::ScoreResult
+RtableBenchmark::Score(uint32_t paths)
+{
+    typedef std::chrono::steady_clock Clock;
+    const uint32_t base = Ipv4Address("10.0.0.1").Get();
+    const uint32_t perDst = 4;
+    ScoreResult result = {0, 0, 0};
+
+    // The entries hold pointers into the batch and must not move
+    PathScoreBatch batch;
+    std::vector<MultipathRouteEntry> entries;
+    entries.reserve(paths / perDst + 1);
+    for (uint32_t i = 0; i < paths; ++i)
+    {
+        if (i % perDst == 0)
+        {
+            entries.emplace_back(Ipv4Address(base + i / perDst));
+            entries.back().SetMetricStore(&batch);
+        }
+        MultipathRouteEntry::PathInfo path;
+        path.nextHop = Ipv4Address(base + i % perDst + 1);
+        path.hopCount = 1 + i % 7;
+        path.expiryTime = Seconds(10);
+        path.bleMetrics.residualEnergy = (i % 10) / 10.0;
+        path.bleMetrics.rssiValue = -100.0 + i % 71;
+        path.bleMetrics.stabilityScore = (i % 13) / 13.0;
+        entries.back().AddPath(path);
+    }
+    // Two weightings to alternate between, so that every round rescores
+    WeightFactors weights[2];
+    weights[1].hopWeight = 0.1;
+    weights[1].stabilityWeight = 0.5;
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t round = 0; round < m_scoreRounds; ++round)
+    {
+        for (auto& entry : entries)
+        {
+            entry.SetWeights(weights[round % 2]);
+        }
+    }
+    Clock::time_point stop = Clock::now();
+    result.scalar = std::chrono::duration<double, std::nano>(stop - start).count() /
+                    (double(paths) * m_scoreRounds);
+
+    start = Clock::now();
+    for (uint32_t round = 0; round < m_scoreRounds; ++round)
+    {
+        batch.Score(weights[round % 2]);
+        for (auto& entry : entries)
+        {
+            entry.ApplyScores(weights[round % 2]);
+        }
+    }
+    stop = Clock::now();
+    result.batch = std::chrono::duration<double, std::nano>(stop - start).count() /
+                   (double(paths) * m_scoreRounds);
+    // The entries hold the scores of the last round
+    const WeightFactors& last = weights[m_scoreRounds > 0 ? (m_scoreRounds - 1) % 2 : 0];
+    for (auto& entry : entries)
+    {
+        for (const auto& path : entry.GetPaths())
+        {
+            NS_ABORT_MSG_IF(std::abs(path.compositeScore - path.CalculateCompositeScore(last)) >
+                                1e-12,
+                            "Batch and scalar scores disagree");
+        }
+    }
+
+    start = Clock::now();
+    for (uint32_t round = 0; round < m_scoreRounds; ++round)
+    {
+        batch.Score(weights[round % 2]);
+    }
+    stop = Clock::now();
+    result.kernel = std::chrono::duration<double, std::nano>(stop - start).count() /
+                    (double(paths) * m_scoreRounds);
+    return result;
+}
+
+void
+RtableBenchmark::Run()
+{
+    std::cout << std::left << std::setw(10) << "Routes" << std::setw(12) << "Container"
+              << std::setw(14) << "Insert(ns)" << std::setw(14) << "Lookup(ns)"
+              << std::setw(14) << "Erase(ns)" << std::endl;
+    std::istringstream sizes(m_sizes);
+    std::string token;
+    while (std::getline(sizes, token, ','))
+    {
+        uint32_t size = std::stoul(token);
+        Result map = Measure<std::map<Ipv4Address, RoutingTableEntry>>(size);
+        Result hash = Measure<AddressMap<RoutingTableEntry>>(size);
+        NS_ABORT_MSG_IF(map.checksum != hash.checksum, "Containers disagree");
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << std::setw(10) << size << std::setw(12) << "std::map" << std::setw(14)
+                  << map.insert << std::setw(14) << map.lookup << std::setw(14) << map.erase
+                  << std::endl;
+        std::cout << std::setw(10) << size << std::setw(12) << "AddressMap" << std::setw(14)
+                  << hash.insert << std::setw(14) << hash.lookup << std::setw(14) << hash.erase
+                  << std::endl;
+    }
+}
+
+void
+RtableBenchmark::RunChurn()
+{
+    std::cout << "\n"
+              << std::left << std::setw(10) << "Nodes" << std::setw(10) << "Breaks"
+              << std::setw(12) << "Reroutes" << std::setw(14) << "Scan(ns)" << std::setw(14)
+              << "Index(ns)" << std::setw(14) << "Update(ns)" << std::endl;
+    std::istringstream sizes(m_churnNodes);
+    std::string token;
+    while (std::getline(sizes, token, ','))
+    {
+        uint32_t nodes = std::stoul(token);
+        ChurnResult r = Churn(nodes);
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << std::setw(10) << nodes << std::setw(10) << r.breaks << std::setw(12)
+                  << r.updates << std::setw(14) << r.scan << std::setw(14) << r.index
+                  << std::setw(14) << r.update << std::endl;
+    }
+}
+
+void
+RtableBenchmark::RunGrid()
+{
+    std::cout << "\n"
+              << std::left << std::setw(10) << "Nodes" << std::setw(12) << "Routes"
+              << std::setw(10) << "Layout" << std::setw(14) << "Tables(MB)" << std::setw(14)
+              << "Route(B)" << std::setw(14) << "Peak(MB)" << std::endl;
+    std::istringstream sizes(m_gridNodes);
+    std::string token;
+    while (std::getline(sizes, token, ','))
+    {
+        uint32_t nodes = std::stoul(token);
+        uint64_t routes = uint64_t(nodes) * std::min(m_gridRoutes, nodes - 1);
+        for (bool compact : {false, true})
+        {
+            // Each layout in its own process, so that neither reuses the heap
+            // released by the other and the peak resident set is its own
+            std::cout.flush();
+            pid_t pid = fork();
+            NS_ABORT_MSG_IF(pid < 0, "fork failed");
+            if (pid == 0)
+            {
+                uint64_t bytes = Grid(nodes, compact);
+                struct rusage usage;
+                getrusage(RUSAGE_SELF, &usage);
+                std::cout << std::fixed << std::setprecision(1);
+                std::cout << std::setw(10) << nodes << std::setw(12) << routes << std::setw(10)
+                          << (compact ? "compact" : "default") << std::setw(14)
+                          << bytes / 1048576.0 << std::setw(14) << double(bytes) / routes
+                          << std::setw(14) << usage.ru_maxrss / 1024.0 << std::endl;
+                _exit(0);
+            }
+            waitpid(pid, nullptr, 0);
+        }
+    }
+}
+
+void
+RtableBenchmark::RunScoring()
+{
+    std::cout << "\n"
+              << std::left << std::setw(10) << "Paths" << std::setw(14) << "Scalar(ns)"
+              << std::setw(14) << "Batch(ns)" << std::setw(14) << "Kernel(ns)" << std::endl;
+    std::istringstream sizes(m_scorePaths);
+    std::string token;
+    while (std::getline(sizes, token, ','))
+    {
+        uint32_t paths = std::stoul(token);
+        if (paths == 0)
+        {
+            continue;
+        }
+        ScoreResult r = Score(paths);
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::setw(10) << paths << std::setw(14) << r.scalar << std::setw(14)
+                  << r.batch << std::setw(14) << r.kernel << std::endl;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    RtableBenchmark benchmark;
+    if (!benchmark.Configure(argc, argv))
+    {
+        NS_FATAL_ERROR("Configuration failed. Aborted.");
+    }
+    benchmark.Run();
+    benchmark.RunChurn();
+    benchmark.RunGrid();
+    benchmark.RunScoring();
+    return 0;
+}
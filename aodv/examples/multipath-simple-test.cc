@@ -52,8 +52,8 @@ int main(int argc, char *argv[])
         Ptr<aodv::RoutingTable> rt = aodvProtocol->GetRoutingTable();
         
         // Test add multipath routes
-        rt->AddMultipathRoute(Ipv4Address("10.1.1.3"), Ipv4Address("10.1.1.2"), 2, Seconds(10));
-        rt->AddMultipathRoute(Ipv4Address("10.1.1.3"), Ipv4Address("10.1.1.4"), 1, Seconds(10));
+        rt->AddMultipathRoute(Ipv4Address("10.1.1.3"), Ipv4Address("10.1.1.2"), 2, Seconds(10), 1);
+        rt->AddMultipathRoute(Ipv4Address("10.1.1.3"), Ipv4Address("10.1.1.4"), 1, Seconds(10), 1);
         
         // Print routing table
         Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>(&std::cout);
@@ -8,16 +8,105 @@
  */
 #include "aodv-helper.h"
 #include "ns3/aodv-routing-protocol.h"
+#include "ns3/aodv-state-io.h"
 #include "ns3/ipv4-list-routing.h"
+#include "ns3/mobility-model.h"
 #include "ns3/names.h"
 #include "ns3/node-list.h"
 #include "ns3/ptr.h"
 #include "ns3/boolean.h"
 #include "ns3/double.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
 
 namespace ns3
 {
 
+/// First bytes of a file written by AodvHelper::SaveRoutingState()
+static const char AODV_STATE_MAGIC[8] = {'A', 'O', 'D', 'V', 'S', 'T', 'A', 'T'};
+/// Version of the routing state file format
+static const uint32_t AODV_STATE_VERSION = 1;
+/// First bytes of a file written by AodvHelper::WriteRoutingSnapshot()
+static const char AODV_SNAPSHOT_MAGIC[8] = {'A', 'O', 'D', 'V', 'S', 'N', 'A', 'P'};
+
+/**
+ * Find the AODV agent of a node, alone or in a list routing protocol
+ * @param node the node
+ * @returns the agent, or nullptr if the node has none
+ */
+static Ptr<aodv::RoutingProtocol>
+GetAodv(Ptr<Node> node)
+{
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    NS_ASSERT_MSG(ipv4, "Ipv4 not installed on node");
+    Ptr<Ipv4RoutingProtocol> proto = ipv4->GetRoutingProtocol();
+    NS_ASSERT_MSG(proto, "Ipv4 routing not installed on node");
+    Ptr<aodv::RoutingProtocol> aodv = DynamicCast<aodv::RoutingProtocol>(proto);
+    if (aodv)
+    {
+        return aodv;
+    }
+    // Aodv may also be in a list
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(proto);
+    if (list)
+    {
+        int16_t priority;
+        for (uint32_t i = 0; i < list->GetNRoutingProtocols(); i++)
+        {
+            aodv = DynamicCast<aodv::RoutingProtocol>(list->GetRoutingProtocol(i, priority));
+            if (aodv)
+            {
+                return aodv;
+            }
+        }
+    }
+    return nullptr;
+}
+
+/// Parent of the root and of unreachable nodes in a BFS tree
+static const uint32_t NO_PARENT = 0xffffffff;
+
+/**
+ * Breadth-first search of an undirected graph
+ * @param adjacency the neighbors of each vertex, in increasing order
+ * @param root the vertex to start from
+ * @param parent filled with the parent of each vertex, NO_PARENT if none
+ * @param hops filled with the distance of each vertex from root
+ */
+static void
+Bfs(const std::vector<std::vector<uint32_t>>& adjacency,
+    uint32_t root,
+    uint32_t* parent,
+    uint16_t* hops)
+{
+    std::fill(parent, parent + adjacency.size(), NO_PARENT);
+    std::vector<uint32_t> queue;
+    queue.reserve(adjacency.size());
+    queue.push_back(root);
+    parent[root] = root;
+    hops[root] = 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        uint32_t v = queue[head];
+        for (uint32_t u : adjacency[v])
+        {
+            if (parent[u] == NO_PARENT)
+            {
+                parent[u] = v;
+                hops[u] = hops[v] + 1;
+                queue.push_back(u);
+            }
+        }
+    }
+    parent[root] = NO_PARENT;
+}
+
 AodvHelper::AodvHelper()
     : Ipv4RoutingHelper()
 {
@@ -61,40 +150,239 @@ int64_t
 AodvHelper::AssignStreams(NodeContainer c, int64_t stream)
 {
     int64_t currentStream = stream;
-    Ptr<Node> node;
     for (auto i = c.Begin(); i != c.End(); ++i)
     {
-        node = (*i);
-        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
-        NS_ASSERT_MSG(ipv4, "Ipv4 not installed on node");
-        Ptr<Ipv4RoutingProtocol> proto = ipv4->GetRoutingProtocol();
-        NS_ASSERT_MSG(proto, "Ipv4 routing not installed on node");
-        Ptr<aodv::RoutingProtocol> aodv = DynamicCast<aodv::RoutingProtocol>(proto);
+        Ptr<aodv::RoutingProtocol> aodv = GetAodv(*i);
         if (aodv)
         {
             currentStream += aodv->AssignStreams(currentStream);
-            continue;
         }
-        // Aodv may also be in a list
-        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(proto);
-        if (list)
+    }
+    return (currentStream - stream);
+}
+
+uint64_t
+AodvHelper::SeedRoutes(NodeContainer c, double range, Time lifetime)
+{
+    std::vector<Ptr<aodv::RoutingProtocol>> agents;
+    std::vector<Ipv4Address> addresses;
+    std::vector<Vector> positions;
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<aodv::RoutingProtocol> aodv = GetAodv(*i);
+        Ptr<MobilityModel> mobility = (*i)->GetObject<MobilityModel>();
+        NS_ABORT_MSG_IF(!aodv || !mobility, "AODV and a MobilityModel are needed to seed routes");
+        Ptr<Ipv4> ipv4 = (*i)->GetObject<Ipv4>();
+        uint32_t j = 0;
+        while (j < ipv4->GetNInterfaces() &&
+               (ipv4->GetNAddresses(j) == 0 || ipv4->GetAddress(j, 0).GetLocal().IsLocalhost()))
+        {
+            ++j;
+        }
+        NS_ABORT_MSG_IF(j == ipv4->GetNInterfaces(), "Node " << (*i)->GetId() << " has no address");
+        Ipv4Address address = ipv4->GetAddress(j, 0).GetLocal();
+        agents.push_back(aodv);
+        addresses.push_back(address);
+        positions.push_back(mobility->GetPosition());
+    }
+
+    const uint32_t n = agents.size();
+    std::vector<std::vector<uint32_t>> adjacency(n);
+    for (uint32_t a = 0; a < n; ++a)
+    {
+        for (uint32_t b = a + 1; b < n; ++b)
         {
-            int16_t priority;
-            Ptr<Ipv4RoutingProtocol> listProto;
-            Ptr<aodv::RoutingProtocol> listAodv;
-            for (uint32_t i = 0; i < list->GetNRoutingProtocols(); i++)
+            if (CalculateDistance(positions[a], positions[b]) <= range)
+            {
+                adjacency[a].push_back(b);
+                adjacency[b].push_back(a);
+            }
+        }
+    }
+
+    // The searches run in parallel, a batch of destinations at a time; the
+    // routes are installed from this thread, since the agents are not thread
+    // safe. Each batch holds the BFS trees of its destinations.
+    const uint32_t threads = std::max(1U, std::thread::hardware_concurrency());
+    const uint32_t batch = std::min(n, 4 * threads);
+    std::vector<uint32_t> parent(size_t(batch) * n);
+    std::vector<uint16_t> hops(size_t(batch) * n);
+    uint64_t installed = 0;
+    for (uint32_t first = 0; first < n; first += batch)
+    {
+        const uint32_t count = std::min(batch, n - first);
+        std::atomic<uint32_t> next(0);
+        auto work = [&]() {
+            for (uint32_t k = next++; k < count; k = next++)
+            {
+                Bfs(adjacency, first + k, &parent[size_t(k) * n], &hops[size_t(k) * n]);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (uint32_t t = 1; t < std::min(threads, count); ++t)
+        {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        for (uint32_t k = 0; k < count; ++k)
+        {
+            const uint32_t dst = first + k;
+            const uint32_t* up = &parent[size_t(k) * n];
+            const uint32_t seqNo = agents[dst]->GetSeqNo();
+            for (uint32_t v = 0; v < n; ++v)
+            {
+                if (up[v] != NO_PARENT &&
+                    agents[v]->SeedRoute(addresses[dst],
+                                         addresses[up[v]],
+                                         hops[size_t(k) * n + v],
+                                         seqNo,
+                                         lifetime))
+                {
+                    ++installed;
+                }
+            }
+            // The children of a node in the tree forward to dst through it
+            for (uint32_t v = 0; v < n; ++v)
             {
-                listProto = list->GetRoutingProtocol(i, priority);
-                listAodv = DynamicCast<aodv::RoutingProtocol>(listProto);
-                if (listAodv)
+                if (up[v] != NO_PARENT && up[v] != dst)
                 {
-                    currentStream += listAodv->AssignStreams(currentStream);
-                    break;
+                    Ipv4Address precursor = addresses[v];
+                    agents[up[v]]->GetRoutingTable().ModifyRoute(
+                        addresses[dst],
+                        [precursor](aodv::RoutingTableEntry& rt) {
+                            return rt.InsertPrecursor(precursor);
+                        });
                 }
             }
         }
     }
-    return (currentStream - stream);
+    return installed;
+}
+
+void
+AodvHelper::WriteRoutingSnapshot(NodeContainer c, std::string filename)
+{
+    std::ofstream file(filename, std::ios::binary);
+    NS_ABORT_MSG_IF(!file, "AODV: cannot open " << filename);
+    uint8_t header[aodv::RouteRecord::HEADER_SIZE];
+    std::copy(AODV_SNAPSHOT_MAGIC, AODV_SNAPSHOT_MAGIC + 8, header);
+    uint64_t fields[] = {aodv::RouteRecord::VERSION,
+                         aodv::RouteRecord::SIZE,
+                         static_cast<uint64_t>(Simulator::Now().GetNanoSeconds())};
+    uint32_t sizes[] = {4, 4, 8};
+    uint8_t* p = header + 8;
+    for (uint32_t f = 0; f < 3; ++f)
+    {
+        for (uint32_t i = 0; i < sizes[f]; ++i)
+        {
+            *p++ = (fields[f] >> (8 * i)) & 0xff;
+        }
+    }
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<aodv::RoutingProtocol> aodv = GetAodv(*i);
+        if (aodv)
+        {
+            aodv->GetRoutingTable().WriteSnapshot(file, (*i)->GetId());
+        }
+    }
+    NS_ABORT_MSG_IF(!file, "AODV: cannot write " << filename);
+}
+
+void
+AodvHelper::WriteRoutingSnapshotEvery(Time interval, NodeContainer c, std::string prefix)
+{
+    Simulator::Schedule(interval, &AodvHelper::WriteSnapshotEvery, interval, c, prefix, 1);
+}
+
+void
+AodvHelper::WriteSnapshotEvery(Time interval, NodeContainer c, std::string prefix, uint32_t n)
+{
+    WriteRoutingSnapshot(c, prefix + "-" + std::to_string(n) + ".snap");
+    Simulator::Schedule(interval, &AodvHelper::WriteSnapshotEvery, interval, c, prefix, n + 1);
+}
+
+void
+AodvHelper::SaveRoutingState(NodeContainer c, std::string filename)
+{
+    std::ofstream file(filename, std::ios::binary);
+    NS_ABORT_MSG_IF(!file, "AODV: cannot open " << filename);
+    std::vector<std::pair<uint32_t, std::string>> states;
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<aodv::RoutingProtocol> aodv = GetAodv(*i);
+        if (aodv)
+        {
+            std::ostringstream state;
+            aodv->SaveState(state);
+            states.emplace_back((*i)->GetId(), state.str());
+        }
+    }
+    file.write(AODV_STATE_MAGIC, sizeof(AODV_STATE_MAGIC));
+    aodv::WriteStateField(file, AODV_STATE_VERSION, 4);
+    aodv::WriteStateField(file, states.size(), 4);
+    for (const auto& state : states)
+    {
+        // The length lets a restore skip the nodes it does not cover
+        aodv::WriteStateField(file, state.first, 4);
+        aodv::WriteStateField(file, state.second.size(), 4);
+        file.write(state.second.data(), state.second.size());
+    }
+    NS_ABORT_MSG_IF(!file, "AODV: cannot write " << filename);
+}
+
+void
+AodvHelper::SaveRoutingStateAt(Time saveTime, NodeContainer c, std::string filename)
+{
+    Simulator::Schedule(saveTime, &AodvHelper::SaveRoutingState, c, filename);
+}
+
+uint32_t
+AodvHelper::RestoreRoutingState(NodeContainer c, std::string filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    NS_ABORT_MSG_IF(!file, "AODV: cannot open " << filename);
+    char magic[sizeof(AODV_STATE_MAGIC)];
+    file.read(magic, sizeof(magic));
+    NS_ABORT_MSG_IF(!file || !std::equal(magic, magic + sizeof(magic), AODV_STATE_MAGIC),
+                    "AODV: " << filename << " is not a routing state file");
+    uint32_t version = aodv::ReadStateField(file, 4);
+    NS_ABORT_MSG_IF(version != AODV_STATE_VERSION,
+                    "AODV: unsupported routing state version " << version);
+
+    std::map<uint32_t, Ptr<aodv::RoutingProtocol>> agents;
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<aodv::RoutingProtocol> aodv = GetAodv(*i);
+        if (aodv)
+        {
+            agents[(*i)->GetId()] = aodv;
+        }
+    }
+
+    uint32_t restored = 0;
+    uint32_t nodes = aodv::ReadStateField(file, 4);
+    for (uint32_t n = 0; n < nodes; ++n)
+    {
+        uint32_t id = aodv::ReadStateField(file, 4);
+        std::string state(aodv::ReadStateField(file, 4), '\0');
+        file.read(&state[0], state.size());
+        NS_ABORT_MSG_IF(!file, "AODV: truncated routing state");
+        auto agent = agents.find(id);
+        if (agent != agents.end())
+        {
+            std::istringstream is(state);
+            agent->second->RestoreState(is);
+            ++restored;
+        }
+    }
+    return restored;
 }
 
 // ================== PENAMBAHAN BLE-MAODV ================ 
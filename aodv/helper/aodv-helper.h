@@ -13,6 +13,7 @@
 #include "ns3/ipv4-routing-helper.h"
 #include "ns3/node-container.h"
 #include "ns3/node.h"
+#include "ns3/nstime.h"
 #include "ns3/object-factory.h"
 
 namespace ns3
@@ -63,6 +64,90 @@ class AodvHelper : public Ipv4RoutingHelper
      * @return the number of stream indices assigned by this helper
      */
     int64_t AssignStreams(NodeContainer c, int64_t stream);
+
+    /**
+     * @brief Save the AODV state of a set of nodes to a binary file.
+     *
+     * For each node the routing table, the neighbor list and the sequence
+     * number and RREQ id counters are written, with lifetimes relative to the
+     * current time (see aodv::RoutingProtocol::SaveState()). Nodes without
+     * AODV are skipped.
+     *
+     * @param c the nodes to save
+     * @param filename the file to write
+     */
+    static void SaveRoutingState(NodeContainer c, std::string filename);
+
+    /**
+     * @brief Save the AODV state of a set of nodes at a given time.
+     *
+     * Typically called before Simulator::Run() with the time at which the
+     * routes of the scenario have converged.
+     *
+     * @param saveTime the simulation time to save at
+     * @param c the nodes to save
+     * @param filename the file to write
+     */
+    static void SaveRoutingStateAt(Time saveTime, NodeContainer c, std::string filename);
+
+    /**
+     * @brief Restore AODV state saved by SaveRoutingState().
+     *
+     * Each node of c gets the state saved for the node with the same id, so
+     * the restoring run must build the same nodes, devices and addresses as
+     * the saving one. Saved lifetimes start from the current time. Must be
+     * called after the addresses are assigned, usually right before
+     * Simulator::Run().
+     *
+     * @param c the nodes to restore
+     * @param filename the file to read
+     * @return the number of nodes restored
+     */
+    static uint32_t RestoreRoutingState(NodeContainer c, std::string filename);
+
+    /**
+     * @brief Install shortest path routes computed from the node positions.
+     *
+     * Two nodes of c are taken to be neighbors when they are at most range
+     * apart, as with a RangePropagationLossModel of that MaxRange, and the
+     * nodes do not move. A breadth-first search from every destination, run
+     * on all hardware threads, gives each node its next hop and hop count;
+     * the routes are installed as VALID entries carrying the current sequence
+     * number of the destination, with the upstream nodes as precursors. Runs
+     * can then skip route discovery and measure steady-state forwarding.
+     *
+     * Each node is addressed by the first address of its first non-loopback
+     * interface. Must be called after the addresses are assigned.
+     *
+     * @param c the nodes, with a MobilityModel and AODV installed
+     * @param range the radio range, meters
+     * @param lifetime the lifetime of the installed routes
+     * @return the number of routes installed
+     */
+    static uint64_t SeedRoutes(NodeContainer c, double range, Time lifetime);
+
+    /**
+     * @brief Write a binary snapshot of the routing tables of a set of nodes.
+     *
+     * The file holds one fixed-size aodv::RouteRecord per route, after a
+     * short header; see aodv::RouteRecord for the layout. The tables are
+     * read in place, so this is much cheaper than printing them.
+     *
+     * @param c the nodes
+     * @param filename the file to write
+     */
+    static void WriteRoutingSnapshot(NodeContainer c, std::string filename);
+
+    /**
+     * @brief Write a binary snapshot of the routing tables periodically.
+     *
+     * Snapshot n, taken at n times the interval, goes to prefix-n.snap.
+     *
+     * @param interval the time between snapshots
+     * @param c the nodes
+     * @param prefix the file name prefix
+     */
+    static void WriteRoutingSnapshotEvery(Time interval, NodeContainer c, std::string prefix);
     // =============== PENAMBAHAN MULTIPATH =============
     void SetMultipathEnabled(bool enable);
     // =============== END =============
@@ -79,6 +164,19 @@ class AodvHelper : public Ipv4RoutingHelper
     // =============== END PENAMBAHAN BLE-MAODV ================
 
   private:
+    /**
+     * @brief Write snapshot n and schedule the next one.
+     *
+     * @param interval the time between snapshots
+     * @param c the nodes
+     * @param prefix the file name prefix
+     * @param n the snapshot number
+     */
+    static void WriteSnapshotEvery(Time interval,
+                                   NodeContainer c,
+                                   std::string prefix,
+                                   uint32_t n);
+
     /** the factory to create AODV routing object */
     ObjectFactory m_agentFactory;
 
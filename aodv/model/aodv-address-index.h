@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_ADDRESS_INDEX_H
+#define AODV_ADDRESS_INDEX_H
+
+#include "aodv-address-map.h"
+
+#include "ns3/ipv4-address.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * @ingroup aodv
+ * @brief Dense numbering of IPv4 addresses.
+ *
+ * Each address gets the next free id the first time it is seen; ids are never
+ * reused, so they stay valid for the lifetime of the index. The compact
+ * layout of RoutingTable keeps its columns in arrays indexed by id.
+ */
+class AddressIndex
+{
+  public:
+    /// Id returned by FindId() for an address that has none
+    static constexpr uint32_t NONE = 0xffffffff;
+
+    /**
+     * Get the id of an address, assigning one if needed
+     * @param addr the address
+     * @returns the id of addr
+     */
+    uint32_t GetId(Ipv4Address addr)
+    {
+        auto result = m_ids.insert(std::make_pair(addr, static_cast<uint32_t>(m_addresses.size())));
+        if (result.second)
+        {
+            m_addresses.push_back(addr);
+        }
+        return result.first->second;
+    }
+
+    /**
+     * Get the id of an address without assigning one
+     * @param addr the address
+     * @returns the id of addr, or NONE
+     */
+    uint32_t FindId(Ipv4Address addr) const
+    {
+        auto i = m_ids.find(addr);
+        return i == m_ids.end() ? NONE : i->second;
+    }
+
+    /**
+     * @param id an id returned by GetId()
+     * @returns the address with that id
+     */
+    Ipv4Address GetAddress(uint32_t id) const
+    {
+        return m_addresses[id];
+    }
+
+    /// @returns the number of ids assigned
+    uint32_t GetSize() const
+    {
+        return static_cast<uint32_t>(m_addresses.size());
+    }
+
+  private:
+    /// Id of each address
+    AddressMap<uint32_t> m_ids;
+    /// Address of each id
+    std::vector<Ipv4Address> m_addresses;
+};
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_ADDRESS_INDEX_H */
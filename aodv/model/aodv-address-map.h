@@ -0,0 +1,316 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_ADDRESS_MAP_H
+#define AODV_ADDRESS_MAP_H
+
+#include "ns3/ipv4-address.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * @ingroup aodv
+ * @brief Open-addressing hash table keyed on a 32-bit IPv4 address.
+ *
+ * Values are kept densely packed in a vector, so iteration touches only live
+ * entries. The probe table holds (key, index) pairs of 8 bytes each, which
+ * keeps a whole probe sequence within one or two cache lines; a lookup reads
+ * the value only once the key has matched. Linear probing with backward-shift
+ * deletion is used, so there are no tombstones and the load factor never
+ * exceeds 1/2.
+ *
+ * The interface mirrors the subset of std::map used by the routing table
+ * (value_type is a key/value pair), but iteration order is unspecified, and
+ * any insertion or erasure invalidates iterators and pointers to values.
+ * erase(iterator) moves the last entry into the erased position and returns
+ * an iterator to that same position, so the usual erase-while-iterating loop
+ * visits every entry.
+ */
+template <typename T>
+class AddressMap
+{
+  public:
+    /// Stored element type
+    typedef std::pair<Ipv4Address, T> value_type;
+    /// Iterator over stored elements
+    typedef typename std::vector<value_type>::iterator iterator;
+    /// Const iterator over stored elements
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    AddressMap()
+        : m_mask(0),
+          m_shift(32)
+    {
+    }
+
+    /**
+     * Find the element stored under key
+     * @param key the address to look up
+     * @returns iterator to the element, or end() if the key is absent
+     */
+    iterator find(Ipv4Address key)
+    {
+        uint32_t index = FindIndex(key.Get());
+        return index == EMPTY ? m_entries.end() : m_entries.begin() + index;
+    }
+
+    /**
+     * Find the element stored under key
+     * @param key the address to look up
+     * @returns iterator to the element, or end() if the key is absent
+     */
+    const_iterator find(Ipv4Address key) const
+    {
+        uint32_t index = FindIndex(key.Get());
+        return index == EMPTY ? m_entries.end() : m_entries.begin() + index;
+    }
+
+    /**
+     * Insert an element if its key is not yet present
+     * @param value the key/value pair to insert
+     * @returns iterator to the element with the given key and true if it was inserted, false if
+     * the key already existed (the stored value is left untouched)
+     */
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        uint32_t raw = value.first.Get();
+        uint32_t index = FindIndex(raw);
+        if (index != EMPTY)
+        {
+            return std::make_pair(m_entries.begin() + index, false);
+        }
+        if (2 * (m_entries.size() + 1) > m_slots.size())
+        {
+            Rehash(m_slots.empty() ? MIN_SLOTS : 2 * m_slots.size());
+        }
+        index = static_cast<uint32_t>(m_entries.size());
+        m_entries.push_back(value);
+        PlaceSlot(raw, index);
+        return std::make_pair(m_entries.begin() + index, true);
+    }
+
+    /**
+     * Erase the element stored under key
+     * @param key the address
+     * @returns the number of erased elements (0 or 1)
+     */
+    size_t erase(Ipv4Address key)
+    {
+        uint32_t slot = FindSlot(key.Get());
+        if (slot == EMPTY)
+        {
+            return 0;
+        }
+        EraseSlot(slot);
+        return 1;
+    }
+
+    /**
+     * Erase the element at position it
+     * @param it the element to erase
+     * @returns iterator to the element that now occupies the erased position
+     */
+    iterator erase(iterator it)
+    {
+        size_t pos = it - m_entries.begin();
+        EraseSlot(FindSlot(it->first.Get()));
+        return m_entries.begin() + pos;
+    }
+
+    /// Remove all elements, keeping the allocated capacity
+    void clear()
+    {
+        m_entries.clear();
+        std::fill(m_slots.begin(), m_slots.end(), Slot());
+    }
+
+    /// @returns the number of stored elements
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    /// @returns true if no element is stored
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    /// @returns iterator to the first element
+    iterator begin()
+    {
+        return m_entries.begin();
+    }
+
+    /// @returns past-the-end iterator
+    iterator end()
+    {
+        return m_entries.end();
+    }
+
+    /// @returns iterator to the first element
+    const_iterator begin() const
+    {
+        return m_entries.begin();
+    }
+
+    /// @returns past-the-end iterator
+    const_iterator end() const
+    {
+        return m_entries.end();
+    }
+
+  private:
+    /// Marker for an unused slot and for "not found"
+    static constexpr uint32_t EMPTY = 0xffffffff;
+    /// Smallest probe table size
+    static constexpr uint32_t MIN_SLOTS = 16;
+
+    /// Probe table slot
+    struct Slot
+    {
+        /// Raw address
+        uint32_t m_key{0};
+        /// Index into m_entries, EMPTY if the slot is unused
+        uint32_t m_index{EMPTY};
+    };
+
+    /**
+     * Fibonacci hashing: the top bits of the product depend on every bit of
+     * the address, so both consecutive hosts of a subnet and hosts of
+     * different subnets spread over the whole table.
+     * @param key the raw address
+     * @returns the home slot of the key
+     */
+    uint32_t Home(uint32_t key) const
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(key * 2654435769U) >> m_shift);
+    }
+
+    /**
+     * @param key the raw address
+     * @returns the slot holding key, or EMPTY
+     */
+    uint32_t FindSlot(uint32_t key) const
+    {
+        if (m_slots.empty())
+        {
+            return EMPTY;
+        }
+        for (uint32_t s = Home(key);; s = (s + 1) & m_mask)
+        {
+            const Slot& slot = m_slots[s];
+            if (slot.m_index == EMPTY)
+            {
+                return EMPTY;
+            }
+            if (slot.m_key == key)
+            {
+                return s;
+            }
+        }
+    }
+
+    /**
+     * @param key the raw address
+     * @returns the index into m_entries of key, or EMPTY
+     */
+    uint32_t FindIndex(uint32_t key) const
+    {
+        uint32_t s = FindSlot(key);
+        return s == EMPTY ? EMPTY : m_slots[s].m_index;
+    }
+
+    /**
+     * Put (key, index) into the first free slot of the key's probe sequence
+     * @param key the raw address
+     * @param index the index into m_entries
+     */
+    void PlaceSlot(uint32_t key, uint32_t index)
+    {
+        uint32_t s = Home(key);
+        while (m_slots[s].m_index != EMPTY)
+        {
+            s = (s + 1) & m_mask;
+        }
+        m_slots[s].m_key = key;
+        m_slots[s].m_index = index;
+    }
+
+    /**
+     * Remove the element referenced by slot s: close the gap in the probe
+     * sequence by shifting back the following entries and move the last
+     * element into the freed dense position.
+     * @param s the slot to erase
+     */
+    void EraseSlot(uint32_t s)
+    {
+        uint32_t index = m_slots[s].m_index;
+        for (uint32_t next = (s + 1) & m_mask;; next = (next + 1) & m_mask)
+        {
+            Slot& candidate = m_slots[next];
+            if (candidate.m_index == EMPTY)
+            {
+                break;
+            }
+            uint32_t home = Home(candidate.m_key);
+            // Move candidate into the hole unless its home lies cyclically in (s, next]
+            bool stays = (s <= next) ? (s < home && home <= next) : (s < home || home <= next);
+            if (!stays)
+            {
+                m_slots[s] = candidate;
+                s = next;
+            }
+        }
+        m_slots[s] = Slot();
+
+        uint32_t last = static_cast<uint32_t>(m_entries.size() - 1);
+        if (index != last)
+        {
+            m_slots[FindSlot(m_entries[last].first.Get())].m_index = index;
+            m_entries[index] = std::move(m_entries[last]);
+        }
+        m_entries.pop_back();
+    }
+
+    /**
+     * Rebuild the probe table with the given number of slots
+     * @param slots the new table size, a power of two
+     */
+    void Rehash(uint32_t slots)
+    {
+        m_slots.assign(slots, Slot());
+        m_mask = slots - 1;
+        m_shift = 32;
+        for (uint32_t n = slots; n > 1; n >>= 1)
+        {
+            --m_shift;
+        }
+        for (uint32_t i = 0; i < m_entries.size(); ++i)
+        {
+            PlaceSlot(m_entries[i].first.Get(), i);
+        }
+    }
+
+    /// Probe table, size is zero or a power of two
+    std::vector<Slot> m_slots;
+    /// Probe table size minus one
+    uint32_t m_mask;
+    /// 32 minus log2 of the probe table size
+    uint32_t m_shift;
+    /// Densely packed elements
+    std::vector<value_type> m_entries;
+};
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_ADDRESS_MAP_H */
@@ -0,0 +1,133 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "aodv-blacklist.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("AodvBlacklist");
+
+namespace aodv
+{
+
+Blacklist::Blacklist()
+    : m_timer(Timer::CANCEL_ON_DESTROY)
+{
+    m_timer.SetFunction(&Blacklist::Purge, this);
+}
+
+void
+Blacklist::ExpectAck(Ipv4Address neighbor, Time wait, Time blacklistTimeout)
+{
+    NS_LOG_FUNCTION(this << neighbor << wait << blacklistTimeout);
+    auto i = m_entries.find(neighbor);
+    if (i == m_entries.end())
+    {
+        i = m_entries.insert(std::make_pair(neighbor, Entry())).first;
+        i->second.m_blacklistedUntil = Simulator::Now();
+    }
+    else
+    {
+        Update(neighbor, i->second);
+    }
+    i->second.m_ackDeadline = Simulator::Now() + wait;
+    i->second.m_blacklistTimeout = blacklistTimeout;
+    ScheduleTimer(i->second.m_ackDeadline);
+}
+
+bool
+Blacklist::AckReceived(Ipv4Address neighbor)
+{
+    NS_LOG_FUNCTION(this << neighbor);
+    auto i = m_entries.find(neighbor);
+    if (i == m_entries.end())
+    {
+        return false;
+    }
+    Update(neighbor, i->second);
+    if (i->second.m_ackDeadline == Time::Max())
+    {
+        return false;
+    }
+    i->second.m_ackDeadline = Time::Max();
+    if (i->second.m_blacklistedUntil <= Simulator::Now())
+    {
+        m_entries.erase(i);
+    }
+    return true;
+}
+
+bool
+Blacklist::IsBlacklisted(Ipv4Address neighbor)
+{
+    auto i = m_entries.find(neighbor);
+    if (i == m_entries.end())
+    {
+        return false;
+    }
+    Update(neighbor, i->second);
+    return i->second.m_blacklistedUntil > Simulator::Now();
+}
+
+void
+Blacklist::Update(Ipv4Address neighbor, Entry& entry)
+{
+    if (entry.m_ackDeadline <= Simulator::Now())
+    {
+        // The blacklisting starts when the RREP-ACK became overdue
+        NS_LOG_LOGIC("No RREP-ACK from " << neighbor << ", blacklist it");
+        entry.m_blacklistedUntil = entry.m_ackDeadline + entry.m_blacklistTimeout;
+        entry.m_ackDeadline = Time::Max();
+    }
+}
+
+void
+Blacklist::Purge()
+{
+    Time now = Simulator::Now();
+    Time next = Time::Max();
+    for (auto i = m_entries.begin(); i != m_entries.end();)
+    {
+        Entry& entry = i->second;
+        Update(i->first, entry);
+        if (entry.m_ackDeadline == Time::Max() && entry.m_blacklistedUntil <= now)
+        {
+            NS_LOG_LOGIC("Remove " << i->first << " from the blacklist");
+            i = m_entries.erase(i);
+            continue;
+        }
+        next = std::min(next, entry.m_ackDeadline);
+        if (entry.m_blacklistedUntil > now)
+        {
+            next = std::min(next, entry.m_blacklistedUntil);
+        }
+        ++i;
+    }
+    m_timer.Cancel();
+    if (next != Time::Max())
+    {
+        m_timer.Schedule(next - now);
+    }
+}
+
+void
+Blacklist::ScheduleTimer(Time deadline)
+{
+    Time now = Simulator::Now();
+    if (m_timer.IsRunning() && now + m_timer.GetDelayLeft() <= deadline)
+    {
+        return;
+    }
+    m_timer.Cancel();
+    m_timer.Schedule(deadline - now);
+}
+
+} // namespace aodv
+} // namespace ns3
@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_BLACKLIST_H
+#define AODV_BLACKLIST_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/timer.h"
+
+#include <map>
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * @ingroup aodv
+ * @brief Pending RREP-ACKs and the blacklist of unidirectional links (RFC 3561, section 6.8)
+ *
+ * When a RREP is sent with the 'A' bit set, the next hop is expected to answer
+ * with a RREP-ACK within NextHopWait. If it does not, the link is assumed to be
+ * unidirectional and the neighbor is blacklisted for BlackListTimeout; RREQs
+ * from blacklisted neighbors are ignored. Lookups only check the deadlines of
+ * the neighbor looked up; the entries that are no longer needed are removed by
+ * Purge(), which runs on one timer shared by all neighbors.
+ */
+class Blacklist
+{
+  public:
+    Blacklist();
+
+    /**
+     * Start waiting for a RREP-ACK from a neighbor
+     * @param neighbor the neighbor the RREP was sent to
+     * @param wait time to wait for the RREP-ACK
+     * @param blacklistTimeout time for which the neighbor is blacklisted if no
+     *        RREP-ACK arrives in time
+     */
+    void ExpectAck(Ipv4Address neighbor, Time wait, Time blacklistTimeout);
+    /**
+     * Stop waiting for a RREP-ACK from a neighbor
+     * @param neighbor the neighbor the RREP-ACK was received from
+     * @return true if a RREP-ACK from neighbor was pending
+     */
+    bool AckReceived(Ipv4Address neighbor);
+    /**
+     * Check whether a neighbor is blacklisted
+     * @param neighbor the neighbor
+     * @return true if the link to neighbor is considered unidirectional
+     */
+    bool IsBlacklisted(Ipv4Address neighbor);
+    /// Blacklist the neighbors whose RREP-ACK is overdue and forget expired entries
+    void Purge();
+
+    /// Remove all entries
+    void Clear()
+    {
+        m_entries.clear();
+        m_timer.Cancel();
+    }
+
+  private:
+    /// Deadlines of one neighbor
+    struct Entry
+    {
+        /// Time by which a RREP-ACK is expected, or Time::Max() if none is pending
+        Time m_ackDeadline;
+        /// Blacklist duration to apply if the RREP-ACK is not received in time
+        Time m_blacklistTimeout;
+        /// End of the blacklisting, in the past if the neighbor is not blacklisted
+        Time m_blacklistedUntil;
+    };
+
+    /**
+     * Blacklist a neighbor if its RREP-ACK is overdue
+     * @param neighbor the neighbor
+     * @param entry its deadlines
+     */
+    static void Update(Ipv4Address neighbor, Entry& entry);
+    /**
+     * Make sure Purge() runs no later than a deadline
+     * @param deadline the deadline
+     */
+    void ScheduleTimer(Time deadline);
+
+    /// Timer for the earliest deadline. Schedule Purge().
+    Timer m_timer;
+    /// Deadlines by neighbor address
+    std::map<Ipv4Address, Entry> m_entries;
+};
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_BLACKLIST_H */
@@ -0,0 +1,136 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "aodv-flow-table.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("AodvFlowTable");
+
+namespace aodv
+{
+
+/**
+ * @returns the current simulation time in milliseconds, wrapping after 49 days
+ */
+static uint32_t
+NowMs()
+{
+    return static_cast<uint32_t>(Simulator::Now().GetMilliSeconds());
+}
+
+FlowTable::FlowTable()
+    : m_capacity(0),
+      m_idleTimeout(Seconds(10)),
+      m_pins(0),
+      m_repins(0),
+      m_evictions(0)
+{
+}
+
+void
+FlowTable::SetCapacity(uint32_t flows)
+{
+    NS_LOG_FUNCTION(this << flows);
+    m_capacity = (flows + WAYS - 1) / WAYS * WAYS;
+    m_slots.clear();
+    m_slots.shrink_to_fit();
+}
+
+FlowTable::Slot*
+FlowTable::GetSet(uint32_t hash)
+{
+    return &m_slots[hash % (m_slots.size() / WAYS) * WAYS];
+}
+
+bool
+FlowTable::IsIdle(const Slot& slot, uint32_t now) const
+{
+    return static_cast<int64_t>(now - slot.lastUsed) >= m_idleTimeout.GetMilliSeconds();
+}
+
+Ipv4Address
+FlowTable::Lookup(uint32_t hash, Ipv4Address dst)
+{
+    if (m_slots.empty())
+    {
+        return Ipv4Address();
+    }
+    uint32_t now = NowMs();
+    Slot* set = GetSet(hash);
+    for (uint32_t way = 0; way < WAYS; ++way)
+    {
+        Slot& slot = set[way];
+        if (slot.nextHop && slot.hash == hash && slot.dst == dst.Get())
+        {
+            if (IsIdle(slot, now))
+            {
+                slot.nextHop = 0;
+                return Ipv4Address();
+            }
+            slot.lastUsed = now;
+            return Ipv4Address(slot.nextHop);
+        }
+    }
+    return Ipv4Address();
+}
+
+void
+FlowTable::Pin(uint32_t hash, Ipv4Address dst, Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << hash << dst << nextHop);
+    if (m_capacity == 0)
+    {
+        return;
+    }
+    if (m_slots.empty())
+    {
+        m_slots.assign(m_capacity, Slot{0, 0, 0, 0});
+    }
+    uint32_t now = NowMs();
+    Slot* set = GetSet(hash);
+    Slot* victim = nullptr;
+    for (uint32_t way = 0; way < WAYS; ++way)
+    {
+        Slot& slot = set[way];
+        if (slot.nextHop && slot.hash == hash && slot.dst == dst.Get())
+        {
+            if (slot.nextHop != nextHop.Get())
+            {
+                ++m_repins;
+            }
+            slot.nextHop = nextHop.Get();
+            slot.lastUsed = now;
+            return;
+        }
+        // Prefer a free slot, then the one idle for longest
+        if (!victim ||
+            (victim->nextHop && (!slot.nextHop || now - slot.lastUsed > now - victim->lastUsed)))
+        {
+            victim = &slot;
+        }
+    }
+    if (victim->nextHop && !IsIdle(*victim, now))
+    {
+        ++m_evictions;
+    }
+    *victim = Slot{hash, dst.Get(), nextHop.Get(), now};
+    ++m_pins;
+}
+
+void
+FlowTable::Clear()
+{
+    for (auto& slot : m_slots)
+    {
+        slot.nextHop = 0;
+    }
+}
+
+} // namespace aodv
+} // namespace ns3
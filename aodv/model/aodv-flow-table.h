@@ -0,0 +1,137 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_FLOW_TABLE_H
+#define AODV_FLOW_TABLE_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * @ingroup aodv
+ * @brief Next hops that data flows are pinned to.
+ *
+ * A flow is identified by a hash of its addresses, protocol and ports and by
+ * its destination. The table is set associative: a flow can only live in the
+ * WAYS slots of the set its hash selects, so lookups and insertions take
+ * constant time and the table never grows beyond its capacity. A slot is free
+ * again once its flow has been idle for the idle timeout; when all slots of a
+ * set are in use, a new flow takes the slot of the one idle for longest.
+ */
+class FlowTable
+{
+  public:
+    /// Slots per set
+    static constexpr uint32_t WAYS = 4;
+
+    FlowTable();
+
+    /**
+     * Set the number of flows kept, rounded up to a multiple of WAYS. All
+     * flows are forgotten; the slots are only allocated when the first flow
+     * is pinned.
+     * @param flows the number of flows, 0 to keep none
+     */
+    void SetCapacity(uint32_t flows);
+    /// @returns the number of flows kept
+    uint32_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+     * Set the time after which an unused flow is forgotten
+     * @param timeout the idle timeout
+     */
+    void SetIdleTimeout(Time timeout)
+    {
+        m_idleTimeout = timeout;
+    }
+    /// @returns the time after which an unused flow is forgotten
+    Time GetIdleTimeout() const
+    {
+        return m_idleTimeout;
+    }
+
+    /**
+     * Find the next hop of a flow and mark the flow as used
+     * @param hash the hash of the flow
+     * @param dst the destination of the flow
+     * @returns the next hop, or Ipv4Address() if the flow is not pinned
+     */
+    Ipv4Address Lookup(uint32_t hash, Ipv4Address dst);
+    /**
+     * Pin a flow to a next hop, replacing its previous one
+     * @param hash the hash of the flow
+     * @param dst the destination of the flow
+     * @param nextHop the next hop
+     */
+    void Pin(uint32_t hash, Ipv4Address dst, Ipv4Address nextHop);
+
+    /// Forget all flows
+    void Clear();
+
+    /// @returns the number of flows pinned since construction
+    uint64_t GetPins() const
+    {
+        return m_pins;
+    }
+    /// @returns the number of flows moved to another next hop since construction
+    uint64_t GetRepins() const
+    {
+        return m_repins;
+    }
+    /// @returns the number of flows evicted while still active since construction
+    uint64_t GetEvictions() const
+    {
+        return m_evictions;
+    }
+
+  private:
+    /// One flow, 16 bytes
+    struct Slot
+    {
+        uint32_t hash;     //!< Hash of the flow
+        uint32_t dst;      //!< Destination of the flow
+        uint32_t nextHop;  //!< Next hop of the flow, 0 if the slot is free
+        uint32_t lastUsed; //!< Time of the last packet of the flow, in milliseconds
+    };
+
+    /**
+     * @param hash the hash of a flow
+     * @returns the first slot of the set of the flow
+     */
+    Slot* GetSet(uint32_t hash);
+    /**
+     * @param slot a slot in use
+     * @param now the current time, in milliseconds
+     * @returns true if the flow of slot has been idle for the idle timeout
+     */
+    bool IsIdle(const Slot& slot, uint32_t now) const;
+
+    /// Number of flows kept, a multiple of WAYS
+    uint32_t m_capacity;
+    /// The slots, WAYS per set; empty until the first flow is pinned
+    std::vector<Slot> m_slots;
+    /// Time after which an unused flow is forgotten
+    Time m_idleTimeout;
+    /// Number of flows pinned
+    uint64_t m_pins;
+    /// Number of flows moved to another next hop
+    uint64_t m_repins;
+    /// Number of active flows evicted
+    uint64_t m_evictions;
+};
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_FLOW_TABLE_H */
@@ -28,8 +28,28 @@ NS_LOG_COMPONENT_DEFINE("AodvNeighbors");
 
 namespace aodv
 {
+
+/**
+ * Key of a MAC address in an unordered map
+ * @param addr the MAC address
+ * @returns the six bytes of addr as an integer
+ */
+static uint64_t
+MacKey(Mac48Address addr)
+{
+    uint8_t buffer[6];
+    addr.CopyTo(buffer);
+    uint64_t key = 0;
+    for (uint8_t byte : buffer)
+    {
+        key = (key << 8) | byte;
+    }
+    return key;
+}
+
 Neighbors::Neighbors(Time delay)
-    : m_ntimer(Timer::CANCEL_ON_DESTROY)
+    : m_ntimer(Timer::CANCEL_ON_DESTROY),
+      m_deliveryRatioWeight(0.1)
 {
     m_ntimer.SetDelay(delay);
     m_ntimer.SetFunction(&Neighbors::Purge, this);
@@ -40,26 +60,17 @@ bool
 Neighbors::IsNeighbor(Ipv4Address addr)
 {
     Purge();
-    for (auto i = m_nb.begin(); i != m_nb.end(); ++i)
-    {
-        if (i->m_neighborAddress == addr)
-        {
-            return true;
-        }
-    }
-    return false;
+    return Find(addr) != nullptr;
 }
 
 Time
 Neighbors::GetExpireTime(Ipv4Address addr)
 {
     Purge();
-    for (auto i = m_nb.begin(); i != m_nb.end(); ++i)
+    Neighbor* nb = Find(addr);
+    if (nb != nullptr)
     {
-        if (i->m_neighborAddress == addr)
-        {
-            return (i->m_expireTime - Simulator::Now());
-        }
+        return (nb->m_expireTime - Simulator::Now());
     }
     return Time(0);
 }
@@ -67,25 +78,74 @@ Neighbors::GetExpireTime(Ipv4Address addr)
 void
 Neighbors::Update(Ipv4Address addr, Time expire)
 {
-    for (auto i = m_nb.begin(); i != m_nb.end(); ++i)
+    Neighbor* nb = Find(addr);
+    if (nb != nullptr)
     {
-        if (i->m_neighborAddress == addr)
+        nb->m_expireTime = std::max(expire + Simulator::Now(), nb->m_expireTime);
+        if (nb->m_hardwareAddress == Mac48Address())
         {
-            i->m_expireTime = std::max(expire + Simulator::Now(), i->m_expireTime);
-            if (i->m_hardwareAddress == Mac48Address())
-            {
-                i->m_hardwareAddress = LookupMacAddress(i->m_neighborAddress);
-            }
-            return;
+            nb->m_hardwareAddress = LookupMacAddress(nb->m_neighborAddress);
+            IndexMacAddress(nb - m_nb.data());
         }
+        return;
     }
 
     NS_LOG_LOGIC("Open link to " << addr);
     Neighbor neighbor(addr, LookupMacAddress(addr), expire + Simulator::Now());
     m_nb.push_back(neighbor);
+    IndexMacAddress(m_nb.size() - 1);
     Purge();
 }
 
+Neighbors::Neighbor*
+Neighbors::Find(Ipv4Address addr)
+{
+    return const_cast<Neighbor*>(static_cast<const Neighbors*>(this)->Find(addr));
+}
+
+const Neighbors::Neighbor*
+Neighbors::Find(Ipv4Address addr) const
+{
+    for (auto i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            return &*i;
+        }
+    }
+    return nullptr;
+}
+
+void
+Neighbors::IndexMacAddress(uint32_t i)
+{
+    if (m_nb[i].m_hardwareAddress != Mac48Address())
+    {
+        m_macAddresses[MacKey(m_nb[i].m_hardwareAddress)] = i;
+    }
+}
+
+Ipv4Address
+Neighbors::UpdateDeliveryRatio(Mac48Address hwaddr, bool success)
+{
+    auto it = m_macAddresses.find(MacKey(hwaddr));
+    if (it == m_macAddresses.end())
+    {
+        return Ipv4Address();
+    }
+    Neighbor* nb = &m_nb[it->second];
+    nb->m_deliveryRatio = (1 - m_deliveryRatioWeight) * nb->m_deliveryRatio +
+                          m_deliveryRatioWeight * (success ? 1.0 : 0.0);
+    return nb->m_neighborAddress;
+}
+
+double
+Neighbors::GetDeliveryRatio(Ipv4Address addr) const
+{
+    const Neighbor* nb = Find(addr);
+    return nb != nullptr ? nb->m_deliveryRatio : 1.0;
+}
+
 /**
  * @brief CloseNeighbor structure
  */
@@ -123,7 +183,17 @@ Neighbors::Purge()
             }
         }
     }
-    m_nb.erase(std::remove_if(m_nb.begin(), m_nb.end(), pred), m_nb.end());
+    auto end = std::remove_if(m_nb.begin(), m_nb.end(), pred);
+    if (end != m_nb.end())
+    {
+        // The neighbors left moved, so index their MAC addresses anew
+        m_nb.erase(end, m_nb.end());
+        m_macAddresses.clear();
+        for (uint32_t i = 0; i < m_nb.size(); ++i)
+        {
+            IndexMacAddress(i);
+        }
+    }
     m_ntimer.Cancel();
     m_ntimer.Schedule();
 }
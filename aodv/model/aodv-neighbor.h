@@ -23,6 +23,7 @@
 #include "ns3/simulator.h"
 #include "ns3/timer.h"
 
+#include <unordered_map>
 #include <vector>
 
 namespace ns3
@@ -59,6 +60,8 @@ class Neighbors
         Time m_expireTime;
         /// Neighbor close indicator
         bool close;
+        /// Moving average of the share of unicast frames to the neighbor acknowledged
+        double m_deliveryRatio;
 
         /**
          * @brief Neighbor structure constructor
@@ -71,7 +74,8 @@ class Neighbors
             : m_neighborAddress(ip),
               m_hardwareAddress(mac),
               m_expireTime(t),
-              close(false)
+              close(false),
+              m_deliveryRatio(1.0)
         {
         }
     };
@@ -99,10 +103,20 @@ class Neighbors
     /// Schedule m_ntimer.
     void ScheduleTimer();
 
+    /**
+     * Get the neighbor entries, including expired ones not purged yet
+     * @returns the entries
+     */
+    const std::vector<Neighbor>& GetNeighbors() const
+    {
+        return m_nb;
+    }
+
     /// Remove all entries
     void Clear()
     {
         m_nb.clear();
+        m_macAddresses.clear();
     }
 
     /**
@@ -116,6 +130,42 @@ class Neighbors
      */
     void DelArpCache(Ptr<ArpCache> a);
 
+    /**
+     * Fold the outcome of a unicast frame into the delivery ratio of the
+     * neighbor it was sent to, an exponentially weighted moving average.
+     * The neighbor is found through its MAC address in constant time.
+     * @param hwaddr the MAC address the frame was sent to
+     * @param success whether the frame was acknowledged
+     * @returns the IP address of the neighbor, or Ipv4Address() if hwaddr is
+     *          not the address of a neighbor
+     */
+    Ipv4Address UpdateDeliveryRatio(Mac48Address hwaddr, bool success);
+    /**
+     * Get the delivery ratio of a neighbor
+     * @param addr the IP address of the neighbor
+     * @returns the share of frames to the neighbor acknowledged, 1 if addr is
+     *          not a neighbor
+     */
+    double GetDeliveryRatio(Ipv4Address addr) const;
+
+    /**
+     * Set the weight of a frame in the delivery ratios
+     * @param weight the weight, 0 to 1
+     */
+    void SetDeliveryRatioWeight(double weight)
+    {
+        m_deliveryRatioWeight = weight;
+    }
+
+    /**
+     * Get the weight of a frame in the delivery ratios
+     * @returns the weight
+     */
+    double GetDeliveryRatioWeight() const
+    {
+        return m_deliveryRatioWeight;
+    }
+
     /**
      * Get callback to ProcessTxError
      * @returns the callback function
@@ -154,7 +204,28 @@ class Neighbors
     std::vector<Neighbor> m_nb;
     /// list of ARP cached to be used for layer 2 notifications processing
     std::vector<Ptr<ArpCache>> m_arp;
+    /// Position in m_nb of the neighbor with each MAC address known
+    std::unordered_map<uint64_t, uint32_t> m_macAddresses;
+    /// Weight of a frame in the delivery ratios
+    double m_deliveryRatioWeight;
 
+    /**
+     * Find a neighbor
+     * @param addr the IP address of the neighbor
+     * @returns the entry of addr in m_nb, or nullptr
+     */
+    Neighbor* Find(Ipv4Address addr);
+    /**
+     * Find a neighbor
+     * @param addr the IP address of the neighbor
+     * @returns the entry of addr in m_nb, or nullptr
+     */
+    const Neighbor* Find(Ipv4Address addr) const;
+    /**
+     * Record the MAC address of a neighbor in m_macAddresses
+     * @param i the position of the neighbor in m_nb
+     */
+    void IndexMacAddress(uint32_t i);
     /**
      * Find MAC address by IP using list of ARP caches
      *
@@ -164,7 +164,7 @@ RreqHeader::GetInstanceTypeId() const
 uint32_t
 RreqHeader::GetSerializedSize() const
 {
-    return 23;
+    return GetMultipath() ? 27 : 23;
 }
 
 void
@@ -178,6 +178,10 @@ RreqHeader::Serialize(Buffer::Iterator i) const
     i.WriteHtonU32(m_dstSeqNo);
     WriteTo(i, m_origin);
     i.WriteHtonU32(m_originSeqNo);
+    if (GetMultipath())
+    {
+        WriteTo(i, m_firstHop);
+    }
 }
 
 uint32_t
@@ -192,6 +196,11 @@ RreqHeader::Deserialize(Buffer::Iterator start)
     m_dstSeqNo = i.ReadNtohU32();
     ReadFrom(i, m_origin);
     m_originSeqNo = i.ReadNtohU32();
+    m_firstHop = Ipv4Address();
+    if (GetMultipath())
+    {
+        ReadFrom(i, m_firstHop);
+    }
 
     uint32_t dist = i.GetDistanceFrom(start);
     NS_ASSERT(dist == GetSerializedSize());
@@ -206,6 +215,10 @@ RreqHeader::Print(std::ostream& os) const
        << " flags:"
        << " Gratuitous RREP " << (*this).GetGratuitousRrep() << " Destination only "
        << (*this).GetDestinationOnly() << " Unknown sequence number " << (*this).GetUnknownSeqno();
+    if (GetMultipath())
+    {
+        os << " first hop " << m_firstHop;
+    }
 }
 
 std::ostream&
@@ -272,12 +285,32 @@ RreqHeader::GetUnknownSeqno() const
     return (m_flags & (1 << 3));
 }
 
+void
+RreqHeader::SetMultipath(bool f)
+{
+    if (f)
+    {
+        m_flags |= (1 << 2);
+    }
+    else
+    {
+        m_flags &= ~(1 << 2);
+    }
+}
+
+bool
+RreqHeader::GetMultipath() const
+{
+    return (m_flags & (1 << 2));
+}
+
 bool
 RreqHeader::operator==(const RreqHeader& o) const
 {
     return (m_flags == o.m_flags && m_reserved == o.m_reserved && m_hopCount == o.m_hopCount &&
             m_requestID == o.m_requestID && m_dst == o.m_dst && m_dstSeqNo == o.m_dstSeqNo &&
-            m_origin == o.m_origin && m_originSeqNo == o.m_originSeqNo);
+            m_origin == o.m_origin && m_originSeqNo == o.m_originSeqNo &&
+            m_firstHop == o.m_firstHop);
 }
 
 //-----------------------------------------------------------------------------
@@ -321,7 +354,7 @@ RrepHeader::GetInstanceTypeId() const
 uint32_t
 RrepHeader::GetSerializedSize() const
 {
-    return 19;
+    return GetMultipath() ? 23 : 19;
 }
 
 void
@@ -334,6 +367,10 @@ RrepHeader::Serialize(Buffer::Iterator i) const
     i.WriteHtonU32(m_dstSeqNo);
     WriteTo(i, m_origin);
     i.WriteHtonU32(m_lifeTime);
+    if (GetMultipath())
+    {
+        WriteTo(i, m_firstHop);
+    }
 }
 
 uint32_t
@@ -348,6 +385,11 @@ RrepHeader::Deserialize(Buffer::Iterator start)
     m_dstSeqNo = i.ReadNtohU32();
     ReadFrom(i, m_origin);
     m_lifeTime = i.ReadNtohU32();
+    m_firstHop = Ipv4Address();
+    if (GetMultipath())
+    {
+        ReadFrom(i, m_firstHop);
+    }
 
     uint32_t dist = i.GetDistanceFrom(start);
     NS_ASSERT(dist == GetSerializedSize());
@@ -364,6 +406,10 @@ RrepHeader::Print(std::ostream& os) const
     }
     os << " source ipv4 " << m_origin << " lifetime " << m_lifeTime
        << " acknowledgment required flag " << (*this).GetAckRequired();
+    if (GetMultipath())
+    {
+        os << " first hop " << m_firstHop;
+    }
 }
 
 void
@@ -398,6 +444,25 @@ RrepHeader::GetAckRequired() const
     return (m_flags & (1 << 6));
 }
 
+void
+RrepHeader::SetMultipath(bool f)
+{
+    if (f)
+    {
+        m_flags |= (1 << 5);
+    }
+    else
+    {
+        m_flags &= ~(1 << 5);
+    }
+}
+
+bool
+RrepHeader::GetMultipath() const
+{
+    return (m_flags & (1 << 5));
+}
+
 void
 RrepHeader::SetPrefixSize(uint8_t sz)
 {
@@ -415,7 +480,7 @@ RrepHeader::operator==(const RrepHeader& o) const
 {
     return (m_flags == o.m_flags && m_prefixSize == o.m_prefixSize && m_hopCount == o.m_hopCount &&
             m_dst == o.m_dst && m_dstSeqNo == o.m_dstSeqNo && m_origin == o.m_origin &&
-            m_lifeTime == o.m_lifeTime);
+            m_lifeTime == o.m_lifeTime && m_firstHop == o.m_firstHop);
 }
 
 void
@@ -298,6 +298,36 @@ class RreqHeader : public Header
      * @return the unknown sequence number flag
      */
     bool GetUnknownSeqno() const;
+    /**
+     * @brief Set the multipath flag. A RREQ with the flag set carries the
+     * first hop of the path it travels, in 4 more bytes (see SetFirstHop()).
+     * @param f the multipath flag
+     */
+    void SetMultipath(bool f);
+    /**
+     * @brief Get the multipath flag
+     * @return the multipath flag
+     */
+    bool GetMultipath() const;
+
+    /**
+     * @brief Set the first hop: the neighbor of the originator that relayed
+     * this copy of the RREQ first, Ipv4Address() before it is relayed
+     * @param a the first hop address
+     */
+    void SetFirstHop(Ipv4Address a)
+    {
+        m_firstHop = a;
+    }
+
+    /**
+     * @brief Get the first hop
+     * @return the first hop address
+     */
+    Ipv4Address GetFirstHop() const
+    {
+        return m_firstHop;
+    }
 
     /**
      * @brief Comparison operator
@@ -307,7 +337,7 @@ class RreqHeader : public Header
     bool operator==(const RreqHeader& o) const;
 
   private:
-    uint8_t m_flags;        ///< |J|R|G|D|U| bit flags, see RFC
+    uint8_t m_flags;        ///< |J|R|G|D|U| bit flags, see RFC, and M for multipath
     uint8_t m_reserved;     ///< Not used (must be 0)
     uint8_t m_hopCount;     ///< Hop Count
     uint32_t m_requestID;   ///< RREQ ID
@@ -315,6 +345,7 @@ class RreqHeader : public Header
     uint32_t m_dstSeqNo;    ///< Destination Sequence Number
     Ipv4Address m_origin;   ///< Originator IP Address
     uint32_t m_originSeqNo; ///< Source Sequence Number
+    Ipv4Address m_firstHop; ///< First hop, sent with the multipath flag only
 };
 
 /**
@@ -468,6 +499,36 @@ class RrepHeader : public Header
      * @return the ack required flag
      */
     bool GetAckRequired() const;
+    /**
+     * @brief Set the multipath flag. A RREP with the flag set carries the
+     * first hop of the path it travels, in 4 more bytes (see SetFirstHop()).
+     * @param f the multipath flag
+     */
+    void SetMultipath(bool f);
+    /**
+     * @brief Get the multipath flag
+     * @return the multipath flag
+     */
+    bool GetMultipath() const;
+    /**
+     * @brief Set the first hop: the neighbor of the destination that relayed
+     * this RREP first, Ipv4Address() before it is relayed
+     * @param a the first hop address
+     */
+    void SetFirstHop(Ipv4Address a)
+    {
+        m_firstHop = a;
+    }
+
+    /**
+     * @brief Get the first hop
+     * @return the first hop address
+     */
+    Ipv4Address GetFirstHop() const
+    {
+        return m_firstHop;
+    }
+
     /**
      * @brief Set the prefix size
      * @param sz the prefix size
@@ -496,13 +557,14 @@ class RrepHeader : public Header
     bool operator==(const RrepHeader& o) const;
 
   private:
-    uint8_t m_flags;      ///< A - acknowledgment required flag
-    uint8_t m_prefixSize; ///< Prefix Size
-    uint8_t m_hopCount;   ///< Hop Count
-    Ipv4Address m_dst;    ///< Destination IP Address
-    uint32_t m_dstSeqNo;  ///< Destination Sequence Number
-    Ipv4Address m_origin; ///< Source IP Address
-    uint32_t m_lifeTime;  ///< Lifetime (in milliseconds)
+    uint8_t m_flags;        ///< A - acknowledgment required flag, M - multipath flag
+    uint8_t m_prefixSize;   ///< Prefix Size
+    uint8_t m_hopCount;     ///< Hop Count
+    Ipv4Address m_dst;      ///< Destination IP Address
+    uint32_t m_dstSeqNo;    ///< Destination Sequence Number
+    Ipv4Address m_origin;   ///< Source IP Address
+    uint32_t m_lifeTime;    ///< Lifetime (in milliseconds)
+    Ipv4Address m_firstHop; ///< First hop, sent with the multipath flag only
 };
 
 /**
@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "aodv-path-scorer.h"
+
+#include "aodv-rtable.h"
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("AodvPathScorer");
+
+namespace aodv
+{
+
+double
+PathScoreBatch::ScoreOne(const WeightFactors& weights,
+                         double hopCount,
+                         double residualEnergy,
+                         double rssi,
+                         double stability)
+{
+    // Fewer hops score higher
+    double hopScore = 1.0 / (1.0 + hopCount);
+    // Map -100 dBm to -30 dBm onto 0 to 1
+    double rssiScore = std::max(0.0, std::min(1.0, (rssi + 100.0) / 70.0));
+    // The kernels below add the terms in this order too
+    return weights.hopWeight * hopScore + weights.energyWeight * residualEnergy +
+           weights.rssiWeight * rssiScore + weights.stabilityWeight * stability;
+}
+
+uint32_t
+PathScoreBatch::Allocate()
+{
+    if (!m_free.empty())
+    {
+        uint32_t row = m_free.back();
+        m_free.pop_back();
+        return row;
+    }
+    m_hops.push_back(0);
+    m_energy.push_back(0);
+    m_rssi.push_back(0);
+    m_stability.push_back(0);
+    m_scores.push_back(0);
+    return m_hops.size() - 1;
+}
+
+void
+PathScoreBatch::Release(uint32_t row)
+{
+    NS_ASSERT(row < m_hops.size());
+    m_free.push_back(row);
+}
+
+void
+PathScoreBatch::Clear()
+{
+    m_hops.clear();
+    m_energy.clear();
+    m_rssi.clear();
+    m_stability.clear();
+    m_scores.clear();
+    m_free.clear();
+}
+
+double
+PathScoreBatch::ScoreRow(uint32_t row, const WeightFactors& weights)
+{
+    m_scores[row] = ScoreOne(weights, m_hops[row], m_energy[row], m_rssi[row], m_stability[row]);
+    return m_scores[row];
+}
+
+void
+PathScoreBatch::Score(const WeightFactors& weights)
+{
+    NS_LOG_FUNCTION(this << m_hops.size());
+    // Released rows are scored too, which is cheaper than skipping them
+    const size_t n = m_hops.size();
+    const double* hops = m_hops.data();
+    const double* energy = m_energy.data();
+    const double* rssi = m_rssi.data();
+    const double* stability = m_stability.data();
+    double* scores = m_scores.data();
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d offset = _mm256_set1_pd(100.0);
+    const __m256d range = _mm256_set1_pd(70.0);
+    const __m256d wh = _mm256_set1_pd(weights.hopWeight);
+    const __m256d we = _mm256_set1_pd(weights.energyWeight);
+    const __m256d wr = _mm256_set1_pd(weights.rssiWeight);
+    const __m256d ws = _mm256_set1_pd(weights.stabilityWeight);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d hop = _mm256_div_pd(one, _mm256_add_pd(one, _mm256_loadu_pd(hops + i)));
+        __m256d r = _mm256_div_pd(_mm256_add_pd(_mm256_loadu_pd(rssi + i), offset), range);
+        r = _mm256_max_pd(_mm256_min_pd(r, one), zero);
+        __m256d score = _mm256_add_pd(_mm256_mul_pd(wh, hop),
+                                      _mm256_mul_pd(we, _mm256_loadu_pd(energy + i)));
+        score = _mm256_add_pd(score, _mm256_mul_pd(wr, r));
+        score = _mm256_add_pd(score, _mm256_mul_pd(ws, _mm256_loadu_pd(stability + i)));
+        _mm256_storeu_pd(scores + i, score);
+    }
+#elif defined(__SSE2__)
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d offset = _mm_set1_pd(100.0);
+    const __m128d range = _mm_set1_pd(70.0);
+    const __m128d wh = _mm_set1_pd(weights.hopWeight);
+    const __m128d we = _mm_set1_pd(weights.energyWeight);
+    const __m128d wr = _mm_set1_pd(weights.rssiWeight);
+    const __m128d ws = _mm_set1_pd(weights.stabilityWeight);
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128d hop = _mm_div_pd(one, _mm_add_pd(one, _mm_loadu_pd(hops + i)));
+        __m128d r = _mm_div_pd(_mm_add_pd(_mm_loadu_pd(rssi + i), offset), range);
+        r = _mm_max_pd(_mm_min_pd(r, one), zero);
+        __m128d score =
+            _mm_add_pd(_mm_mul_pd(wh, hop), _mm_mul_pd(we, _mm_loadu_pd(energy + i)));
+        score = _mm_add_pd(score, _mm_mul_pd(wr, r));
+        score = _mm_add_pd(score, _mm_mul_pd(ws, _mm_loadu_pd(stability + i)));
+        _mm_storeu_pd(scores + i, score);
+    }
+#endif
+    // The rows left over by the kernel, or all of them without SIMD
+    for (; i < n; ++i)
+    {
+        scores[i] = ScoreOne(weights, hops[i], energy[i], rssi[i], stability[i]);
+    }
+}
+
+} // namespace aodv
+} // namespace ns3
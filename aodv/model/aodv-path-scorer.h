@@ -0,0 +1,132 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_PATH_SCORER_H
+#define AODV_PATH_SCORER_H
+
+#include <limits>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+namespace aodv
+{
+
+struct WeightFactors;
+
+/**
+ * @ingroup aodv
+ * @brief Metrics and composite scores of the multipath paths of a node, as a
+ * structure of arrays.
+ *
+ * Each path holds a row, one column per metric. The routing table keeps the
+ * rows of its paths up to date as their metrics change, so that when the
+ * weights of the score change, Score() rescores every path in one pass of a
+ * SIMD kernel: four paths per instruction with AVX, two with SSE2, one
+ * otherwise. The instruction set is the one the module is compiled for.
+ * ScoreRow() rescores a single path with the scalar code, which every
+ * kernel matches operation for operation.
+ */
+class PathScoreBatch
+{
+  public:
+    /// No row
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * Score one path: the weighted sum of 1 / (1 + hopCount), the residual
+     * energy, the mapped RSSI and the stability
+     * @param weights the weights of the score
+     * @param hopCount the hop count of the path
+     * @param residualEnergy the residual energy, 0 to 1
+     * @param rssi the RSSI, dBm; -100 to -30 dBm is mapped onto 0 to 1
+     * @param stability the stability, 0 to 1
+     * @returns the composite score
+     */
+    static double ScoreOne(const WeightFactors& weights,
+                           double hopCount,
+                           double residualEnergy,
+                           double rssi,
+                           double stability);
+
+    /**
+     * Take a row for a path, reusing a released one if any
+     * @returns the row
+     */
+    uint32_t Allocate();
+    /**
+     * Give back the row of a path that went away
+     * @param row the row
+     */
+    void Release(uint32_t row);
+    /// Release all rows, keeping the storage
+    void Clear();
+
+    /**
+     * Store the metrics of a path
+     * @param row the row of the path
+     * @param hopCount the hop count
+     * @param residualEnergy the residual energy, 0 to 1
+     * @param rssi the RSSI, dBm
+     * @param stability the stability, 0 to 1
+     */
+    void Set(uint32_t row, uint32_t hopCount, double residualEnergy, double rssi, double stability)
+    {
+        m_hops[row] = hopCount;
+        m_energy[row] = residualEnergy;
+        m_rssi[row] = rssi;
+        m_stability[row] = stability;
+    }
+
+    /**
+     * Score one row with the scalar code
+     * @param row the row
+     * @param weights the weights of the score
+     * @returns the score, also returned by GetScore() from now on
+     */
+    double ScoreRow(uint32_t row, const WeightFactors& weights);
+    /**
+     * Score all rows in one pass
+     * @param weights the weights of the score
+     */
+    void Score(const WeightFactors& weights);
+    /**
+     * @param row a row
+     * @returns the score of the row computed last
+     */
+    double GetScore(uint32_t row) const
+    {
+        return m_scores[row];
+    }
+
+    /// @returns the number of rows, in use or released
+    size_t GetSize() const
+    {
+        return m_hops.size();
+    }
+    /// @returns the number of rows in use
+    size_t GetUsed() const
+    {
+        return m_hops.size() - m_free.size();
+    }
+
+  private:
+    /// @name Metric columns, one row per path
+    //\{
+    std::vector<double> m_hops;      //!< Hop counts
+    std::vector<double> m_energy;    //!< Residual energies
+    std::vector<double> m_rssi;      //!< RSSIs, dBm
+    std::vector<double> m_stability; //!< Stabilities
+    //\}
+    /// Scores computed by Score() and ScoreRow()
+    std::vector<double> m_scores;
+    /// Released rows
+    std::vector<uint32_t> m_free;
+};
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_PATH_SCORER_H */
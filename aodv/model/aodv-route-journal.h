@@ -0,0 +1,172 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_ROUTE_JOURNAL_H
+#define AODV_ROUTE_JOURNAL_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+namespace aodv
+{
+
+/// Kind of change recorded in a RouteJournal
+enum RouteEventType : uint8_t
+{
+    ROUTE_ADDED,            //!< A route was added
+    ROUTE_UPDATED,          //!< A route was updated and kept its next hop
+    ROUTE_NEXT_HOP_CHANGED, //!< A route was updated to another next hop
+    ROUTE_INVALIDATED,      //!< A valid route was invalidated, e.g. by a RERR
+    ROUTE_EXPIRED,          //!< A valid route was invalidated because its lifetime ran out
+    ROUTE_DELETED,          //!< A route was removed from the table
+};
+
+/// One change of a routing table
+struct RouteEvent
+{
+    Time time;           //!< Simulation time of the change
+    Ipv4Address dst;     //!< Destination of the route
+    Ipv4Address nextHop; //!< Next hop of the route after the change, before it for ROUTE_DELETED
+    RouteEventType type; //!< Kind of change
+};
+
+/**
+ * @ingroup aodv
+ * @brief Bounded log of the changes of a routing table.
+ *
+ * Events are numbered from 0 in the order they are recorded. The journal keeps
+ * the last GetCapacity() of them in a ring buffer, so a consumer that holds a
+ * cursor (the number of the next event it wants) can catch up on what changed
+ * with Read() instead of scanning the table. If it falls behind by more than
+ * the capacity, IsLost() tells it to rescan the table once and resume from
+ * GetHead().
+ */
+class RouteJournal
+{
+  public:
+    RouteJournal()
+        : m_capacity(0),
+          m_base(0),
+          m_first(0),
+          m_next(0)
+    {
+    }
+
+    /**
+     * Set the number of events kept. Events already recorded are forgotten.
+     * @param capacity the number of events, 0 to record nothing
+     */
+    void SetCapacity(uint32_t capacity)
+    {
+        m_capacity = capacity;
+        m_events.clear();
+        m_events.shrink_to_fit();
+        m_base = m_next;
+        m_first = m_next;
+    }
+
+    /// @returns the number of events kept
+    uint32_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+     * Record an event at the current simulation time
+     * @param type the kind of change
+     * @param dst the destination of the route
+     * @param nextHop the next hop of the route
+     */
+    void Record(RouteEventType type, Ipv4Address dst, Ipv4Address nextHop)
+    {
+        if (m_capacity == 0)
+        {
+            return;
+        }
+        RouteEvent event = {Simulator::Now(), dst, nextHop, type};
+        // The buffer grows up to the capacity, then the oldest event is overwritten
+        if (m_events.size() < m_capacity)
+        {
+            m_events.push_back(event);
+        }
+        else
+        {
+            m_events[(m_next - m_base) % m_capacity] = event;
+            if (m_next - m_first == m_capacity)
+            {
+                ++m_first;
+            }
+        }
+        ++m_next;
+    }
+
+    /// @returns the number of the next event to be recorded
+    uint64_t GetHead() const
+    {
+        return m_next;
+    }
+
+    /// @returns the number of the oldest event kept
+    uint64_t GetTail() const
+    {
+        return m_first;
+    }
+
+    /**
+     * @param cursor the number of the next event a consumer wants
+     * @returns true if some events from cursor on have been overwritten
+     */
+    bool IsLost(uint64_t cursor) const
+    {
+        return cursor < m_first;
+    }
+
+    /**
+     * Call fn(event) for each event kept from cursor on, oldest first
+     * @param cursor the number of the first event wanted
+     * @param fn callable taking a const RouteEvent&. It must not record events.
+     * @returns the cursor to pass to the next call
+     */
+    template <typename F>
+    uint64_t Read(uint64_t cursor, F fn) const
+    {
+        for (uint64_t seq = cursor < m_first ? m_first : cursor; seq < m_next; ++seq)
+        {
+            fn(m_events[(seq - m_base) % m_capacity]);
+        }
+        return m_next;
+    }
+
+    /**
+     * Forget all events. The numbering skips one event, so that IsLost() is
+     * true for every cursor taken before.
+     */
+    void Clear()
+    {
+        m_events.clear();
+        m_base = m_first = ++m_next;
+    }
+
+  private:
+    /// Maximum number of events kept
+    uint32_t m_capacity;
+    /// Number of the event stored first since the capacity was set
+    uint64_t m_base;
+    /// Number of the oldest event kept
+    uint64_t m_first;
+    /// Number of the next event
+    uint64_t m_next;
+    /// Events, event n at (n - m_base) % m_capacity
+    std::vector<RouteEvent> m_events;
+};
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_ROUTE_JOURNAL_H */
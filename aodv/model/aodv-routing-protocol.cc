@@ -20,9 +20,12 @@
     }
 
 #include "aodv-routing-protocol.h"
+#include "aodv-state-io.h"
 
 #include "ns3/adhoc-wifi-mac.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
@@ -130,6 +133,98 @@ class DeferredRouteOutputTag : public Tag
 
 NS_OBJECT_ENSURE_REGISTERED(DeferredRouteOutputTag);
 
+/**
+ * @ingroup aodv
+ * @brief Tag used by AODV to recognize the data packets it routed when the
+ * MAC reports their transmission outcome.
+ *
+ * The AODV messages, all sent to the AODV port by RoutingProtocol::SendTo(),
+ * carry the tag with no destination, so that they are never counted.
+ */
+class RoutedDataTag : public Tag
+{
+  public:
+    /**
+     * @brief Constructor
+     * @param dst the IP destination of the packet, none for an AODV message
+     */
+    RoutedDataTag(Ipv4Address dst = Ipv4Address())
+        : Tag(),
+          m_dst(dst)
+    {
+    }
+
+    /**
+     * @brief Get the type ID.
+     * @return the object TypeId
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::aodv::RoutedDataTag")
+                                .SetParent<Tag>()
+                                .SetGroupName("Aodv")
+                                .AddConstructor<RoutedDataTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    /**
+     * @brief Get the IP destination of the packet
+     * @return the destination
+     */
+    Ipv4Address GetDestination() const
+    {
+        return m_dst;
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return sizeof(uint32_t);
+    }
+
+    void Serialize(TagBuffer i) const override
+    {
+        i.WriteU32(m_dst.Get());
+    }
+
+    void Deserialize(TagBuffer i) override
+    {
+        m_dst.Set(i.ReadU32());
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "RoutedDataTag: destination = " << m_dst;
+    }
+
+  private:
+    /// IP destination of the packet
+    Ipv4Address m_dst;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RoutedDataTag);
+
+/**
+ * Tag a packet routed to dst as data, unless it already is or is an AODV
+ * message: the tag stays on the packet from hop to hop, with the same
+ * destination
+ * @param p the packet
+ * @param dst the IP destination of the packet
+ */
+static void
+TagRoutedData(Ptr<const Packet> p, Ipv4Address dst)
+{
+    RoutedDataTag tag(dst);
+    if (!p->PeekPacketTag(tag))
+    {
+        p->AddPacketTag(tag);
+    }
+}
+
 //
 RoutingProtocol::RoutingProtocol()
     : m_rreqRetries(2),
@@ -172,7 +267,14 @@ RoutingProtocol::RoutingProtocol()
 {
     // =============== PENAMBAHAN BLE-MAODV INITIALIZATION ===============
     m_multipathEnabled = false;
+    m_multipathForwarding = SINGLE_PATH;
+    m_multipathFailover = false;
+    m_multipathDiscovery = false;
+    m_multipathReplies = 3;
     m_residualEnergy = 1.0; // Start with full energy
+    m_switchDwell = Seconds(1);
+    m_rerankScheduled = false;
+    m_journalCursor = 0;
     
     // Initialize network context dengan default values
     m_networkContext.nodeDensity = 0.5;
@@ -182,14 +284,16 @@ RoutingProtocol::RoutingProtocol()
     
     // Calculate initial weights
     m_currentWeights = m_weightCalculator.CalculateWeights(m_networkContext);
+    m_routingTable.SetMultipathWeights(m_currentWeights);
     
     // Initialize BLE-MAODV timers
     m_metricsUpdateTimer.SetFunction(&RoutingProtocol::MetricsUpdateTimerExpire, this);
-    m_pathQualityTimer.SetFunction(&RoutingProtocol::PathQualityTimerExpire, this);
     
     // Start periodic updates (every 5 seconds)
     m_metricsUpdateTimer.Schedule(Seconds(5));
-    m_pathQualityTimer.Schedule(Seconds(3));
+    // Preemptive switching runs when the ranking of some paths changes
+    m_routingTable.SetMultipathRerankCallback(
+        MakeCallback(&RoutingProtocol::NotifyMultipathRerank, this));
     // =============== END BLE-MAODV INITIALIZATION ===============
     m_nb.SetCallback(MakeCallback(&RoutingProtocol::SendRerrWhenBreaksLinkToNextHop, this));
 }
@@ -343,6 +447,94 @@ RoutingProtocol::GetTypeId()
                           MakeBooleanAccessor(&RoutingProtocol::SetBroadcastEnable,
                                               &RoutingProtocol::GetBroadcastEnable),
                           MakeBooleanChecker())
+            .AddAttribute("CompactRoutingTable",
+                          "Store the routing table as a structure of arrays, which takes much "
+                          "less memory per route. Ipv4Route objects are then rebuilt on "
+                          "lookup, and lifetimes are kept in milliseconds.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::SetCompactRoutingTable,
+                                              &RoutingProtocol::GetCompactRoutingTable),
+                          MakeBooleanChecker())
+            .AddAttribute("MultipathForwarding",
+                          "How data packets are spread over the multipath routes: over the "
+                          "routing table next hop only, packet by packet in proportion to the "
+                          "path scores, or flow by flow in proportion to the path scores, "
+                          "with FlowPinned keeping each flow on its path until the path goes "
+                          "away.",
+                          EnumValue(SINGLE_PATH),
+                          MakeEnumAccessor<MultipathSelection>(
+                              &RoutingProtocol::m_multipathForwarding),
+                          MakeEnumChecker(SINGLE_PATH,
+                                          "SinglePath",
+                                          WEIGHTED_ROUND_ROBIN,
+                                          "WeightedRoundRobin",
+                                          FLOW_HASH,
+                                          "FlowHash",
+                                          FLOW_PINNED,
+                                          "FlowPinned"))
+            .AddAttribute("MaxPinnedFlows",
+                          "Number of flows the FlowPinned multipath forwarding keeps pinned "
+                          "to a path.",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&RoutingProtocol::SetMaxPinnedFlows,
+                                               &RoutingProtocol::GetMaxPinnedFlows),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("FlowIdleTimeout",
+                          "Time after which a flow without packets is unpinned.",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&RoutingProtocol::SetFlowIdleTimeout,
+                                           &RoutingProtocol::GetFlowIdleTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("MultipathFailover",
+                          "Whether a route whose next hop breaks moves to its best multipath "
+                          "route left, instead of being invalidated and reported in a RERR.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_multipathFailover),
+                          MakeBooleanChecker())
+            .AddAttribute("MultipathDiscovery",
+                          "Whether route discovery looks for link-disjoint multipath routes, "
+                          "as AOMDV does: the destination answers the RREQ copies that came "
+                          "over disjoint paths, instead of the first one only.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_multipathDiscovery),
+                          MakeBooleanChecker())
+            .AddAttribute("MultipathReplies",
+                          "Maximum number of RREQ copies a destination answers with "
+                          "MultipathDiscovery.",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&RoutingProtocol::m_multipathReplies),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("PreemptiveSwitchMargin",
+                          "Composite score by which an alternate multipath route must beat the "
+                          "one in use before the route switches to it.",
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&RoutingProtocol::SetPreemptiveSwitchMargin,
+                                             &RoutingProtocol::GetPreemptiveSwitchMargin),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("PreemptiveSwitchDwell",
+                          "Time for which an alternate multipath route must keep beating the "
+                          "one in use by PreemptiveSwitchMargin before the route switches to it.",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&RoutingProtocol::m_switchDwell),
+                          MakeTimeChecker())
+            .AddAttribute("RouteJournalSize",
+                          "Number of routing table changes kept for consumers that catch up on "
+                          "the changes instead of scanning the table (see RouteJournal). The "
+                          "preemptive route switch reads them to restart the lead of the "
+                          "alternate paths whose route moved or broke; if more changes happen "
+                          "between two of its runs, it restarts every lead.",
+                          UintegerValue(64),
+                          MakeUintegerAccessor(&RoutingProtocol::SetRouteJournalSize,
+                                               &RoutingProtocol::GetRouteJournalSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("DeliveryRatioWeight",
+                          "Weight of the outcome of a unicast frame, acknowledged or not by the "
+                          "MAC, in the moving averages of the delivery ratio of its neighbor and "
+                          "of the stability of its multipath path.",
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&RoutingProtocol::SetDeliveryRatioWeight,
+                                             &RoutingProtocol::GetDeliveryRatioWeight),
+                          MakeDoubleChecker<double>(0, 1))
             .AddAttribute("UniformRv",
                           "Access to the underlying UniformRandomVariable",
                           StringValue("ns3::UniformRandomVariable"),
@@ -385,6 +577,12 @@ RoutingProtocol::DoDispose()
         iter->first->Close();
     }
     m_socketSubnetBroadcastAddresses.clear();
+    m_rerankEvent.Cancel();
+    for (auto& candidate : m_switchCandidates)
+    {
+        candidate.second.check.Cancel();
+    }
+    m_switchCandidates.clear();
     Ipv4RoutingProtocol::DoDispose();
 }
 
@@ -408,6 +606,151 @@ RoutingProtocol::AssignStreams(int64_t stream)
     return 1;
 }
 
+void
+RoutingProtocol::SaveState(std::ostream& os) const
+{
+    NS_LOG_FUNCTION(this);
+    std::vector<RoutingTableEntry> routes;
+    m_routingTable.GetRoutes(routes);
+    routes.erase(std::remove_if(routes.begin(),
+                                routes.end(),
+                                [](const RoutingTableEntry& rt) {
+                                    return rt.GetFlag() == IN_SEARCH;
+                                }),
+                 routes.end());
+
+    WriteStateField(os, m_seqNo, 4);
+    WriteStateField(os, m_requestId, 4);
+    WriteStateField(os, routes.size(), 4);
+    for (const auto& rt : routes)
+    {
+        int32_t interface =
+            rt.GetOutputDevice() ? m_ipv4->GetInterfaceForDevice(rt.GetOutputDevice()) : -1;
+        std::vector<Ipv4Address> precursors;
+        rt.GetPrecursors(precursors);
+        WriteStateField(os, rt.GetDestination().Get(), 4);
+        WriteStateField(os, rt.GetNextHop().Get(), 4);
+        WriteStateField(os, static_cast<uint32_t>(interface), 4);
+        WriteStateField(os, rt.GetSeqNo(), 4);
+        WriteStateField(os, rt.GetHop(), 2);
+        WriteStateField(os, rt.GetFlag() | (rt.GetValidSeqNo() ? 0x04 : 0), 1);
+        WriteStateField(os, rt.GetLifeTime().GetNanoSeconds(), 8);
+        WriteStateField(os, precursors.size(), 2);
+        for (const auto& precursor : precursors)
+        {
+            WriteStateField(os, precursor.Get(), 4);
+        }
+    }
+
+    uint32_t neighbors = 0;
+    for (const auto& nb : m_nb.GetNeighbors())
+    {
+        neighbors += (nb.m_expireTime > Now() && !nb.close);
+    }
+    WriteStateField(os, neighbors, 4);
+    for (const auto& nb : m_nb.GetNeighbors())
+    {
+        if (nb.m_expireTime > Now() && !nb.close)
+        {
+            WriteStateField(os, nb.m_neighborAddress.Get(), 4);
+            WriteStateField(os, (nb.m_expireTime - Now()).GetNanoSeconds(), 8);
+        }
+    }
+}
+
+void
+RoutingProtocol::RestoreState(std::istream& is)
+{
+    NS_LOG_FUNCTION(this);
+    m_seqNo = ReadStateField(is, 4);
+    m_requestId = ReadStateField(is, 4);
+
+    uint32_t routes = ReadStateField(is, 4);
+    for (uint32_t r = 0; r < routes; ++r)
+    {
+        Ipv4Address dst(static_cast<uint32_t>(ReadStateField(is, 4)));
+        Ipv4Address nextHop(static_cast<uint32_t>(ReadStateField(is, 4)));
+        uint32_t interface = ReadStateField(is, 4);
+        uint32_t seqNo = ReadStateField(is, 4);
+        uint16_t hops = ReadStateField(is, 2);
+        uint8_t state = ReadStateField(is, 1);
+        Time lifetime = NanoSeconds(static_cast<int64_t>(ReadStateField(is, 8)));
+
+        Ptr<NetDevice> dev;
+        Ipv4InterfaceAddress iface;
+        if (interface < m_ipv4->GetNInterfaces())
+        {
+            dev = m_ipv4->GetNetDevice(interface);
+            iface = m_ipv4->GetAddress(interface, 0);
+        }
+        RoutingTableEntry rt(/*dev=*/dev,
+                             /*dst=*/dst,
+                             /*vSeqNo=*/state & 0x04,
+                             /*seqNo=*/seqNo,
+                             /*iface=*/iface,
+                             /*hops=*/hops,
+                             /*nextHop=*/nextHop,
+                             /*lifetime=*/lifetime);
+        rt.SetFlag(static_cast<RouteFlags>(state & 0x03));
+        uint16_t precursors = ReadStateField(is, 2);
+        for (uint16_t p = 0; p < precursors; ++p)
+        {
+            rt.InsertPrecursor(Ipv4Address(static_cast<uint32_t>(ReadStateField(is, 4))));
+        }
+        if (!m_routingTable.FindRoute(dst))
+        {
+            m_routingTable.AddRoute(rt);
+        }
+    }
+
+    uint32_t neighbors = ReadStateField(is, 4);
+    for (uint32_t n = 0; n < neighbors; ++n)
+    {
+        Ipv4Address addr(static_cast<uint32_t>(ReadStateField(is, 4)));
+        m_nb.Update(addr, NanoSeconds(static_cast<int64_t>(ReadStateField(is, 8))));
+    }
+    if (m_enableHello && neighbors > 0)
+    {
+        m_nb.ScheduleTimer();
+    }
+}
+
+bool
+RoutingProtocol::SeedRoute(Ipv4Address dst,
+                           Ipv4Address nextHop,
+                           uint16_t hops,
+                           uint32_t seqNo,
+                           Time lifetime)
+{
+    NS_LOG_FUNCTION(this << dst << nextHop << hops << seqNo << lifetime.As(Time::S));
+    for (const auto& j : m_socketAddresses)
+    {
+        Ipv4InterfaceAddress iface = j.second;
+        if (iface.GetLocal().CombineMask(iface.GetMask()) !=
+            nextHop.CombineMask(iface.GetMask()))
+        {
+            continue;
+        }
+        Ptr<NetDevice> dev =
+            m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(iface.GetLocal()));
+        RoutingTableEntry rt(/*dev=*/dev,
+                             /*dst=*/dst,
+                             /*vSeqNo=*/true,
+                             /*seqNo=*/seqNo,
+                             /*iface=*/iface,
+                             /*hops=*/hops,
+                             /*nextHop=*/nextHop,
+                             /*lifetime=*/lifetime);
+        if (!m_routingTable.Update(rt))
+        {
+            m_routingTable.AddRoute(rt);
+        }
+        return true;
+    }
+    NS_LOG_WARN("No AODV interface reaches " << nextHop);
+    return false;
+}
+
 void
 RoutingProtocol::Start()
 {
@@ -445,10 +788,10 @@ RoutingProtocol::RouteOutput(Ptr<Packet> p,
     sockerr = Socket::ERROR_NOTERROR;
     Ptr<Ipv4Route> route;
     Ipv4Address dst = header.GetDestination();
-    RoutingTableEntry rt;
-    if (m_routingTable.LookupValidRoute(dst, rt))
+    const RoutingTableEntry* rt = m_routingTable.FindRoute(dst);
+    if (rt && rt->GetFlag() == VALID)
     {
-        route = rt.GetRoute();
+        route = rt->GetRoute();
         NS_ASSERT(route);
         NS_LOG_DEBUG("Exist route to " << route->GetDestination() << " from interface "
                                        << route->GetSource());
@@ -458,6 +801,13 @@ RoutingProtocol::RouteOutput(Ptr<Packet> p,
             sockerr = Socket::ERROR_NOROUTETOHOST;
             return Ptr<Ipv4Route>();
         }
+        if (m_multipathForwarding != SINGLE_PATH)
+        {
+            // The transport header is not always added yet, so flows are told
+            // apart by address and protocol only
+            route = SelectMultipathRoute(route, header, p, false, Ipv4Address());
+        }
+        TagRoutedData(p, dst);
         UpdateRouteLifeTime(dst, m_activeRouteTimeout);
         UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
         return route;
@@ -593,10 +943,10 @@ RoutingProtocol::RouteInput(Ptr<const Packet> p,
                 if (header.GetTtl() > 1)
                 {
                     NS_LOG_LOGIC("Forward broadcast. TTL " << (uint16_t)header.GetTtl());
-                    RoutingTableEntry toBroadcast;
-                    if (m_routingTable.LookupRoute(dst, toBroadcast))
+                    const RoutingTableEntry* toBroadcast = m_routingTable.FindRoute(dst);
+                    if (toBroadcast)
                     {
-                        Ptr<Ipv4Route> route = toBroadcast.GetRoute();
+                        Ptr<Ipv4Route> route = toBroadcast->GetRoute();
                         ucb(route, packet, header);
                     }
                     else
@@ -617,11 +967,12 @@ RoutingProtocol::RouteInput(Ptr<const Packet> p,
     if (m_ipv4->IsDestinationAddress(dst, iif))
     {
         UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-        RoutingTableEntry toOrigin;
-        if (m_routingTable.LookupValidRoute(origin, toOrigin))
+        const RoutingTableEntry* toOrigin = m_routingTable.FindRoute(origin);
+        if (toOrigin && toOrigin->GetFlag() == VALID)
         {
-            UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
-            m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
+            Ipv4Address prevHop = toOrigin->GetNextHop();
+            UpdateRouteLifeTime(prevHop, m_activeRouteTimeout);
+            m_nb.Update(prevHop, m_activeRouteTimeout);
         }
         if (!lcb.IsNull())
         {
@@ -659,14 +1010,22 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
     Ipv4Address dst = header.GetDestination();
     Ipv4Address origin = header.GetSource();
     m_routingTable.Purge();
-    RoutingTableEntry toDst;
-    if (m_routingTable.LookupRoute(dst, toDst))
+    // Table updates below invalidate toDst, so read it before making any
+    const RoutingTableEntry* toDst = m_routingTable.FindRoute(dst);
+    if (toDst)
     {
-        if (toDst.GetFlag() == VALID)
+        if (toDst->GetFlag() == VALID)
         {
-            Ptr<Ipv4Route> route = toDst.GetRoute();
+            Ptr<Ipv4Route> route = toDst->GetRoute();
             NS_LOG_LOGIC(route->GetSource() << " forwarding to " << dst << " from " << origin
                                             << " packet " << p->GetUid());
+            const RoutingTableEntry* toOrigin = m_routingTable.FindRoute(origin);
+            Ipv4Address prevHop = toOrigin ? toOrigin->GetNextHop() : Ipv4Address();
+            if (m_multipathForwarding != SINGLE_PATH)
+            {
+                // Never send a packet back where it is assumed to come from
+                route = SelectMultipathRoute(route, header, p, true, prevHop);
+            }
 
             /*
              *  Each time a route is used to forward a data packet, its Active Route
@@ -683,21 +1042,20 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
              * back to the IP source, is also updated to be no less than the current time plus
              * ActiveRouteTimeout
              */
-            RoutingTableEntry toOrigin;
-            m_routingTable.LookupRoute(origin, toOrigin);
-            UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
+            UpdateRouteLifeTime(prevHop, m_activeRouteTimeout);
 
             m_nb.Update(route->GetGateway(), m_activeRouteTimeout);
-            m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
+            m_nb.Update(prevHop, m_activeRouteTimeout);
 
+            TagRoutedData(p, dst);
             ucb(route, p, header);
             return true;
         }
         else
         {
-            if (toDst.GetValidSeqNo())
+            if (toDst->GetValidSeqNo())
             {
-                SendRerrWhenNoRouteToForward(dst, toDst.GetSeqNo(), origin);
+                SendRerrWhenNoRouteToForward(dst, toDst->GetSeqNo(), origin);
                 NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
                 return false;
             }
@@ -803,6 +1161,9 @@ RoutingProtocol::NotifyInterfaceUp(uint32_t i)
 
     mac->TraceConnectWithoutContext("DroppedMpdu",
                                     MakeCallback(&RoutingProtocol::NotifyTxError, this));
+    mac->TraceConnectWithoutContext("AckedMpdu", MakeCallback(&RoutingProtocol::NotifyTxOk, this));
+    mac->TraceConnectWithoutContext("NAckedMpdu",
+                                    MakeCallback(&RoutingProtocol::NotifyTxFailed, this));
 }
 
 void
@@ -811,6 +1172,37 @@ RoutingProtocol::NotifyTxError(WifiMacDropReason reason, Ptr<const WifiMpdu> mpd
     m_nb.GetTxErrorCallback()(mpdu->GetHeader());
 }
 
+void
+RoutingProtocol::NotifyTxOk(Ptr<const WifiMpdu> mpdu)
+{
+    NotifyTxOutcome(mpdu, true);
+}
+
+void
+RoutingProtocol::NotifyTxFailed(Ptr<const WifiMpdu> mpdu)
+{
+    NotifyTxOutcome(mpdu, false);
+}
+
+void
+RoutingProtocol::NotifyTxOutcome(Ptr<const WifiMpdu> mpdu, bool success)
+{
+    const WifiMacHeader& hdr = mpdu->GetHeader();
+    RoutedDataTag tag;
+    if (!hdr.HasData() || hdr.GetAddr1().IsGroup() || !mpdu->GetPacket()->PeekPacketTag(tag) ||
+        tag.GetDestination() == Ipv4Address())
+    {
+        return;
+    }
+    Ipv4Address neighbor = m_nb.UpdateDeliveryRatio(hdr.GetAddr1(), success);
+    // The MSDUs of an A-MSDU may go to different destinations
+    if (neighbor == Ipv4Address() || !m_multipathEnabled || (hdr.IsQosData() && hdr.IsQosAmsdu()))
+    {
+        return;
+    }
+    m_routingTable.UpdateMultipathStability(tag.GetDestination(), neighbor, success);
+}
+
 void
 RoutingProtocol::NotifyInterfaceDown(uint32_t i)
 {
@@ -827,6 +1219,10 @@ RoutingProtocol::NotifyInterfaceDown(uint32_t i)
         {
             mac->TraceDisconnectWithoutContext("DroppedMpdu",
                                                MakeCallback(&RoutingProtocol::NotifyTxError, this));
+            mac->TraceDisconnectWithoutContext("AckedMpdu",
+                                               MakeCallback(&RoutingProtocol::NotifyTxOk, this));
+            mac->TraceDisconnectWithoutContext("NAckedMpdu",
+                                               MakeCallback(&RoutingProtocol::NotifyTxFailed, this));
             m_nb.DelArpCache(l3->GetInterface(i)->GetArpCache());
         }
     }
@@ -848,6 +1244,7 @@ RoutingProtocol::NotifyInterfaceDown(uint32_t i)
         NS_LOG_LOGIC("No aodv interfaces");
         m_htimer.Cancel();
         m_nb.Clear();
+        m_blacklist.Clear();
         m_routingTable.Clear();
         return;
     }
@@ -976,6 +1373,7 @@ RoutingProtocol::NotifyRemoveAddress(uint32_t i, Ipv4InterfaceAddress address)
             NS_LOG_LOGIC("No aodv interfaces");
             m_htimer.Cancel();
             m_nb.Clear();
+            m_blacklist.Clear();
             m_routingTable.Clear();
             return;
         }
@@ -1133,6 +1531,12 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
     {
         rreqHeader.SetDestinationOnly(true);
     }
+    if (m_multipathEnabled && m_multipathDiscovery)
+    {
+        // Only the destination sees the copies of every path
+        rreqHeader.SetMultipath(true);
+        rreqHeader.SetDestinationOnly(true);
+    }
 
     m_seqNo++;
     rreqHeader.SetOriginSeqno(m_seqNo);
@@ -1180,6 +1584,12 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
 void
 RoutingProtocol::SendTo(Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination)
 {
+    // Marks the AODV message, so that it is not tagged as data on its way out
+    RoutedDataTag tag;
+    if (!packet->PeekPacketTag(tag))
+    {
+        packet->AddPacketTag(tag);
+    }
     socket->SendTo(packet, 0, InetSocketAddress(destination, AODV_PORT));
 }
 
@@ -1273,19 +1683,7 @@ bool
 RoutingProtocol::UpdateRouteLifeTime(Ipv4Address addr, Time lifetime)
 {
     NS_LOG_FUNCTION(this << addr << lifetime);
-    RoutingTableEntry rt;
-    if (m_routingTable.LookupRoute(addr, rt))
-    {
-        if (rt.GetFlag() == VALID)
-        {
-            NS_LOG_DEBUG("Updating VALID route");
-            rt.SetRreqCnt(0);
-            rt.SetLifeTime(std::max(lifetime, rt.GetLifeTime()));
-            m_routingTable.Update(rt);
-            return true;
-        }
-    }
-    return false;
+    return m_routingTable.TouchRoute(addr, lifetime);
 }
 
 void
@@ -1339,14 +1737,10 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
     p->RemoveHeader(rreqHeader);
 
     // A node ignores all RREQs received from any node in its blacklist
-    RoutingTableEntry toPrev;
-    if (m_routingTable.LookupRoute(src, toPrev))
+    if (m_blacklist.IsBlacklisted(src))
     {
-        if (toPrev.IsUnidirectional())
-        {
-            NS_LOG_DEBUG("Ignoring RREQ from node in blacklist");
-            return;
-        }
+        NS_LOG_DEBUG("Ignoring RREQ from node in blacklist");
+        return;
     }
 
     uint32_t id = rreqHeader.GetId();
@@ -1357,7 +1751,11 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
      * and RREQ ID. If such a RREQ has been received, the node silently discards the newly received
      * RREQ.
      */
-    if (m_rreqIdCache.IsDuplicate(origin, id))
+    bool duplicate = m_rreqIdCache.IsDuplicate(origin, id);
+    // Link-disjoint discovery learns alternate reverse paths from the later
+    // copies of a multipath RREQ
+    bool disjoint = rreqHeader.GetMultipath() && m_multipathEnabled && m_multipathDiscovery;
+    if (duplicate && (!disjoint || IsMyOwnAddress(origin)))
     {
         NS_LOG_DEBUG("Ignoring RREQ due to duplicate");
         return;
@@ -1378,74 +1776,107 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
      *  5. the Lifetime is set to be the maximum of (ExistingLifetime, MinimalLifetime), where
      *     MinimalLifetime = current time + 2*NetTraversalTime - 2*HopCount*NodeTraversalTime
      */
-    RoutingTableEntry toOrigin;
-    if (!m_routingTable.LookupRoute(origin, toOrigin))
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+    Ipv4InterfaceAddress receiverIface =
+        m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0);
+    Time reverseLifetime(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime);
+    bool newPath = false;
+    if (disjoint)
+    {
+        // The neighbors of the originator name themselves as the first hop
+        if (src == origin)
+        {
+            rreqHeader.SetFirstHop(receiver);
+        }
+        newPath = m_routingTable.AddDisjointMultipathRoute(origin,
+                                                           src,
+                                                           rreqHeader.GetFirstHop(),
+                                                           hop,
+                                                           reverseLifetime,
+                                                           rreqHeader.GetOriginSeqno());
+    }
+    // A later copy leaves the reverse route to the first one
+    if (!duplicate && !m_routingTable.ModifyRoute(origin, [&](RoutingTableEntry& toOrigin) {
+            if (toOrigin.GetValidSeqNo())
+            {
+                if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin.GetSeqNo()) > 0)
+                {
+                    toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
+                }
+            }
+            else
+            {
+                toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
+            }
+            toOrigin.SetValidSeqNo(true);
+            toOrigin.SetNextHop(src);
+            toOrigin.SetOutputDevice(dev);
+            toOrigin.SetInterface(receiverIface);
+            toOrigin.SetHop(hop);
+            toOrigin.SetLifeTime(std::max(reverseLifetime, toOrigin.GetLifeTime()));
+            return true;
+        }))
     {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
         RoutingTableEntry newEntry(
             /*dev=*/dev,
             /*dst=*/origin,
             /*vSeqNo=*/true,
             /*seqNo=*/rreqHeader.GetOriginSeqno(),
-            /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+            /*iface=*/receiverIface,
             /*hops=*/hop,
             /*nextHop=*/src,
-            /*lifetime=*/Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime));
+            /*lifetime=*/reverseLifetime);
         m_routingTable.AddRoute(newEntry);
     }
-    else
-    {
-        if (toOrigin.GetValidSeqNo())
-        {
-            if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin.GetSeqNo()) > 0)
-            {
-                toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
-            }
-        }
-        else
-        {
-            toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
-        }
-        toOrigin.SetValidSeqNo(true);
-        toOrigin.SetNextHop(src);
-        toOrigin.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toOrigin.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toOrigin.SetHop(hop);
-        toOrigin.SetLifeTime(std::max(Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime),
-                                      toOrigin.GetLifeTime()));
-        m_routingTable.Update(toOrigin);
-        // m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
-    }
-
-    RoutingTableEntry toNeighbor;
-    if (!m_routingTable.LookupRoute(src, toNeighbor))
+    // m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
+
+    if (!m_routingTable.ModifyRoute(src, [&](RoutingTableEntry& toNeighbor) {
+            toNeighbor.SetLifeTime(m_activeRouteTimeout);
+            toNeighbor.SetValidSeqNo(false);
+            toNeighbor.SetSeqNo(rreqHeader.GetOriginSeqno());
+            toNeighbor.SetFlag(VALID);
+            toNeighbor.SetOutputDevice(dev);
+            toNeighbor.SetInterface(receiverIface);
+            toNeighbor.SetHop(1);
+            toNeighbor.SetNextHop(src);
+            return true;
+        }))
     {
         NS_LOG_DEBUG("Neighbor:" << src << " not found in routing table. Creating an entry");
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
         RoutingTableEntry newEntry(dev,
                                    src,
                                    false,
                                    rreqHeader.GetOriginSeqno(),
-                                   m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+                                   receiverIface,
                                    1,
                                    src,
                                    m_activeRouteTimeout);
         m_routingTable.AddRoute(newEntry);
     }
-    else
-    {
-        toNeighbor.SetLifeTime(m_activeRouteTimeout);
-        toNeighbor.SetValidSeqNo(false);
-        toNeighbor.SetSeqNo(rreqHeader.GetOriginSeqno());
-        toNeighbor.SetFlag(VALID);
-        toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toNeighbor.SetHop(1);
-        toNeighbor.SetNextHop(src);
-        m_routingTable.Update(toNeighbor);
-    }
     m_nb.Update(src, Time(m_allowedHelloLoss * m_helloInterval));
 
+    if (duplicate)
+    {
+        // Only the destination answers a later copy, over the path the copy
+        // came by, if that path is disjoint from those already answered
+        Ipv4Address dst = rreqHeader.GetDst();
+        if (newPath && IsMyOwnAddress(dst) &&
+            m_routingTable.GetMultipathPaths(origin).size() <= m_multipathReplies)
+        {
+            const RoutingTableEntry* toOrigin = m_routingTable.FindRoute(origin);
+            if (toOrigin)
+            {
+                NS_LOG_DEBUG("Send reply over the disjoint path through " << src);
+                RoutingTableEntry viaCopy = *toOrigin;
+                viaCopy.SetNextHop(src);
+                viaCopy.SetOutputDevice(dev);
+                viaCopy.SetInterface(receiverIface);
+                viaCopy.SetHop(hop);
+                SendReply(rreqHeader, viaCopy);
+            }
+        }
+        return;
+    }
     NS_LOG_LOGIC(receiver << " receive RREQ with hop count "
                           << static_cast<uint32_t>(rreqHeader.GetHopCount()) << " ID "
                           << rreqHeader.GetId() << " to destination " << rreqHeader.GetDst());
@@ -1454,9 +1885,12 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
     //  (i)  it is itself the destination,
     if (IsMyOwnAddress(rreqHeader.GetDst()))
     {
-        m_routingTable.LookupRoute(origin, toOrigin);
-        NS_LOG_DEBUG("Send reply since I am the destination");
-        SendReply(rreqHeader, toOrigin);
+        const RoutingTableEntry* toOrigin = m_routingTable.FindRoute(origin);
+        if (toOrigin)
+        {
+            NS_LOG_DEBUG("Send reply since I am the destination");
+            SendReply(rreqHeader, *toOrigin);
+        }
         return;
     }
     /*
@@ -1464,16 +1898,16 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
      * node's existing route table entry for the destination is valid and greater than or equal to
      * the Destination Sequence Number of the RREQ, and the "destination only" flag is NOT set.
      */
-    RoutingTableEntry toDst;
     Ipv4Address dst = rreqHeader.GetDst();
-    if (m_routingTable.LookupRoute(dst, toDst))
+    const RoutingTableEntry* toDst = m_routingTable.FindRoute(dst);
+    if (toDst)
     {
         /*
          * Drop RREQ, This node RREP will make a loop.
          */
-        if (toDst.GetNextHop() == src)
+        if (toDst->GetNextHop() == src)
         {
-            NS_LOG_DEBUG("Drop RREQ from " << src << ", dest next hop " << toDst.GetNextHop());
+            NS_LOG_DEBUG("Drop RREQ from " << src << ", dest next hop " << toDst->GetNextHop());
             return;
         }
         /*
@@ -1485,16 +1919,18 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
          * the forwarding node.
          */
         if ((rreqHeader.GetUnknownSeqno() ||
-             (int32_t(toDst.GetSeqNo()) - int32_t(rreqHeader.GetDstSeqno()) >= 0)) &&
-            toDst.GetValidSeqNo())
+             (int32_t(toDst->GetSeqNo()) - int32_t(rreqHeader.GetDstSeqno()) >= 0)) &&
+            toDst->GetValidSeqNo())
         {
-            if (!rreqHeader.GetDestinationOnly() && toDst.GetFlag() == VALID)
+            if (!rreqHeader.GetDestinationOnly() && toDst->GetFlag() == VALID)
             {
+                RoutingTableEntry toDstCopy = *toDst;
+                RoutingTableEntry toOrigin;
                 m_routingTable.LookupRoute(origin, toOrigin);
-                SendReplyByIntermediateNode(toDst, toOrigin, rreqHeader.GetGratuitousRrep());
+                SendReplyByIntermediateNode(toDstCopy, toOrigin, rreqHeader.GetGratuitousRrep());
                 return;
             }
-            rreqHeader.SetDstSeqno(toDst.GetSeqNo());
+            rreqHeader.SetDstSeqno(toDst->GetSeqNo());
             rreqHeader.SetUnknownSeqno(false);
         }
     }
@@ -1506,6 +1942,10 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
         NS_LOG_DEBUG("TTL exceeded. Drop RREQ origin " << src << " destination " << dst);
         return;
     }
+    if (disjoint)
+    {
+        m_routingTable.AdvertiseMultipathRoute(origin);
+    }
 
     for (auto j = m_socketAddresses.begin(); j != m_socketAddresses.end(); ++j)
     {
@@ -1557,6 +1997,8 @@ RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry
                           /*dstSeqNo=*/m_seqNo,
                           /*origin=*/toOrigin.GetDestination(),
                           /*lifetime=*/m_myRouteTimeout);
+    rrepHeader.SetMultipath(rreqHeader.GetMultipath() && m_multipathEnabled &&
+                            m_multipathDiscovery);
     Ptr<Packet> packet = Create<Packet>();
     SocketIpTtlTag tag;
     tag.SetTtl(toOrigin.GetHop());
@@ -1566,7 +2008,7 @@ RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry
     packet->AddHeader(tHeader);
     Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
     NS_ASSERT(socket);
-    socket->SendTo(packet, 0, InetSocketAddress(toOrigin.GetNextHop(), AODV_PORT));
+    SendTo(socket, packet, toOrigin.GetNextHop());
 }
 
 void
@@ -1587,11 +2029,7 @@ RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
     if (toDst.GetHop() == 1)
     {
         rrepHeader.SetAckRequired(true);
-        RoutingTableEntry toNextHop;
-        m_routingTable.LookupRoute(toOrigin.GetNextHop(), toNextHop);
-        toNextHop.m_ackTimer.SetFunction(&RoutingProtocol::AckTimerExpire, this);
-        toNextHop.m_ackTimer.SetArguments(toNextHop.GetDestination(), m_blackListTimeout);
-        toNextHop.m_ackTimer.SetDelay(m_nextHopWait);
+        m_blacklist.ExpectAck(toOrigin.GetNextHop(), m_nextHopWait, m_blackListTimeout);
     }
     toDst.InsertPrecursor(toOrigin.GetNextHop());
     toOrigin.InsertPrecursor(toDst.GetNextHop());
@@ -1607,7 +2045,7 @@ RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
     packet->AddHeader(tHeader);
     Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
     NS_ASSERT(socket);
-    socket->SendTo(packet, 0, InetSocketAddress(toOrigin.GetNextHop(), AODV_PORT));
+    SendTo(socket, packet, toOrigin.GetNextHop());
 
     // Generating gratuitous RREPs
     if (gratRep)
@@ -1628,7 +2066,7 @@ RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
         Ptr<Socket> socket = FindSocketWithInterfaceAddress(toDst.GetInterface());
         NS_ASSERT(socket);
         NS_LOG_LOGIC("Send gratuitous RREP " << packet->GetUid());
-        socket->SendTo(packetToDst, 0, InetSocketAddress(toDst.GetNextHop(), AODV_PORT));
+        SendTo(socket, packetToDst, toDst.GetNextHop());
     }
 }
 
@@ -1644,11 +2082,11 @@ RoutingProtocol::SendReplyAck(Ipv4Address neighbor)
     packet->AddPacketTag(tag);
     packet->AddHeader(h);
     packet->AddHeader(typeHeader);
-    RoutingTableEntry toNeighbor;
-    m_routingTable.LookupRoute(neighbor, toNeighbor);
-    Ptr<Socket> socket = FindSocketWithInterfaceAddress(toNeighbor.GetInterface());
+    const RoutingTableEntry* toNeighbor = m_routingTable.FindRoute(neighbor);
+    NS_ASSERT(toNeighbor);
+    Ptr<Socket> socket = FindSocketWithInterfaceAddress(toNeighbor->GetInterface());
     NS_ASSERT(socket);
-    socket->SendTo(packet, 0, InetSocketAddress(neighbor, AODV_PORT));
+    SendTo(socket, packet, neighbor);
 }
 
 void
@@ -1670,6 +2108,23 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
         return;
     }
 
+    // Link-disjoint discovery: every RREP copy brings a forward path
+    bool disjoint = rrepHeader.GetMultipath() && m_multipathEnabled && m_multipathDiscovery;
+    if (disjoint)
+    {
+        // The neighbors of the destination name themselves as the first hop
+        if (sender == dst)
+        {
+            rrepHeader.SetFirstHop(receiver);
+        }
+        m_routingTable.AddDisjointMultipathRoute(dst,
+                                                 sender,
+                                                 rrepHeader.GetFirstHop(),
+                                                 hop,
+                                                 rrepHeader.GetLifeTime(),
+                                                 rrepHeader.GetDstSeqno());
+    }
+
     /*
      * If the route table entry to the destination is created or updated, then the following actions
      * occur:
@@ -1693,25 +2148,27 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
         /*hops=*/hop,
         /*nextHop=*/sender,
         /*lifetime=*/rrepHeader.GetLifeTime());
-    RoutingTableEntry toDst;
-    if (m_routingTable.LookupRoute(dst, toDst))
+    RouteFlags toDstFlag = VALID;
+    const RoutingTableEntry* toDst = m_routingTable.FindRoute(dst);
+    if (toDst)
     {
+        toDstFlag = toDst->GetFlag();
         // The existing entry is updated only in the following circumstances:
         if (
             // (i) the sequence number in the routing table is marked as invalid in route table
             // entry.
-            (!toDst.GetValidSeqNo()) ||
+            (!toDst->GetValidSeqNo()) ||
 
             // (ii) the Destination Sequence Number in the RREP is greater than the node's copy of
             // the destination sequence number and the known value is valid,
-            ((int32_t(rrepHeader.GetDstSeqno()) - int32_t(toDst.GetSeqNo())) > 0) ||
+            ((int32_t(rrepHeader.GetDstSeqno()) - int32_t(toDst->GetSeqNo())) > 0) ||
 
             // (iii) the sequence numbers are the same, but the route is marked as inactive.
-            (rrepHeader.GetDstSeqno() == toDst.GetSeqNo() && toDst.GetFlag() != VALID) ||
+            (rrepHeader.GetDstSeqno() == toDst->GetSeqNo() && toDst->GetFlag() != VALID) ||
 
             // (iv) the sequence numbers are the same, and the New Hop Count is smaller than the
             // hop count in route table entry.
-            (rrepHeader.GetDstSeqno() == toDst.GetSeqNo() && hop < toDst.GetHop()))
+            (rrepHeader.GetDstSeqno() == toDst->GetSeqNo() && hop < toDst->GetHop()))
         {
             m_routingTable.Update(newEntry);
         }
@@ -1731,14 +2188,15 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     NS_LOG_LOGIC("receiver " << receiver << " origin " << rrepHeader.GetOrigin());
     if (IsMyOwnAddress(rrepHeader.GetOrigin()))
     {
-        if (toDst.GetFlag() == IN_SEARCH)
+        if (toDstFlag == IN_SEARCH)
         {
             m_routingTable.Update(newEntry);
             m_addressReqTimer[dst].Cancel();
             m_addressReqTimer.erase(dst);
         }
-        m_routingTable.LookupRoute(dst, toDst);
-        SendPacketFromQueue(dst, toDst.GetRoute());
+        toDst = m_routingTable.FindRoute(dst);
+        NS_ASSERT(toDst);
+        SendPacketFromQueue(dst, toDst->GetRoute());
 
         // PENAMBAHAN BLE-MAODV: Process enhanced metrics
         if (m_multipathEnabled) {
@@ -1747,33 +2205,46 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
         return;
     }
 
-    RoutingTableEntry toOrigin;
-    if (!m_routingTable.LookupRoute(rrepHeader.GetOrigin(), toOrigin) ||
-        toOrigin.GetFlag() == IN_SEARCH)
+    Ipv4Address originNextHop;
+    Ipv4InterfaceAddress originIface;
+    if (!m_routingTable.ModifyRoute(rrepHeader.GetOrigin(), [&](RoutingTableEntry& toOrigin) {
+            if (toOrigin.GetFlag() == IN_SEARCH)
+            {
+                return false;
+            }
+            toOrigin.SetLifeTime(std::max(m_activeRouteTimeout, toOrigin.GetLifeTime()));
+            originNextHop = toOrigin.GetNextHop();
+            originIface = toOrigin.GetInterface();
+            return true;
+        }))
     {
         return; // Impossible! drop.
     }
-    toOrigin.SetLifeTime(std::max(m_activeRouteTimeout, toOrigin.GetLifeTime()));
-    m_routingTable.Update(toOrigin);
 
     // Update information about precursors
-    if (m_routingTable.LookupValidRoute(rrepHeader.GetDst(), toDst))
+    Ipv4Address dstNextHop;
+    if (m_routingTable.ModifyRoute(rrepHeader.GetDst(), [&](RoutingTableEntry& toDst) {
+            if (toDst.GetFlag() != VALID)
+            {
+                return false;
+            }
+            toDst.InsertPrecursor(originNextHop);
+            dstNextHop = toDst.GetNextHop();
+            return true;
+        }))
     {
-        toDst.InsertPrecursor(toOrigin.GetNextHop());
-        m_routingTable.Update(toDst);
-
-        RoutingTableEntry toNextHopToDst;
-        m_routingTable.LookupRoute(toDst.GetNextHop(), toNextHopToDst);
-        toNextHopToDst.InsertPrecursor(toOrigin.GetNextHop());
-        m_routingTable.Update(toNextHopToDst);
-
-        toOrigin.InsertPrecursor(toDst.GetNextHop());
-        m_routingTable.Update(toOrigin);
-
-        RoutingTableEntry toNextHopToOrigin;
-        m_routingTable.LookupRoute(toOrigin.GetNextHop(), toNextHopToOrigin);
-        toNextHopToOrigin.InsertPrecursor(toDst.GetNextHop());
-        m_routingTable.Update(toNextHopToOrigin);
+        m_routingTable.ModifyRoute(dstNextHop, [&](RoutingTableEntry& toNextHopToDst) {
+            toNextHopToDst.InsertPrecursor(originNextHop);
+            return true;
+        });
+        m_routingTable.ModifyRoute(rrepHeader.GetOrigin(), [&](RoutingTableEntry& toOrigin) {
+            toOrigin.InsertPrecursor(dstNextHop);
+            return true;
+        });
+        m_routingTable.ModifyRoute(originNextHop, [&](RoutingTableEntry& toNextHopToOrigin) {
+            toNextHopToOrigin.InsertPrecursor(dstNextHop);
+            return true;
+        });
     }
     SocketIpTtlTag tag;
     p->RemovePacketTag(tag);
@@ -1791,19 +2262,24 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     packet->AddHeader(rrepHeader);
     TypeHeader tHeader(AODVTYPE_RREP);
     packet->AddHeader(tHeader);
-    Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
+    Ptr<Socket> socket = FindSocketWithInterfaceAddress(originIface);
     NS_ASSERT(socket);
-    socket->SendTo(packet, 0, InetSocketAddress(toOrigin.GetNextHop(), AODV_PORT));
+    SendTo(socket, packet, originNextHop);
 
     // ================== PENAMBAHAN MULTIPATH ===================
-    if (IsMultipathEnabled())
+    if (disjoint)
+    {
+        m_routingTable.AdvertiseMultipathRoute(dst);
+    }
+    else if (IsMultipathEnabled())
     {
         // Add this as an alternative path
         m_routingTable.AddMultipathRoute(
             rrepHeader.GetDst(), 
             sender, 
             rrepHeader.GetHopCount(), 
-            m_activeRouteTimeout
+            m_activeRouteTimeout,
+            rrepHeader.GetDstSeqno()
         );
         
         NS_LOG_LOGIC("Added multipath route to " << rrepHeader.GetDst() 
@@ -1818,13 +2294,11 @@ void
 RoutingProtocol::RecvReplyAck(Ipv4Address neighbor)
 {
     NS_LOG_FUNCTION(this);
-    RoutingTableEntry rt;
-    if (m_routingTable.LookupRoute(neighbor, rt))
-    {
-        rt.m_ackTimer.Cancel();
+    m_blacklist.AckReceived(neighbor);
+    m_routingTable.ModifyRoute(neighbor, [](RoutingTableEntry& rt) {
         rt.SetFlag(VALID);
-        m_routingTable.Update(rt);
-    }
+        return true;
+    });
 }
 
 void
@@ -1836,34 +2310,32 @@ RoutingProtocol::ProcessHello(const RrepHeader& rrepHeader, Ipv4Address receiver
      * SHOULD make sure that it has an active route to the neighbor, and
      * create one if necessary.
      */
-    RoutingTableEntry toNeighbor;
-    if (!m_routingTable.LookupRoute(rrepHeader.GetDst(), toNeighbor))
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+    Ipv4InterfaceAddress iface = m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0);
+    if (!m_routingTable.ModifyRoute(rrepHeader.GetDst(), [&](RoutingTableEntry& toNeighbor) {
+            toNeighbor.SetLifeTime(
+                std::max(Time(m_allowedHelloLoss * m_helloInterval), toNeighbor.GetLifeTime()));
+            toNeighbor.SetSeqNo(rrepHeader.GetDstSeqno());
+            toNeighbor.SetValidSeqNo(true);
+            toNeighbor.SetFlag(VALID);
+            toNeighbor.SetOutputDevice(dev);
+            toNeighbor.SetInterface(iface);
+            toNeighbor.SetHop(1);
+            toNeighbor.SetNextHop(rrepHeader.GetDst());
+            return true;
+        }))
     {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
         RoutingTableEntry newEntry(
             /*dev=*/dev,
             /*dst=*/rrepHeader.GetDst(),
             /*vSeqNo=*/true,
             /*seqNo=*/rrepHeader.GetDstSeqno(),
-            /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+            /*iface=*/iface,
             /*hops=*/1,
             /*nextHop=*/rrepHeader.GetDst(),
             /*lifetime=*/rrepHeader.GetLifeTime());
         m_routingTable.AddRoute(newEntry);
     }
-    else
-    {
-        toNeighbor.SetLifeTime(
-            std::max(Time(m_allowedHelloLoss * m_helloInterval), toNeighbor.GetLifeTime()));
-        toNeighbor.SetSeqNo(rrepHeader.GetDstSeqno());
-        toNeighbor.SetValidSeqNo(true);
-        toNeighbor.SetFlag(VALID);
-        toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toNeighbor.SetHop(1);
-        toNeighbor.SetNextHop(rrepHeader.GetDst());
-        m_routingTable.Update(toNeighbor);
-    }
     if (m_enableHello)
     {
         m_nb.Update(rrepHeader.GetDst(), Time(m_allowedHelloLoss * m_helloInterval));
@@ -1882,12 +2354,9 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
     std::pair<Ipv4Address, uint32_t> un;
     while (rerrHeader.RemoveUnDestination(un))
     {
-        for (auto i = dstWithNextHopSrc.begin(); i != dstWithNextHopSrc.end(); ++i)
+        if (dstWithNextHopSrc.find(un.first) != dstWithNextHopSrc.end())
         {
-            if (i->first == un.first)
-            {
-                unreachable.insert(un);
-            }
+            unreachable.insert(un);
         }
     }
 
@@ -1908,9 +2377,11 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
         }
         else
         {
-            RoutingTableEntry toDst;
-            m_routingTable.LookupRoute(i->first, toDst);
-            toDst.GetPrecursors(precursors);
+            const RoutingTableEntry* toDst = m_routingTable.FindRoute(i->first);
+            if (toDst)
+            {
+                toDst->MergePrecursors(precursors);
+            }
             ++i;
         }
     }
@@ -2007,13 +2478,6 @@ RoutingProtocol::RerrRateLimitTimerExpire()
     m_rerrRateLimitTimer.Schedule(Seconds(1));
 }
 
-void
-RoutingProtocol::AckTimerExpire(Ipv4Address neighbor, Time blacklistTimeout)
-{
-    NS_LOG_FUNCTION(this);
-    m_routingTable.MarkLinkAsUnidirectional(neighbor, blacklistTimeout);
-}
-
 void
 RoutingProtocol::SendHello()
 {
@@ -2076,6 +2540,7 @@ RoutingProtocol::SendPacketFromQueue(Ipv4Address dst, Ptr<Ipv4Route> route)
         header.SetSource(route->GetSource());
         header.SetTtl(header.GetTtl() +
                       1); // compensate extra TTL decrement by fake loopback routing
+        TagRoutedData(p, dst);
         ucb(route, p, header);
     }
 }
@@ -2088,14 +2553,31 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
     std::vector<Ipv4Address> precursors;
     std::map<Ipv4Address, uint32_t> unreachable;
 
-    RoutingTableEntry toNextHop;
-    if (!m_routingTable.LookupRoute(nextHop, toNextHop))
+    const RoutingTableEntry* toNextHop = m_routingTable.FindRoute(nextHop);
+    if (!toNextHop)
     {
         return;
     }
-    toNextHop.GetPrecursors(precursors);
-    rerrHeader.AddUnDestination(nextHop, toNextHop.GetSeqNo());
+    precursors = toNextHop->GetPrecursorSet();
+    uint32_t nextHopSeqNo = toNextHop->GetSeqNo();
+    rerrHeader.AddUnDestination(nextHop, nextHopSeqNo);
     m_routingTable.GetListOfDestinationWithNextHop(nextHop, unreachable);
+    if (m_multipathEnabled && m_multipathFailover)
+    {
+        // Routes with another path left stay valid, so neither this node nor
+        // the precursors have to rediscover them
+        for (auto i = unreachable.begin(); i != unreachable.end();)
+        {
+            if (i->first != nextHop && m_routingTable.PromoteMultipathRoute(i->first, nextHop))
+            {
+                i = unreachable.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
     for (auto i = unreachable.begin(); i != unreachable.end();)
     {
         if (!rerrHeader.AddUnDestination(i->first, i->second))
@@ -2113,9 +2595,11 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
         }
         else
         {
-            RoutingTableEntry toDst;
-            m_routingTable.LookupRoute(i->first, toDst);
-            toDst.GetPrecursors(precursors);
+            const RoutingTableEntry* toDst = m_routingTable.FindRoute(i->first);
+            if (toDst)
+            {
+                toDst->MergePrecursors(precursors);
+            }
             ++i;
         }
     }
@@ -2130,7 +2614,7 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
         packet->AddHeader(typeHeader);
         SendRerrMessage(packet, precursors);
     }
-    unreachable.insert(std::make_pair(nextHop, toNextHop.GetSeqNo()));
+    unreachable.insert(std::make_pair(nextHop, nextHopSeqNo));
     m_routingTable.InvalidateRoutesWithDst(unreachable);
 }
 
@@ -2165,7 +2649,7 @@ RoutingProtocol::SendRerrWhenNoRouteToForward(Ipv4Address dst,
         Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
         NS_ASSERT(socket);
         NS_LOG_LOGIC("Unicast RERR to the source of the data transmission");
-        socket->SendTo(packet, 0, InetSocketAddress(toOrigin.GetNextHop(), AODV_PORT));
+        SendTo(socket, packet, toOrigin.GetNextHop());
     }
     else
     {
@@ -2185,13 +2669,13 @@ RoutingProtocol::SendRerrWhenNoRouteToForward(Ipv4Address dst,
             {
                 destination = iface.GetBroadcast();
             }
-            socket->SendTo(packet->Copy(), 0, InetSocketAddress(destination, AODV_PORT));
+            SendTo(socket, packet->Copy(), destination);
         }
     }
 }
 
 void
-RoutingProtocol::SendRerrMessage(Ptr<Packet> packet, std::vector<Ipv4Address> precursors)
+RoutingProtocol::SendRerrMessage(Ptr<Packet> packet, const std::vector<Ipv4Address>& precursors)
 {
     NS_LOG_FUNCTION(this);
 
@@ -2343,8 +2827,14 @@ RoutingProtocol::GetCurrentNodeMetrics() const
     // For simulation purposes, we'll use a placeholder value
     metrics.rssiValue = -60.0; // Good signal strength
     
-    // Start with high stability, will be updated based on actual performance
-    metrics.stabilityScore = 0.8;
+    // The mean share of the frames to the neighbors that the MAC got acknowledged
+    double deliveryRatio = 0;
+    for (const auto& nb : m_nb.GetNeighbors())
+    {
+        deliveryRatio += nb.m_deliveryRatio;
+    }
+    metrics.stabilityScore =
+        m_nb.GetNeighbors().empty() ? 1.0 : deliveryRatio / m_nb.GetNeighbors().size();
     metrics.lastUpdated = Simulator::Now();
     
     return metrics;
@@ -2355,8 +2845,9 @@ RoutingProtocol::UpdateNeighborMetrics(Ipv4Address neighbor, const BLEMetrics& m
 {
     NS_LOG_FUNCTION(this << neighbor);
     
-    // Update neighbor information with BLE metrics
-    // This would typically update the neighbor table with link quality information
+    // Rescores the multipath paths through the neighbor, which reranks their
+    // destinations for preemptive switching
+    m_routingTable.UpdateMultipathLinkMetrics(neighbor, metrics);
     NS_LOG_DEBUG("Updated metrics for neighbor " << neighbor << 
                  " - Energy: " << metrics.residualEnergy <<
                  ", RSSI: " << metrics.rssiValue);
@@ -2367,11 +2858,8 @@ RoutingProtocol::CalculateLinkQuality(Ipv4Address neighbor) const
 {
     NS_LOG_FUNCTION(this << neighbor);
     
-    // Calculate link quality based on multiple factors
-    // This is a simplified version - real implementation would use more sophisticated algorithms
-    
-    // For simulation, return a reasonable value
-    return 0.85; // Good link quality
+    // The share of the frames to the neighbor that the MAC got acknowledged
+    return m_nb.GetDeliveryRatio(neighbor);
 }
 
 void
@@ -2395,6 +2883,8 @@ RoutingProtocol::MetricsUpdateTimerExpire()
     
     // Untuk sementara, gunakan default weights
     m_currentWeights = m_weightCalculator.CalculateWeights(m_networkContext);
+    // Rescores the multipath entries if the weights changed
+    m_routingTable.SetMultipathWeights(m_currentWeights);
     
     NS_LOG_DEBUG("Metrics updated - Energy: " << m_residualEnergy);
     
@@ -2402,23 +2892,6 @@ RoutingProtocol::MetricsUpdateTimerExpire()
     m_metricsUpdateTimer.Schedule(Seconds(5));
 }
 
-void
-RoutingProtocol::PathQualityTimerExpire()
-{
-    NS_LOG_FUNCTION(this);
-    
-    if (m_multipathEnabled) {
-        // Check quality of active paths and perform preemptive switching if needed
-        NS_LOG_DEBUG("Performing periodic path quality check");
-        
-        // Check path quality dan lakukan preemptive switching jika diperlukan
-        CheckPathQuality();
-        
-        // Reschedule the timer
-        m_pathQualityTimer.Schedule(Seconds(3));
-    }
-}
-
 void
 RoutingProtocol::SendEnhancedRequest(Ipv4Address dst)
 {
@@ -2445,7 +2918,7 @@ RoutingProtocol::ProcessEnhancedReply(const RrepHeader& rrepHeader, Ipv4Address
         BLEMetrics metrics;
         metrics.residualEnergy = 0.8; // Would come from RREP in actual implementation
         metrics.rssiValue = -65.0; // Would come from physical layer measurement
-        metrics.stabilityScore = 0.9; // Initial stability
+        metrics.stabilityScore = m_nb.GetDeliveryRatio(sender); // Measured by the MAC
         metrics.hopCount = rrepHeader.GetHopCount();
         
         // Add path with BLE metrics
@@ -2474,7 +2947,7 @@ RoutingProtocol::SelectBestPathByMetrics(
     double bestScore = -1.0;
     MultipathRouteEntry::PathInfo bestPath;
     
-    for (auto path : paths) {
+    for (const auto& path : paths) {
         if (!path.isValid) {
             continue; // Skip invalid paths
         }
@@ -2509,62 +2982,235 @@ RoutingProtocol::SelectBestPathByMetrics(
 // ==================== BLE-MAODV METHOD IMPLEMENTATIONS ====================
 
 void
-RoutingProtocol::CheckPathQuality()
+RoutingProtocol::NotifyMultipathRerank(Ipv4Address dst)
 {
-    NS_LOG_FUNCTION(this);
-    
-    if (m_multipathEnabled) {
-        NS_LOG_DEBUG("Checking path quality for multipath routes");
-        
-        // Iterate through multipath routes and check their quality
-        // Ini adalah placeholder - implementasi nyata akan memeriksa metric setiap path
-        RoutingTable& rt = GetRoutingTable();
-        rt.PurgeMultipathRoutes();
-        
-        NS_LOG_DEBUG("Path quality check completed");
+    if (!m_multipathEnabled)
+    {
+        return;
+    }
+    // Evaluated once the table change that reranked the paths is over
+    m_reranked.push_back(dst);
+    if (!m_rerankScheduled)
+    {
+        m_rerankScheduled = true;
+        m_rerankEvent = Simulator::ScheduleNow(&RoutingProtocol::ProcessReranks, this);
+    }
+}
+
+void
+RoutingProtocol::ProcessReranks()
+{
+    NS_LOG_FUNCTION(this << m_reranked.size());
+    m_rerankScheduled = false;
+    CatchUpRouteChanges();
+    std::vector<Ipv4Address> reranked;
+    reranked.swap(m_reranked);
+    std::sort(reranked.begin(), reranked.end());
+    reranked.erase(std::unique(reranked.begin(), reranked.end()), reranked.end());
+    for (Ipv4Address dst : reranked)
+    {
+        PreemptiveRouteSwitch(dst);
     }
 }
 
+void
+RoutingProtocol::CatchUpRouteChanges()
+{
+    const RouteJournal& journal = m_routingTable.GetJournal();
+    if (journal.IsLost(m_journalCursor))
+    {
+        // Too many changes to tell which routes moved
+        NS_LOG_LOGIC("Route journal overrun, restarting " << m_switchCandidates.size()
+                                                          << " switch candidates");
+        for (auto& candidate : m_switchCandidates)
+        {
+            candidate.second.check.Cancel();
+            m_reranked.push_back(candidate.first);
+        }
+        m_switchCandidates.clear();
+    }
+    m_journalCursor = journal.Read(m_journalCursor, [this](const RouteEvent& event) {
+        if (event.type == ROUTE_ADDED || event.type == ROUTE_UPDATED)
+        {
+            return;
+        }
+        // The alternate led a path the route is no longer on
+        auto candidate = m_switchCandidates.find(event.dst);
+        if (candidate != m_switchCandidates.end())
+        {
+            candidate->second.check.Cancel();
+            m_switchCandidates.erase(candidate);
+            m_reranked.push_back(event.dst);
+        }
+    });
+}
+
 void
 RoutingProtocol::PreemptiveRouteSwitch(Ipv4Address dst)
 {
     NS_LOG_FUNCTION(this << dst);
-    
-    if (m_multipathEnabled) {
-        NS_LOG_DEBUG("Performing preemptive route switch for " << dst);
-        
-        // Check if we have multiple paths to this destination
-        MultipathRouteEntry::PathInfo currentBest, alternativeBest;
-        if (GetRoutingTable().GetBestMultipathRoute(dst, currentBest)) {
-            auto allPaths = GetRoutingTable().GetAllMultipathRoutes(dst);
-            
-            if (allPaths.size() > 1) {
-                // Find alternative path with highest score
-                double bestScore = -1.0;
-                for (const auto& path : allPaths) {
-                    if (path.nextHop != currentBest.nextHop) {
-                        double score = path.CalculateCompositeScore(m_currentWeights);
-                        if (score > bestScore) {
-                            bestScore = score;
-                            alternativeBest = path;
-                        }
-                    }
-                }
-                
-                // If alternative is significantly better, log potential switch
-                double currentScore = currentBest.CalculateCompositeScore(m_currentWeights);
-                if (bestScore > currentScore + 0.1) { // 10% better
-                    NS_LOG_DEBUG("Preemptive switch possible for " << dst << 
-                                 " from " << currentBest.nextHop << " (score: " << currentScore <<
-                                 ") to " << alternativeBest.nextHop << " (score: " << bestScore << ")");
-                }
-            }
+    auto candidate = m_switchCandidates.find(dst);
+
+    // Compare the path in use with the best scored one. The paths come
+    // scored with m_currentWeights and best first, so nothing is rescored here.
+    Ipv4Address current;
+    const RoutingTableEntry* route = m_routingTable.FindRoute(dst);
+    if (route && route->GetFlag() == VALID)
+    {
+        current = route->GetNextHop();
+    }
+    double currentScore = -1;
+    MultipathRouteEntry::PathSpan paths = m_routingTable.GetMultipathPaths(dst);
+    for (const auto& path : paths)
+    {
+        if (path.nextHop == current)
+        {
+            currentScore = path.compositeScore;
+            break;
         }
     }
-}
+    // Only a route on one of its multipath paths is compared with the others;
+    // a route off them is left to route maintenance
+    if (currentScore < 0 || paths.front().nextHop == current ||
+        paths.front().compositeScore <
+            currentScore + m_routingTable.GetMultipathSwitchMargin())
+    {
+        if (candidate != m_switchCandidates.end())
+        {
+            NS_LOG_LOGIC("Alternate " << candidate->second.nextHop << " to " << dst
+                                      << " no longer leads");
+            candidate->second.check.Cancel();
+            m_switchCandidates.erase(candidate);
+        }
+        return;
+    }
 
+    const MultipathRouteEntry::PathInfo& best = paths.front();
+    Time now = Simulator::Now();
+    if (candidate == m_switchCandidates.end() || candidate->second.nextHop != best.nextHop)
+    {
+        // A new leader: switch once it has led for the dwell time
+        SwitchCandidate& leader = m_switchCandidates[dst];
+        leader.check.Cancel();
+        leader.nextHop = best.nextHop;
+        leader.since = now;
+        NS_LOG_DEBUG("Alternate " << best.nextHop << " to " << dst << " (score "
+                                  << best.compositeScore << ") leads " << current << " (score "
+                                  << currentScore << ")");
+        if (m_switchDwell.IsStrictlyPositive())
+        {
+            // Through ProcessReranks(), which first catches up on the route changes
+            leader.check = Simulator::Schedule(m_switchDwell,
+                                               &RoutingProtocol::NotifyMultipathRerank,
+                                               this,
+                                               dst);
+            return;
+        }
+        candidate = m_switchCandidates.find(dst);
+    }
+    if (now - candidate->second.since < m_switchDwell)
+    {
+        return;
+    }
+    Ipv4Address next = best.nextHop;
+    candidate->second.check.Cancel();
+    m_switchCandidates.erase(candidate);
+    if (m_routingTable.SwitchMultipathRoute(dst, next))
+    {
+        NS_LOG_DEBUG("Preemptive switch of the route to " << dst << " from " << current << " to "
+                                                          << next);
+    }
+}
 
 // ====================== PENAMBAHAN MULTIPATH ====================
+/**
+ * Hash the flow of a packet: its addresses, protocol and, if known, ports
+ * @param header the IP header of the packet
+ * @param p the packet, without its IP header
+ * @param ports true if p starts with its TCP or UDP header
+ * @returns the hash
+ */
+static uint32_t
+FlowHash(const Ipv4Header& header, Ptr<const Packet> p, bool ports)
+{
+    uint64_t key = (uint64_t(header.GetSource().Get()) << 32) | header.GetDestination().Get();
+    uint64_t extra = header.GetProtocol();
+    uint8_t buffer[4];
+    if (ports && (header.GetProtocol() == 6 || header.GetProtocol() == 17) &&
+        header.GetFragmentOffset() == 0 && p->CopyData(buffer, 4) == 4)
+    {
+        extra |= uint64_t(buffer[0]) << 8 | uint64_t(buffer[1]) << 16 |
+                 uint64_t(buffer[2]) << 24 | uint64_t(buffer[3]) << 32;
+    }
+    // Mix as the splitmix64 finalizer does, so nearby addresses spread evenly
+    uint64_t h = key ^ (extra * 0x9e3779b97f4a7c15ULL);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return static_cast<uint32_t>(h >> 32);
+}
+
+Ptr<Ipv4Route>
+RoutingProtocol::SelectMultipathRoute(Ptr<Ipv4Route> route,
+                                      const Ipv4Header& header,
+                                      Ptr<const Packet> p,
+                                      bool ports,
+                                      Ipv4Address exclude)
+{
+    NS_LOG_FUNCTION(this << header.GetDestination() << exclude);
+    Ipv4Address dst = header.GetDestination();
+    uint32_t hash =
+        m_multipathForwarding == WEIGHTED_ROUND_ROBIN ? 0 : FlowHash(header, p, ports);
+    Ipv4Address nextHop;
+    if (m_multipathForwarding == FLOW_PINNED)
+    {
+        // A pinned flow stays on its path for as long as the path may carry it
+        nextHop = m_flowTable.Lookup(hash, dst);
+        if (nextHop != Ipv4Address() && nextHop != route->GetGateway() &&
+            (nextHop == exclude || !m_routingTable.HasAlternateMultipathPath(dst, nextHop)))
+        {
+            nextHop = Ipv4Address();
+        }
+    }
+    if (nextHop == Ipv4Address())
+    {
+        if (!m_routingTable.SelectMultipathNextHop(dst,
+                                                   m_multipathForwarding,
+                                                   hash,
+                                                   exclude,
+                                                   nextHop))
+        {
+            return route;
+        }
+        if (m_multipathForwarding == FLOW_PINNED)
+        {
+            m_flowTable.Pin(hash, dst, nextHop);
+        }
+    }
+    if (nextHop == route->GetGateway())
+    {
+        return route;
+    }
+    const RoutingTableEntry* neighbor = m_routingTable.FindRoute(nextHop);
+    if (!neighbor || neighbor->GetFlag() != VALID || neighbor->GetNextHop() != nextHop ||
+        neighbor->GetOutputDevice() != route->GetOutputDevice())
+    {
+        NS_LOG_LOGIC("Path via " << nextHop << " is not usable, staying on "
+                                 << route->GetGateway());
+        if (m_multipathForwarding == FLOW_PINNED)
+        {
+            // Keep the flow on the path it now takes, instead of sending its
+            // next packets over whichever path the hash picks
+            m_flowTable.Pin(hash, dst, route->GetGateway());
+        }
+        return route;
+    }
+    NS_LOG_LOGIC("Multipath route to " << header.GetDestination() << " via " << nextHop);
+    // The route to the neighbor has the gateway, source and device the packet
+    // needs; IP does not look at the destination of a route it sends on
+    return neighbor->GetRoute();
+}
+
 void
 RoutingProtocol::SetMultipathEnabled(bool enable)
 {
@@ -16,7 +16,9 @@
 #ifndef AODVROUTINGPROTOCOL_H
 #define AODVROUTINGPROTOCOL_H
 
+#include "aodv-blacklist.h"
 #include "aodv-dpd.h"
+#include "aodv-flow-table.h"
 #include "aodv-neighbor.h"
 #include "aodv-packet.h"
 #include "aodv-rqueue.h"
@@ -29,6 +31,7 @@
 #include "ns3/output-stream-wrapper.h"
 #include "ns3/random-variable-stream.h"
 
+#include <iostream>
 #include <map>
 
 namespace ns3
@@ -164,6 +167,127 @@ class RoutingProtocol : public Ipv4RoutingProtocol
         return m_enableHello;
     }
 
+    /**
+     * Select the compact routing table layout (see RoutingTable::SetCompact())
+     * @param f true for the compact layout
+     */
+    void SetCompactRoutingTable(bool f)
+    {
+        m_routingTable.SetCompact(f);
+    }
+
+    /**
+     * Get the routing table layout
+     * @returns true if the compact layout is used
+     */
+    bool GetCompactRoutingTable() const
+    {
+        return m_routingTable.IsCompact();
+    }
+
+    /**
+     * Set the number of flows pinned by the FlowPinned multipath forwarding
+     * @param flows the number of flows
+     */
+    void SetMaxPinnedFlows(uint32_t flows)
+    {
+        m_flowTable.SetCapacity(flows);
+    }
+
+    /**
+     * Get the number of flows pinned by the FlowPinned multipath forwarding
+     * @returns the number of flows
+     */
+    uint32_t GetMaxPinnedFlows() const
+    {
+        return m_flowTable.GetCapacity();
+    }
+
+    /**
+     * Set the time after which an idle flow is unpinned
+     * @param t the idle timeout
+     */
+    void SetFlowIdleTimeout(Time t)
+    {
+        m_flowTable.SetIdleTimeout(t);
+    }
+
+    /**
+     * Get the time after which an idle flow is unpinned
+     * @returns the idle timeout
+     */
+    Time GetFlowIdleTimeout() const
+    {
+        return m_flowTable.GetIdleTimeout();
+    }
+
+    /**
+     * Get the flows pinned by the FlowPinned multipath forwarding
+     * @returns the flow table
+     */
+    const FlowTable& GetFlowTable() const
+    {
+        return m_flowTable;
+    }
+
+    /**
+     * Set the composite score by which an alternate multipath path must beat
+     * the path in use for a preemptive route switch
+     * @param margin the margin
+     */
+    void SetPreemptiveSwitchMargin(double margin)
+    {
+        m_routingTable.SetMultipathSwitchMargin(margin);
+    }
+
+    /**
+     * Get the composite score by which an alternate multipath path must beat
+     * the path in use for a preemptive route switch
+     * @returns the margin
+     */
+    double GetPreemptiveSwitchMargin() const
+    {
+        return m_routingTable.GetMultipathSwitchMargin();
+    }
+
+    /**
+     * Set the number of routing table changes journaled (see RouteJournal)
+     * @param size the number of changes, 0 to journal none
+     */
+    void SetRouteJournalSize(uint32_t size)
+    {
+        m_routingTable.GetJournal().SetCapacity(size);
+    }
+
+    /**
+     * Get the number of routing table changes journaled
+     * @returns the number of changes
+     */
+    uint32_t GetRouteJournalSize() const
+    {
+        return m_routingTable.GetJournal().GetCapacity();
+    }
+
+    /**
+     * Set the weight of a MAC transmission outcome in the delivery ratio of
+     * a neighbor and in the stability of a multipath path
+     * @param weight the weight, 0 to 1
+     */
+    void SetDeliveryRatioWeight(double weight)
+    {
+        m_nb.SetDeliveryRatioWeight(weight);
+        m_routingTable.SetMultipathStabilityWeight(weight);
+    }
+
+    /**
+     * Get the weight of a MAC transmission outcome in the delivery ratios
+     * @returns the weight
+     */
+    double GetDeliveryRatioWeight() const
+    {
+        return m_nb.GetDeliveryRatioWeight();
+    }
+
     /**
      * Set broadcast enable flag
      * @param f enable broadcast flag
@@ -208,6 +332,51 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      */
     int64_t AssignStreams(int64_t stream);
 
+    /**
+     * Write the routing table, the neighbor list and the sequence number and
+     * RREQ id counters of this node in binary form. Lifetimes are stored
+     * relative to the current time. Routes still being discovered are left
+     * out, since their RREQ timers cannot be saved.
+     * @param os the stream to write to
+     */
+    void SaveState(std::ostream& os) const;
+
+    /**
+     * Read state written by SaveState(), possibly on another run of the same
+     * scenario. Saved lifetimes start from the current time. Routes already
+     * in the table, such as the local broadcast routes, are kept. Must be
+     * called once the interfaces of the node are up.
+     * @param is the stream to read from
+     */
+    void RestoreState(std::istream& is);
+
+    /**
+     * Install a valid route computed outside the protocol, for example from
+     * a known static topology. A route already in the table for dst is
+     * replaced.
+     * @param dst the destination
+     * @param nextHop the next hop, on the subnet of one of the AODV interfaces
+     * @param hops the hop count
+     * @param seqNo the destination sequence number
+     * @param lifetime the route lifetime
+     * @returns false if no AODV interface is on the subnet of nextHop
+     */
+    bool SeedRoute(Ipv4Address dst,
+                   Ipv4Address nextHop,
+                   uint16_t hops,
+                   uint32_t seqNo,
+                   Time lifetime);
+
+    /**
+     * Get the sequence number of this node, the one it advertises as a
+     * destination
+     * @returns the sequence number
+     */
+    uint32_t GetSeqNo() const
+    {
+        return m_seqNo;
+    }
+
   protected:
     void DoInitialize() override;
 
@@ -219,6 +388,29 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * @param mpdu the dropped MPDU
      */
     void NotifyTxError(WifiMacDropReason reason, Ptr<const WifiMpdu> mpdu);
+    /**
+     * Notify that an MPDU was acknowledged
+     *
+     * @param mpdu the acknowledged MPDU
+     */
+    void NotifyTxOk(Ptr<const WifiMpdu> mpdu);
+    /**
+     * Notify that a transmission of an MPDU was not acknowledged
+     *
+     * @param mpdu the MPDU
+     */
+    void NotifyTxFailed(Ptr<const WifiMpdu> mpdu);
+    /**
+     * Fold the outcome of a unicast frame carrying a data packet routed by
+     * this node, whether it originated the packet or forwards it, and whatever
+     * the destination (see TagRoutedData()), into the delivery ratio of the
+     * neighbor it was sent to and into the stability of the multipath path,
+     * to the IP destination of the packet, through that neighbor
+     *
+     * @param mpdu the MPDU
+     * @param success whether the MPDU was acknowledged
+     */
+    void NotifyTxOutcome(Ptr<const WifiMpdu> mpdu, bool success);
 
     // Protocol parameters.
     uint32_t m_rreqRetries; ///< Maximum number of retransmissions of RREQ with TTL = NetDiameter to
@@ -291,6 +483,8 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     DuplicatePacketDetection m_dpd;
     /// Handle neighbors
     Neighbors m_nb;
+    /// Pending RREP-ACKs and blacklisted neighbors
+    Blacklist m_blacklist;
     /// Number of RREQs used for RREQ rate control
     uint16_t m_rreqCount;
     /// Number of RERRs used for RERR rate control
@@ -450,15 +644,16 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * @param neighbor neighbor address
      */
     void SendReplyAck(Ipv4Address neighbor);
-    /** Initiate RERR
+    /** Initiate RERR. With MultipathFailover, routes moved to another path
+     * are left out of it.
      * @param nextHop next hop address
      */
     void SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop);
     /** Forward RERR
      * @param packet packet
-     * @param precursors list of addresses of the visited nodes
+     * @param precursors precursors of the unreachable destinations
      */
-    void SendRerrMessage(Ptr<Packet> packet, std::vector<Ipv4Address> precursors);
+    void SendRerrMessage(Ptr<Packet> packet, const std::vector<Ipv4Address>& precursors);
     /**
      * Send RERR message when no route to forward input packet. Unicast if there is reverse route to
      * originating node, broadcast otherwise.
@@ -470,7 +665,8 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     /** @} */
 
     /**
-     * Send packet to destination socket
+     * Send an AODV message to the AODV port of destination, marked so that
+     * the MAC feedback does not count it as data (see NotifyTxOutcome())
      * @param socket destination node socket
      * @param packet packet to send
      * @param destination destination node IP address
@@ -496,15 +692,36 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * @param dst the destination IP address
      */
     void RouteRequestTimerExpire(Ipv4Address dst);
-    /**
-     * Mark link to neighbor node as unidirectional for blacklistTimeout
-     *
-     * @param neighbor the IP address of the neighbor node
-     * @param blacklistTimeout the black list timeout time
-     */
-    void AckTimerExpire(Ipv4Address neighbor, Time blacklistTimeout);
     // =============== PENAMBAHAN MULTIPATH ==================
     bool m_multipathEnabled;
+    /// How data packets are spread over the multipath routes
+    MultipathSelection m_multipathForwarding;
+    /// Next hops of the flows, for FLOW_PINNED
+    FlowTable m_flowTable;
+    /// Whether broken routes fail over to their multipath routes
+    bool m_multipathFailover;
+    /// Whether route discovery looks for link-disjoint multipath routes
+    bool m_multipathDiscovery;
+    /// Maximum number of RREQ copies answered with m_multipathDiscovery
+    uint32_t m_multipathReplies;
+
+    /**
+     * Spread data packets over the multipath routes to their destination, as
+     * selected by the MultipathForwarding attribute. Only paths through a
+     * neighbor reached over the output device of route are used.
+     * @param route the route to the destination from the routing table
+     * @param header the IP header of the packet
+     * @param p the packet, without its IP header
+     * @param ports true if p starts with its TCP or UDP header, whose ports
+     *        are then part of the flow
+     * @param exclude a next hop not to send the packet to
+     * @returns the route to send the packet on, route itself if no other path is picked
+     */
+    Ptr<Ipv4Route> SelectMultipathRoute(Ptr<Ipv4Route> route,
+                                        const Ipv4Header& header,
+                                        Ptr<const Packet> p,
+                                        bool ports,
+                                        Ipv4Address exclude);
 
     // =============== BLE-MAODV ENHANCEMENTS (Enhanced Route Discovery Mechanism) ===============
     /**
@@ -530,16 +747,55 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     void ProcessEnhancedReply(const RrepHeader& rrepHeader, Ipv4Address sender);
 
     /**
-     * @brief Proactive route maintenance */
-    void CheckPathQuality();
+     * Queue a destination whose multipath paths were reranked for
+     * PreemptiveRouteSwitch(); called back by the routing table
+     * @param dst the destination
+     */
+    void NotifyMultipathRerank(Ipv4Address dst);
+    /// Run PreemptiveRouteSwitch() on the destinations queued since the last run
+    void ProcessReranks();
+    /**
+     * Read the routing table changes since the last call from the route
+     * journal, and queue for ProcessReranks() the destinations whose route
+     * moved to another next hop or broke while an alternate path led it. Their
+     * lead restarts from the route as it is now.
+     */
+    void CatchUpRouteChanges();
+    /**
+     * Switch the route to dst to its best multipath path once that path has
+     * beaten the path in use by the switch margin for m_switchDwell. Called
+     * whenever the paths to dst are reranked, when the dwell time of the
+     * leading path is over, and when the route to dst moved or broke while
+     * an alternate path led it (see CatchUpRouteChanges()).
+     * @param dst the destination
+     */
     void PreemptiveRouteSwitch(Ipv4Address dst);
 
+    /// An alternate path leading the path in use
+    struct SwitchCandidate
+    {
+        Ipv4Address nextHop; //!< Next hop of the alternate path
+        Time since;          //!< Time since which it leads
+        EventId check;       //!< Check when its dwell time is over
+    };
+
+    /// Time an alternate path must keep the lead for a preemptive switch
+    Time m_switchDwell;
+    /// The leading alternate path of each destination that has one
+    std::map<Ipv4Address, SwitchCandidate> m_switchCandidates;
+    /// Destinations reranked since the last ProcessReranks(), possibly repeated
+    std::vector<Ipv4Address> m_reranked;
+    /// Whether ProcessReranks() is scheduled
+    bool m_rerankScheduled;
+    /// The scheduled ProcessReranks()
+    EventId m_rerankEvent;
+    /// Next route journal event for CatchUpRouteChanges()
+    uint64_t m_journalCursor;
+
     // BLE-MAODV timers
     Timer m_metricsUpdateTimer;
-    Timer m_pathQualityTimer;
 
     void MetricsUpdateTimerExpire();
-    void PathQualityTimerExpire();
 
     // Node energy level (for simulation)
     double m_residualEnergy;
@@ -17,11 +17,14 @@
 
 #include "aodv-rtable.h"
 
+#include "ns3/abort.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 
 #include <algorithm>
+#include <cstdio>
 #include <iomanip>
+#include <limits>
 
 namespace ns3
 {
@@ -43,16 +46,14 @@ RoutingTableEntry::RoutingTableEntry(Ptr<NetDevice> dev,
                                      uint16_t hops,
                                      Ipv4Address nextHop,
                                      Time lifetime)
-    : m_ackTimer(Timer::CANCEL_ON_DESTROY),
-      m_validSeqNo(vSeqNo),
+    : m_validSeqNo(vSeqNo),
       m_seqNo(seqNo),
       m_hops(hops),
       m_lifeTime(lifetime + Simulator::Now()),
+      m_touched(Time::Min()),
       m_iface(iface),
       m_flag(VALID),
-      m_reqCount(0),
-      m_blackListState(false),
-      m_blackListTimeout(Simulator::Now())
+      m_reqCount(0)
 {
     m_ipv4Route = Create<Ipv4Route>();
     m_ipv4Route->SetDestination(dst);
@@ -61,36 +62,56 @@ RoutingTableEntry::RoutingTableEntry(Ptr<NetDevice> dev,
     m_ipv4Route->SetOutputDevice(dev);
 }
 
+RoutingTableEntry::RoutingTableEntry()
+    : m_validSeqNo(false),
+      m_seqNo(0),
+      m_hops(0),
+      // As the full constructor with its default lifetime of Simulator::Now()
+      m_lifeTime(Simulator::Now() + Simulator::Now()),
+      m_touched(Time::Min()),
+      m_flag(VALID),
+      m_reqCount(0)
+{
+}
+
 RoutingTableEntry::~RoutingTableEntry()
 {
 }
 
+Ptr<Ipv4Route>
+RoutingTableEntry::Route() const
+{
+    if (!m_ipv4Route)
+    {
+        m_ipv4Route = Create<Ipv4Route>();
+        m_ipv4Route->SetDestination(Ipv4Address());
+        m_ipv4Route->SetGateway(Ipv4Address());
+        m_ipv4Route->SetSource(Ipv4InterfaceAddress().GetLocal());
+    }
+    return m_ipv4Route;
+}
+
 bool
 RoutingTableEntry::InsertPrecursor(Ipv4Address id)
 {
     NS_LOG_FUNCTION(this << id);
-    if (!LookupPrecursor(id))
-    {
-        m_precursorList.push_back(id);
-        return true;
-    }
-    else
+    auto i = std::lower_bound(m_precursors.begin(), m_precursors.end(), id);
+    if (i != m_precursors.end() && *i == id)
     {
         return false;
     }
+    m_precursors.insert(i, id);
+    return true;
 }
 
 bool
 RoutingTableEntry::LookupPrecursor(Ipv4Address id)
 {
     NS_LOG_FUNCTION(this << id);
-    for (auto i = m_precursorList.begin(); i != m_precursorList.end(); ++i)
+    if (std::binary_search(m_precursors.begin(), m_precursors.end(), id))
     {
-        if (*i == id)
-        {
-            NS_LOG_LOGIC("Precursor " << id << " found");
-            return true;
-        }
+        NS_LOG_LOGIC("Precursor " << id << " found");
+        return true;
     }
     NS_LOG_LOGIC("Precursor " << id << " not found");
     return false;
@@ -100,17 +121,14 @@ bool
 RoutingTableEntry::DeletePrecursor(Ipv4Address id)
 {
     NS_LOG_FUNCTION(this << id);
-    auto i = std::remove(m_precursorList.begin(), m_precursorList.end(), id);
-    if (i == m_precursorList.end())
+    auto i = std::lower_bound(m_precursors.begin(), m_precursors.end(), id);
+    if (i == m_precursors.end() || *i != id)
     {
         NS_LOG_LOGIC("Precursor " << id << " not found");
         return false;
     }
-    else
-    {
-        NS_LOG_LOGIC("Precursor " << id << " found");
-        m_precursorList.erase(i, m_precursorList.end());
-    }
+    m_precursors.erase(i);
+    NS_LOG_LOGIC("Precursor " << id << " found");
     return true;
 }
 
@@ -118,41 +136,37 @@ void
 RoutingTableEntry::DeleteAllPrecursors()
 {
     NS_LOG_FUNCTION(this);
-    m_precursorList.clear();
+    m_precursors.clear();
 }
 
 bool
 RoutingTableEntry::IsPrecursorListEmpty() const
 {
-    return m_precursorList.empty();
+    return m_precursors.empty();
 }
 
 void
 RoutingTableEntry::GetPrecursors(std::vector<Ipv4Address>& prec) const
 {
     NS_LOG_FUNCTION(this);
-    if (IsPrecursorListEmpty())
-    {
-        return;
-    }
-    for (auto i = m_precursorList.begin(); i != m_precursorList.end(); ++i)
+    for (const auto& precursor : m_precursors)
     {
-        bool result = true;
-        for (auto j = prec.begin(); j != prec.end(); ++j)
-        {
-            if (*j == *i)
-            {
-                result = false;
-                break;
-            }
-        }
-        if (result)
+        if (std::find(prec.begin(), prec.end(), precursor) == prec.end())
         {
-            prec.push_back(*i);
+            prec.push_back(precursor);
         }
     }
 }
 
+void
+RoutingTableEntry::MergePrecursors(std::vector<Ipv4Address>& precursors) const
+{
+    auto middle = static_cast<std::ptrdiff_t>(precursors.size());
+    precursors.insert(precursors.end(), m_precursors.begin(), m_precursors.end());
+    std::inplace_merge(precursors.begin(), precursors.begin() + middle, precursors.end());
+    precursors.erase(std::unique(precursors.begin(), precursors.end()), precursors.end());
+}
+
 void
 RoutingTableEntry::Invalidate(Time badLinkLifetime)
 {
@@ -164,6 +178,81 @@ RoutingTableEntry::Invalidate(Time badLinkLifetime)
     m_flag = INVALID;
     m_reqCount = 0;
     m_lifeTime = badLinkLifetime + Simulator::Now();
+    m_touched = Time::Min();
+}
+
+/**
+ * Write an address in dotted decimal form, left aligned in a 16 character column
+ * @param p where to write
+ * @param addr the address
+ * @returns the end of the column
+ */
+static char*
+PrintColumn(char* p, Ipv4Address addr)
+{
+    uint32_t a = addr.Get();
+    int n = std::snprintf(p,
+                          17,
+                          "%u.%u.%u.%u",
+                          (a >> 24) & 0xff,
+                          (a >> 16) & 0xff,
+                          (a >> 8) & 0xff,
+                          a & 0xff);
+    std::fill(p + n, p + 16, ' ');
+    return p + 16;
+}
+
+/**
+ * Print one line of the routing table, as RoutingTable::Print() lays it out,
+ * without temporary strings
+ * @param os the output stream
+ * @param dst the destination
+ * @param gateway the next hop
+ * @param iface the local address of the output interface
+ * @param flag the route state
+ * @param expire the remaining lifetime
+ * @param hops the hop count
+ * @param unit the time unit of expire
+ */
+static void
+PrintRoute(std::ostream& os,
+           Ipv4Address dst,
+           Ipv4Address gateway,
+           Ipv4Address iface,
+           RouteFlags flag,
+           Time expire,
+           uint16_t hops,
+           Time::Unit unit)
+{
+    static const char* const flags[] = {"UP", "DOWN", "IN_SEARCH"};
+    static const char* const units[] = {"y", "d", "h", "min", "s", "ms", "us", "ns", "ps", "fs"};
+    char line[128];
+    char* p = PrintColumn(line, dst);
+    p = PrintColumn(p, gateway);
+    p = PrintColumn(p, iface);
+    int n = std::snprintf(p, 17, "%s", flags[flag]);
+    std::fill(p + n, p + 16, ' ');
+    p += 16;
+    if (unit < Time::LAST)
+    {
+        n = std::snprintf(p, 32, "%+.2f%s", expire.ToDouble(unit), units[unit]);
+        if (n < 16)
+        {
+            std::fill(p + n, p + 16, ' ');
+            n = 16;
+        }
+        p += n;
+    }
+    else
+    {
+        // Time::AUTO picks the unit from the value; let the stream do it
+        os.write(line, p - line);
+        os << std::resetiosflags(std::ios::adjustfield) << std::setiosflags(std::ios::left)
+           << std::setw(16) << std::setprecision(2) << expire.As(unit);
+        p = line;
+    }
+    p += std::snprintf(p, 8, "%u\n", hops);
+    os.write(line, p - line);
 }
 
 void
@@ -173,39 +262,14 @@ RoutingTableEntry::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = T
     // Copy the current ostream state
     std::ios oldState(nullptr);
     oldState.copyfmt(*os);
-
-    *os << std::resetiosflags(std::ios::adjustfield) << std::setiosflags(std::ios::left);
-
-    std::ostringstream dest;
-    std::ostringstream gw;
-    std::ostringstream iface;
-    std::ostringstream expire;
-    dest << m_ipv4Route->GetDestination();
-    gw << m_ipv4Route->GetGateway();
-    iface << m_iface.GetLocal();
-    expire << std::setprecision(2) << (m_lifeTime - Simulator::Now()).As(unit);
-    *os << std::setw(16) << dest.str();
-    *os << std::setw(16) << gw.str();
-    *os << std::setw(16) << iface.str();
-    *os << std::setw(16);
-    switch (m_flag)
-    {
-    case VALID: {
-        *os << "UP";
-        break;
-    }
-    case INVALID: {
-        *os << "DOWN";
-        break;
-    }
-    case IN_SEARCH: {
-        *os << "IN_SEARCH";
-        break;
-    }
-    }
-
-    *os << std::setw(16) << expire.str();
-    *os << m_hops << std::endl;
+    PrintRoute(*os,
+               GetDestination(),
+               GetNextHop(),
+               m_iface.GetLocal(),
+               m_flag,
+               GetLifeTime(),
+               m_hops,
+               unit);
     // Restore the previous ostream state
     (*os).copyfmt(oldState);
 }
@@ -215,27 +279,38 @@ RoutingTableEntry::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = T
  */
 
 RoutingTable::RoutingTable(Time t)
-    : m_badLinkLifetime(t)
+    : m_badLinkLifetime(t),
+      m_multipathStabilityWeight(0.1),
+      m_multipathSwitchMargin(0.1),
+      m_compact(false),
+      m_rowCount(0)
 {
 }
 
+void
+RoutingTable::SetCompact(bool compact)
+{
+    NS_ASSERT(GetSize() == 0);
+    m_compact = compact;
+}
+
 bool
 RoutingTable::LookupRoute(Ipv4Address id, RoutingTableEntry& rt)
 {
     NS_LOG_FUNCTION(this << id);
     Purge();
-    if (m_ipv4AddressEntry.empty())
+    if (GetSize() == 0)
     {
         NS_LOG_LOGIC("Route to " << id << " not found; m_ipv4AddressEntry is empty");
         return false;
     }
-    auto i = m_ipv4AddressEntry.find(id);
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* i = Find(id);
+    if (!i)
     {
         NS_LOG_LOGIC("Route to " << id << " not found");
         return false;
     }
-    rt = i->second;
+    rt = *i;
     NS_LOG_LOGIC("Route to " << id << " found");
     return true;
 }
@@ -254,13 +329,29 @@ RoutingTable::LookupValidRoute(Ipv4Address id, RoutingTableEntry& rt)
     return (rt.GetFlag() == VALID);
 }
 
+const RoutingTableEntry*
+RoutingTable::FindRoute(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    Purge();
+    const RoutingTableEntry* rt = Find(dst);
+    if (!rt)
+    {
+        NS_LOG_LOGIC("Route to " << dst << " not found");
+        return nullptr;
+    }
+    NS_LOG_LOGIC("Route to " << dst << " found");
+    return rt;
+}
+
 bool
 RoutingTable::DeleteRoute(Ipv4Address dst)
 {
     NS_LOG_FUNCTION(this << dst);
     Purge();
-    if (m_ipv4AddressEntry.erase(dst) != 0)
+    if (Find(dst))
     {
+        Erase(dst);
         NS_LOG_LOGIC("Route deletion to " << dst << " successful");
         return true;
     }
@@ -277,41 +368,329 @@ RoutingTable::AddRoute(RoutingTableEntry& rt)
     {
         rt.SetRreqCnt(0);
     }
-    auto result = m_ipv4AddressEntry.insert(std::make_pair(rt.GetDestination(), rt));
-    return result.second;
+    bool inserted = Insert(rt);
+    if (inserted)
+    {
+        ScheduleExpiry(rt);
+        IndexNextHop(rt);
+        m_journal.Record(ROUTE_ADDED, rt.GetDestination(), rt.GetNextHop());
+    }
+    return inserted;
 }
 
 bool
 RoutingTable::Update(RoutingTableEntry& rt)
 {
     NS_LOG_FUNCTION(this);
-    auto i = m_ipv4AddressEntry.find(rt.GetDestination());
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* i = Find(rt.GetDestination());
+    if (!i)
     {
         NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " fails; not found");
         return false;
     }
-    i->second = rt;
-    if (i->second.GetFlag() != IN_SEARCH)
+    RouteFlags flag = i->GetFlag();
+    Ipv4Address nextHop = i->GetNextHop();
+    *i = rt;
+    CompleteUpdate(*i);
+    Store(*i);
+    RecordUpdate(flag, nextHop, *i);
+    return true;
+}
+
+void
+RoutingTable::CompleteUpdate(RoutingTableEntry& rt)
+{
+    if (rt.GetFlag() != IN_SEARCH)
     {
         NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " set RreqCnt to 0");
-        i->second.SetRreqCnt(0);
+        rt.SetRreqCnt(0);
+    }
+    ScheduleExpiry(rt);
+    IndexNextHop(rt);
+}
+
+void
+RoutingTable::RecordUpdate(RouteFlags flag, Ipv4Address nextHop, const RoutingTableEntry& rt)
+{
+    RouteEventType type = ROUTE_UPDATED;
+    if (flag == VALID && rt.GetFlag() == INVALID)
+    {
+        type = ROUTE_INVALIDATED;
+    }
+    else if (nextHop != rt.GetNextHop())
+    {
+        type = ROUTE_NEXT_HOP_CHANGED;
+    }
+    m_journal.Record(type, rt.GetDestination(), rt.GetNextHop());
+}
+
+void
+RoutingTable::IndexNextHop(const RoutingTableEntry& rt)
+{
+    if (m_compact)
+    {
+        return;
+    }
+    Ipv4Address dst = rt.GetDestination();
+    Ipv4Address nextHop = rt.GetNextHop();
+    auto i = m_indexedNextHop.find(dst);
+    if (i != m_indexedNextHop.end())
+    {
+        if (i->second == nextHop)
+        {
+            return;
+        }
+        UnindexNextHop(dst);
+    }
+    m_indexedNextHop.insert(std::make_pair(dst, nextHop));
+    m_nextHopIndex.insert(std::make_pair(nextHop, std::vector<Ipv4Address>()))
+        .first->second.push_back(dst);
+}
+
+void
+RoutingTable::UnindexNextHop(Ipv4Address dst)
+{
+    auto i = m_indexedNextHop.find(dst);
+    NS_ASSERT(i != m_indexedNextHop.end());
+    auto j = m_nextHopIndex.find(i->second);
+    NS_ASSERT(j != m_nextHopIndex.end());
+    std::vector<Ipv4Address>& dsts = j->second;
+    *std::find(dsts.begin(), dsts.end(), dst) = dsts.back();
+    dsts.pop_back();
+    if (dsts.empty())
+    {
+        m_nextHopIndex.erase(j);
     }
+    m_indexedNextHop.erase(i);
+}
+
+RoutingTableEntry*
+RoutingTable::Find(Ipv4Address dst)
+{
+    if (m_compact)
+    {
+        uint32_t id = FindRow(dst);
+        if (id == AddressIndex::NONE)
+        {
+            return nullptr;
+        }
+        LoadRow(id, m_scratch);
+        return &m_scratch;
+    }
+    auto i = m_ipv4AddressEntry.find(dst);
+    return i == m_ipv4AddressEntry.end() ? nullptr : &i->second;
+}
+
+void
+RoutingTable::Store(const RoutingTableEntry& rt)
+{
+    if (m_compact)
+    {
+        StoreRow(m_addressIndex.GetId(rt.GetDestination()), rt);
+    }
+}
+
+bool
+RoutingTable::Insert(const RoutingTableEntry& rt)
+{
+    if (!m_compact)
+    {
+        return m_ipv4AddressEntry.insert(std::make_pair(rt.GetDestination(), rt)).second;
+    }
+    uint32_t id = m_addressIndex.GetId(rt.GetDestination());
+    m_rows.Reserve(id);
+    if (m_rows.m_state[id] & ROW_PRESENT)
+    {
+        return false;
+    }
+    ++m_rowCount;
+    StoreRow(id, rt);
     return true;
 }
 
+void
+RoutingTable::Erase(Ipv4Address dst)
+{
+    if (!m_compact)
+    {
+        auto i = m_ipv4AddressEntry.find(dst);
+        NS_ASSERT(i != m_ipv4AddressEntry.end());
+        m_journal.Record(ROUTE_DELETED, dst, i->second.GetNextHop());
+        m_ipv4AddressEntry.erase(i);
+        UnindexNextHop(dst);
+        return;
+    }
+    uint32_t id = FindRow(dst);
+    NS_ASSERT(id != AddressIndex::NONE);
+    m_journal.Record(ROUTE_DELETED, dst, m_addressIndex.GetAddress(m_rows.m_nextHop[id]));
+    UnindexRow(id);
+    m_rows.m_state[id] = 0;
+    m_rowPrecursors.erase(dst);
+    --m_rowCount;
+}
+
+uint32_t
+RoutingTable::ToTicks(Time t)
+{
+    NS_ABORT_MSG_IF(Simulator::Now() >= MilliSeconds(UINT32_MAX),
+                    "The compact routing table layout is limited to 2^32 ms of simulated time");
+    int64_t ms = t.GetMilliSeconds();
+    if (MilliSeconds(ms) < t)
+    {
+        ++ms;
+    }
+    return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(ms, 0), UINT32_MAX));
+}
+
+uint32_t
+RoutingTable::FindRow(Ipv4Address dst) const
+{
+    uint32_t id = m_addressIndex.FindId(dst);
+    if (id >= m_rows.m_state.size() || !(m_rows.m_state[id] & ROW_PRESENT))
+    {
+        return AddressIndex::NONE;
+    }
+    return id;
+}
+
+void
+RoutingTable::LoadRow(uint32_t id, RoutingTableEntry& rt) const
+{
+    Ipv4Address dst = m_addressIndex.GetAddress(id);
+    uint8_t state = m_rows.m_state[id];
+    const auto& iface = m_rowIfaces[m_rows.m_iface[id]];
+    // Reuse the route of rt unless a caller of GetRoute() still holds it
+    if (!rt.m_ipv4Route || rt.m_ipv4Route->GetReferenceCount() > 1)
+    {
+        rt.m_ipv4Route = Create<Ipv4Route>();
+    }
+    rt.m_ipv4Route->SetDestination(dst);
+    rt.m_ipv4Route->SetGateway(m_addressIndex.GetAddress(m_rows.m_nextHop[id]));
+    rt.m_ipv4Route->SetSource(iface.first.GetLocal());
+    rt.m_ipv4Route->SetOutputDevice(iface.second);
+    rt.m_validSeqNo = state & ROW_VALID_SEQNO;
+    rt.m_seqNo = m_rows.m_seqNo[id];
+    rt.m_hops = m_rows.m_hops[id];
+    rt.m_lifeTime = MilliSeconds(m_rows.m_lifetime[id]);
+    rt.m_touched = Time::Min();
+    rt.m_iface = iface.first;
+    rt.m_flag = static_cast<RouteFlags>(state & ROW_FLAG_MASK);
+    rt.m_reqCount = m_rows.m_reqCount[id];
+    auto precursors = m_rowPrecursors.find(dst);
+    if (precursors != m_rowPrecursors.end())
+    {
+        rt.m_precursors = precursors->second;
+    }
+    else
+    {
+        rt.m_precursors.clear();
+    }
+}
+
+void
+RoutingTable::StoreRow(uint32_t id, const RoutingTableEntry& rt)
+{
+    Ipv4Address dst = rt.GetDestination();
+    auto iface = std::make_pair(rt.GetInterface(), rt.GetOutputDevice());
+    auto i = std::find(m_rowIfaces.begin(), m_rowIfaces.end(), iface);
+    if (i == m_rowIfaces.end())
+    {
+        NS_ABORT_MSG_IF(m_rowIfaces.size() > UINT8_MAX, "Too many interfaces for the compact layout");
+        i = m_rowIfaces.insert(i, iface);
+    }
+    uint8_t state = ROW_PRESENT | rt.GetFlag();
+    if (rt.GetValidSeqNo())
+    {
+        state |= ROW_VALID_SEQNO;
+    }
+    // Keep a pending touch: the stored lifetime may still be ahead of the queued events
+    if (rt.m_touched > rt.m_lifeTime || (m_rows.m_state[id] & ROW_TOUCHED))
+    {
+        state |= ROW_TOUCHED;
+    }
+    if (rt.IsPrecursorListEmpty())
+    {
+        m_rowPrecursors.erase(dst);
+    }
+    else
+    {
+        m_rowPrecursors.insert(std::make_pair(dst, std::vector<Ipv4Address>())).first->second =
+            rt.GetPrecursorSet();
+    }
+    uint32_t nextHop = m_addressIndex.GetId(rt.GetNextHop());
+    if (!(m_rows.m_state[id] & ROW_PRESENT) || m_rows.m_nextHop[id] != nextHop)
+    {
+        if (m_rows.m_state[id] & ROW_PRESENT)
+        {
+            UnindexRow(id);
+        }
+        if (nextHop >= m_rowsByNextHop.size())
+        {
+            m_rowsByNextHop.resize(nextHop + 1);
+        }
+        m_rowsByNextHop[nextHop].push_back(id);
+    }
+    m_rows.m_seqNo[id] = rt.GetSeqNo();
+    m_rows.m_lifetime[id] = ToTicks(rt.GetLifeTime() + Simulator::Now());
+    m_rows.m_nextHop[id] = nextHop;
+    m_rows.m_hops[id] = std::min<uint16_t>(rt.GetHop(), UINT8_MAX);
+    m_rows.m_state[id] = state;
+    m_rows.m_reqCount[id] = rt.GetRreqCnt();
+    m_rows.m_iface[id] = i - m_rowIfaces.begin();
+}
+
+void
+RoutingTable::UnindexRow(uint32_t id)
+{
+    std::vector<uint32_t>& ids = m_rowsByNextHop[m_rows.m_nextHop[id]];
+    *std::find(ids.begin(), ids.end(), id) = ids.back();
+    ids.pop_back();
+}
+
+void
+RoutingTable::RouteRows::Reserve(uint32_t id)
+{
+    if (id < m_state.size())
+    {
+        return;
+    }
+    m_seqNo.resize(id + 1);
+    m_lifetime.resize(id + 1);
+    m_nextHop.resize(id + 1);
+    m_hops.resize(id + 1);
+    m_state.resize(id + 1, 0);
+    m_reqCount.resize(id + 1);
+    m_iface.resize(id + 1);
+}
+
+void
+RoutingTable::RouteRows::Clear()
+{
+    m_seqNo.clear();
+    m_lifetime.clear();
+    m_nextHop.clear();
+    m_hops.clear();
+    m_state.clear();
+    m_reqCount.clear();
+    m_iface.clear();
+}
+
 bool
 RoutingTable::SetEntryState(Ipv4Address id, RouteFlags state)
 {
     NS_LOG_FUNCTION(this);
-    auto i = m_ipv4AddressEntry.find(id);
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* i = Find(id);
+    if (!i)
     {
         NS_LOG_LOGIC("Route set entry state to " << id << " fails; not found");
         return false;
     }
-    i->second.SetFlag(state);
-    i->second.SetRreqCnt(0);
+    RouteFlags flag = i->GetFlag();
+    i->SetFlag(state);
+    i->SetRreqCnt(0);
+    ScheduleExpiry(*i);
+    Store(*i);
+    RecordUpdate(flag, i->GetNextHop(), *i);
     NS_LOG_LOGIC("Route set entry state to " << id << ": new state is " << state);
     return true;
 }
@@ -323,49 +702,115 @@ RoutingTable::GetListOfDestinationWithNextHop(Ipv4Address nextHop,
     NS_LOG_FUNCTION(this);
     Purge();
     unreachable.clear();
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+    if (m_compact)
     {
-        if (i->second.GetNextHop() == nextHop)
+        uint32_t nextHopId = m_addressIndex.FindId(nextHop);
+        if (nextHopId >= m_rowsByNextHop.size())
+        {
+            return;
+        }
+        for (uint32_t id : m_rowsByNextHop[nextHopId])
         {
-            NS_LOG_LOGIC("Unreachable insert " << i->first << " " << i->second.GetSeqNo());
-            unreachable.insert(std::make_pair(i->first, i->second.GetSeqNo()));
+            Ipv4Address dst = m_addressIndex.GetAddress(id);
+            NS_LOG_LOGIC("Unreachable insert " << dst << " " << m_rows.m_seqNo[id]);
+            unreachable.insert(std::make_pair(dst, m_rows.m_seqNo[id]));
         }
+        return;
+    }
+    auto j = m_nextHopIndex.find(nextHop);
+    if (j == m_nextHopIndex.end())
+    {
+        return;
+    }
+    for (auto dst = j->second.begin(); dst != j->second.end(); ++dst)
+    {
+        auto i = m_ipv4AddressEntry.find(*dst);
+        NS_ASSERT(i != m_ipv4AddressEntry.end() && i->second.GetNextHop() == nextHop);
+        NS_LOG_LOGIC("Unreachable insert " << i->first << " " << i->second.GetSeqNo());
+        unreachable.insert(std::make_pair(i->first, i->second.GetSeqNo()));
     }
 }
 
-void
+bool
+RoutingTable::TouchRoute(Ipv4Address dst, Time lifetime)
+{
+    NS_LOG_FUNCTION(this << dst << lifetime);
+    Purge();
+    if (m_compact)
+    {
+        uint32_t id = FindRow(dst);
+        if (id == AddressIndex::NONE || (m_rows.m_state[id] & ROW_FLAG_MASK) != VALID)
+        {
+            return false;
+        }
+        m_rows.m_reqCount[id] = 0;
+        uint32_t touched = ToTicks(lifetime + Simulator::Now());
+        if (touched > m_rows.m_lifetime[id])
+        {
+            m_rows.m_lifetime[id] = touched;
+            m_rows.m_state[id] |= ROW_TOUCHED;
+        }
+        return true;
+    }
+    auto i = m_ipv4AddressEntry.find(dst);
+    if (i == m_ipv4AddressEntry.end() || i->second.GetFlag() != VALID)
+    {
+        return false;
+    }
+    i->second.SetRreqCnt(0);
+    i->second.Touch(lifetime);
+    return true;
+}
+
+uint32_t
 RoutingTable::InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unreachable)
 {
     NS_LOG_FUNCTION(this);
     Purge();
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+    uint32_t invalidated = 0;
+    for (auto j = unreachable.begin(); j != unreachable.end(); ++j)
     {
-        for (auto j = unreachable.begin(); j != unreachable.end(); ++j)
+        RoutingTableEntry* i = Find(j->first);
+        if (i && i->GetFlag() == VALID)
         {
-            if ((i->first == j->first) && (i->second.GetFlag() == VALID))
-            {
-                NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
-                i->second.Invalidate(m_badLinkLifetime);
-            }
+            NS_LOG_LOGIC("Invalidate route with destination address " << j->first);
+            i->Invalidate(m_badLinkLifetime);
+            ScheduleExpiry(*i);
+            Store(*i);
+            m_journal.Record(ROUTE_INVALIDATED, j->first, i->GetNextHop());
+            ++invalidated;
         }
     }
+    return invalidated;
 }
 
 void
 RoutingTable::DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface)
 {
     NS_LOG_FUNCTION(this);
-    if (m_ipv4AddressEntry.empty())
+    if (GetSize() == 0)
+    {
+        return;
+    }
+    if (m_compact)
     {
+        for (uint32_t id = 0; id < m_rows.m_state.size(); ++id)
+        {
+            if ((m_rows.m_state[id] & ROW_PRESENT) &&
+                m_rowIfaces[m_rows.m_iface[id]].first == iface)
+            {
+                Erase(m_addressIndex.GetAddress(id));
+            }
+        }
         return;
     }
     for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end();)
     {
         if (i->second.GetInterface() == iface)
         {
-            auto tmp = i;
-            ++i;
-            m_ipv4AddressEntry.erase(tmp);
+            m_journal.Record(ROUTE_DELETED, i->first, i->second.GetNextHop());
+            UnindexNextHop(i->first);
+            i = m_ipv4AddressEntry.erase(i);
         }
         else
         {
@@ -374,46 +819,148 @@ RoutingTable::DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface)
     }
 }
 
+void
+RoutingTable::ScheduleExpiry(const RoutingTableEntry& rt)
+{
+    if (m_compact)
+    {
+        uint32_t id = m_addressIndex.GetId(rt.GetDestination());
+        uint64_t lifetime = ToTicks(rt.GetLifeTime() + Simulator::Now());
+        if (m_rowExpiryQueue.size() > 2 * m_rowCount + 16)
+        {
+            std::vector<uint64_t> events;
+            events.reserve(m_rowCount);
+            for (uint32_t row = 0; row < m_rows.m_state.size(); ++row)
+            {
+                if ((m_rows.m_state[row] & ROW_PRESENT) && row != id)
+                {
+                    events.push_back(uint64_t(m_rows.m_lifetime[row]) << 32 | row);
+                }
+            }
+            events.push_back(lifetime << 32 | id);
+            m_rowExpiryQueue = RowExpiryQueue(std::greater<uint64_t>(), std::move(events));
+            return;
+        }
+        m_rowExpiryQueue.push(lifetime << 32 | id);
+        return;
+    }
+    // Stale events accumulate as lifetimes get refreshed; rebuild the queue
+    // from the table once they outnumber the live entries
+    if (m_expiryQueue.size() > 2 * m_ipv4AddressEntry.size() + 16)
+    {
+        std::vector<ExpiryEvent> events;
+        events.reserve(m_ipv4AddressEntry.size());
+        for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+        {
+            events.emplace_back(i->second.GetLifeTime() + Simulator::Now(), i->first);
+        }
+        m_expiryQueue = ExpiryQueue(std::greater<ExpiryEvent>(), std::move(events));
+        return;
+    }
+    m_expiryQueue.emplace(rt.GetLifeTime() + Simulator::Now(), rt.GetDestination());
+}
+
 void
 RoutingTable::Purge()
 {
     NS_LOG_FUNCTION(this);
-    if (m_ipv4AddressEntry.empty())
+    Time now = Simulator::Now();
+    if (m_compact)
     {
-        return;
+        PurgeRows();
     }
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end();)
+    while (!m_expiryQueue.empty() && m_expiryQueue.top().first < now)
     {
-        if (i->second.GetLifeTime().IsStrictlyNegative())
+        Ipv4Address dst = m_expiryQueue.top().second;
+        m_expiryQueue.pop();
+        auto i = m_ipv4AddressEntry.find(dst);
+        // Skip events of deleted entries and of entries refreshed since
+        if (i == m_ipv4AddressEntry.end())
         {
-            if (i->second.GetFlag() == INVALID)
-            {
-                auto tmp = i;
-                ++i;
-                m_ipv4AddressEntry.erase(tmp);
-            }
-            else if (i->second.GetFlag() == VALID)
-            {
-                NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
-                i->second.Invalidate(m_badLinkLifetime);
-                ++i;
-            }
-            else
+            continue;
+        }
+        // Touches queue no events of their own, so queue the expiry they extended to
+        bool extended = i->second.FoldTouch();
+        if (!i->second.GetLifeTime().IsStrictlyNegative())
+        {
+            if (extended)
             {
-                ++i;
+                ScheduleExpiry(i->second);
             }
+            continue;
         }
-        else
+        if (i->second.GetFlag() == INVALID)
         {
-            ++i;
+            m_journal.Record(ROUTE_DELETED, dst, i->second.GetNextHop());
+            UnindexNextHop(dst);
+            m_ipv4AddressEntry.erase(i);
+        }
+        else if (i->second.GetFlag() == VALID)
+        {
+            NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
+            i->second.Invalidate(m_badLinkLifetime);
+            ScheduleExpiry(i->second);
+            m_journal.Record(ROUTE_EXPIRED, dst, i->second.GetNextHop());
         }
+        // An expired IN_SEARCH entry stays until its state changes, which queues a new event
     }
     // =========== PENAMBAHAN MULTIPATH ==============
     PurgeMultipathRoutes();
 }
 
 void
-RoutingTable::Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const
+RoutingTable::PurgeRows()
+{
+    Time now = Simulator::Now();
+    while (!m_rowExpiryQueue.empty() &&
+           MilliSeconds(m_rowExpiryQueue.top() >> 32) < now)
+    {
+        uint32_t id = static_cast<uint32_t>(m_rowExpiryQueue.top());
+        uint32_t lifetime = static_cast<uint32_t>(m_rowExpiryQueue.top() >> 32);
+        m_rowExpiryQueue.pop();
+        uint8_t& state = m_rows.m_state[id];
+        // Skip events of deleted rows and of rows refreshed since
+        if (!(state & ROW_PRESENT))
+        {
+            continue;
+        }
+        if (m_rows.m_lifetime[id] > lifetime)
+        {
+            // Touches queue no events of their own, so queue the expiry they extended to
+            if (state & ROW_TOUCHED)
+            {
+                state &= ~ROW_TOUCHED;
+                m_rowExpiryQueue.push(uint64_t(m_rows.m_lifetime[id]) << 32 | id);
+            }
+            continue;
+        }
+        if (!(MilliSeconds(m_rows.m_lifetime[id]) < now))
+        {
+            continue;
+        }
+        RouteFlags flag = static_cast<RouteFlags>(state & ROW_FLAG_MASK);
+        if (flag == INVALID)
+        {
+            Erase(m_addressIndex.GetAddress(id));
+        }
+        else if (flag == VALID)
+        {
+            NS_LOG_LOGIC("Invalidate route with destination address "
+                         << m_addressIndex.GetAddress(id));
+            state = (state & ~(ROW_FLAG_MASK | ROW_TOUCHED)) | INVALID;
+            m_rows.m_reqCount[id] = 0;
+            m_rows.m_lifetime[id] = ToTicks(m_badLinkLifetime + now);
+            m_rowExpiryQueue.push(uint64_t(m_rows.m_lifetime[id]) << 32 | id);
+            m_journal.Record(ROUTE_EXPIRED,
+                             m_addressIndex.GetAddress(id),
+                             m_addressIndex.GetAddress(m_rows.m_nextHop[id]));
+        }
+        // An expired IN_SEARCH entry stays until its state changes, which queues a new event
+    }
+}
+
+void
+RoutingTable::Purge(AddressMap<RoutingTableEntry>& table) const
 {
     NS_LOG_FUNCTION(this);
     if (table.empty())
@@ -426,9 +973,7 @@ RoutingTable::Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const
         {
             if (i->second.GetFlag() == INVALID)
             {
-                auto tmp = i;
-                ++i;
-                table.erase(tmp);
+                i = table.erase(i);
             }
             else if (i->second.GetFlag() == VALID)
             {
@@ -448,28 +993,105 @@ RoutingTable::Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const
     }
 }
 
-bool
-RoutingTable::MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeout)
+void
+RoutingTable::GetRoutes(std::vector<RoutingTableEntry>& routes) const
 {
-    NS_LOG_FUNCTION(this << neighbor << blacklistTimeout.As(Time::S));
-    auto i = m_ipv4AddressEntry.find(neighbor);
-    if (i == m_ipv4AddressEntry.end())
+    AddressMap<RoutingTableEntry> table;
+    if (m_compact)
     {
-        NS_LOG_LOGIC("Mark link unidirectional to  " << neighbor << " fails; not found");
-        return false;
+        for (uint32_t id = 0; id < m_rows.m_state.size(); ++id)
+        {
+            if (m_rows.m_state[id] & ROW_PRESENT)
+            {
+                RoutingTableEntry rt;
+                LoadRow(id, rt);
+                table.insert(std::make_pair(rt.GetDestination(), rt));
+            }
+        }
+    }
+    else
+    {
+        table = m_ipv4AddressEntry;
+    }
+    Purge(table);
+    routes.clear();
+    routes.reserve(table.size());
+    for (auto i = table.begin(); i != table.end(); ++i)
+    {
+        routes.push_back(i->second);
+    }
+    // The hash table is unordered; return the routes in address order
+    std::sort(routes.begin(),
+              routes.end(),
+              [](const RoutingTableEntry& a, const RoutingTableEntry& b) {
+                  return a.GetDestination() < b.GetDestination();
+              });
+}
+
+template <typename F>
+void
+RoutingTable::ForEachRoute(F fn) const
+{
+    RouteView view;
+    auto show = [this, &view, &fn]() {
+        if (view.expire.IsStrictlyNegative())
+        {
+            if (view.flag == INVALID)
+            {
+                return;
+            }
+            if (view.flag == VALID)
+            {
+                view.flag = INVALID;
+                view.expire = m_badLinkLifetime;
+            }
+        }
+        fn(view);
+    };
+    if (m_compact)
+    {
+        for (uint32_t id = 0; id < m_rows.m_state.size(); ++id)
+        {
+            uint8_t state = m_rows.m_state[id];
+            if (!(state & ROW_PRESENT))
+            {
+                continue;
+            }
+            view.dst = m_addressIndex.GetAddress(id);
+            view.nextHop = m_addressIndex.GetAddress(m_rows.m_nextHop[id]);
+            view.iface = m_rowIfaces[m_rows.m_iface[id]].first.GetLocal();
+            view.flag = static_cast<RouteFlags>(state & ROW_FLAG_MASK);
+            view.expire = MilliSeconds(m_rows.m_lifetime[id]) - Simulator::Now();
+            view.seqNo = m_rows.m_seqNo[id];
+            view.hops = m_rows.m_hops[id];
+            view.validSeqNo = state & ROW_VALID_SEQNO;
+            show();
+        }
+        return;
+    }
+    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+    {
+        const RoutingTableEntry& rt = i->second;
+        view.dst = rt.GetDestination();
+        view.nextHop = rt.GetNextHop();
+        view.iface = rt.GetInterface().GetLocal();
+        view.flag = rt.GetFlag();
+        view.expire = rt.GetLifeTime();
+        view.seqNo = rt.GetSeqNo();
+        view.hops = rt.GetHop();
+        view.validSeqNo = rt.GetValidSeqNo();
+        show();
     }
-    i->second.SetUnidirectional(true);
-    i->second.SetBlacklistTimeout(blacklistTimeout);
-    i->second.SetRreqCnt(0);
-    NS_LOG_LOGIC("Set link to " << neighbor << " to unidirectional");
-    return true;
 }
 
 void
 RoutingTable::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = Time::S */) const
 {
-    std::map<Ipv4Address, RoutingTableEntry> table = m_ipv4AddressEntry;
-    Purge(table);
+    m_printBuffer.clear();
+    ForEachRoute([this](const RouteView& view) { m_printBuffer.push_back(view); });
+    std::sort(m_printBuffer.begin(),
+              m_printBuffer.end(),
+              [](const RouteView& a, const RouteView& b) { return a.dst < b.dst; });
     std::ostream* os = stream->GetStream();
     // Copy the current ostream state
     std::ios oldState(nullptr);
@@ -482,47 +1104,152 @@ RoutingTable::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = Time::
     *os << std::setw(16) << "Interface";
     *os << std::setw(16) << "Flag";
     *os << std::setw(16) << "Expire";
-    *os << "Hops" << std::endl;
-    for (auto i = table.begin(); i != table.end(); ++i)
+    *os << "Hops\n";
+    for (const auto& view : m_printBuffer)
+    {
+        PrintRoute(*os, view.dst, view.nextHop, view.iface, view.flag, view.expire, view.hops, unit);
+    }
+    *os << "\n";
+    // Restore the previous ostream state
+    (*os).copyfmt(oldState);
+}
+
+uint32_t
+RoutingTable::WriteSnapshot(std::ostream& os, uint32_t node) const
+{
+    uint32_t records = 0;
+    ForEachRoute([&os, &records, node](const RouteView& view) {
+        RouteRecord record;
+        record.node = node;
+        record.dst = view.dst.Get();
+        record.nextHop = view.nextHop.Get();
+        record.iface = view.iface.Get();
+        record.seqNo = view.seqNo;
+        record.expire = static_cast<int32_t>(
+            std::clamp<int64_t>(view.expire.GetMilliSeconds(),
+                                std::numeric_limits<int32_t>::min(),
+                                std::numeric_limits<int32_t>::max()));
+        record.hops = view.hops;
+        record.state = view.flag | (view.validSeqNo ? 0x04 : 0);
+        uint8_t buffer[RouteRecord::SIZE];
+        record.Write(buffer);
+        os.write(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+        ++records;
+    });
+    return records;
+}
+
+/**
+ * Write an unsigned integer in little endian order
+ * @param p where to write
+ * @param value the value
+ * @param bytes the number of bytes to write
+ * @returns the end of the field
+ */
+static uint8_t*
+WriteField(uint8_t* p, uint32_t value, uint32_t bytes)
+{
+    for (uint32_t i = 0; i < bytes; ++i)
+    {
+        *p++ = (value >> (8 * i)) & 0xff;
+    }
+    return p;
+}
+
+/**
+ * Read an unsigned integer written by WriteField()
+ * @param p where to read, advanced past the field
+ * @param bytes the number of bytes to read
+ * @returns the value
+ */
+static uint32_t
+ReadField(const uint8_t*& p, uint32_t bytes)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bytes; ++i)
     {
-        i->second.Print(stream, unit);
+        value |= static_cast<uint32_t>(*p++) << (8 * i);
     }
-    *stream->GetStream() << "\n";
+    return value;
+}
+
+void
+RouteRecord::Write(uint8_t* buffer) const
+{
+    uint8_t* p = buffer;
+    p = WriteField(p, node, 4);
+    p = WriteField(p, dst, 4);
+    p = WriteField(p, nextHop, 4);
+    p = WriteField(p, iface, 4);
+    p = WriteField(p, seqNo, 4);
+    p = WriteField(p, static_cast<uint32_t>(expire), 4);
+    p = WriteField(p, hops, 2);
+    p = WriteField(p, state, 1);
+    WriteField(p, 0, 1);
+}
+
+void
+RouteRecord::Read(const uint8_t* buffer)
+{
+    const uint8_t* p = buffer;
+    node = ReadField(p, 4);
+    dst = ReadField(p, 4);
+    nextHop = ReadField(p, 4);
+    iface = ReadField(p, 4);
+    seqNo = ReadField(p, 4);
+    expire = static_cast<int32_t>(ReadField(p, 4));
+    hops = ReadField(p, 2);
+    state = ReadField(p, 1);
 }
+
 // ==================== PENAMBAHAN MULTIPATH ====================
 
 MultipathRouteEntry::MultipathRouteEntry()
-  : m_destination(Ipv4Address())
+  : m_destination(Ipv4Address()),
+    m_metrics(nullptr),
+    m_nextExpiry(Time::Max()),
+    m_seqNo(0),
+    m_advertisedHops(std::numeric_limits<uint32_t>::max())
 {
 }
 
 MultipathRouteEntry::MultipathRouteEntry(Ipv4Address destination)
-  : m_destination(destination)
+  : m_destination(destination),
+    m_metrics(nullptr),
+    m_nextExpiry(Time::Max()),
+    m_seqNo(0),
+    m_advertisedHops(std::numeric_limits<uint32_t>::max())
 {
 }
 
 void 
-MultipathRouteEntry::AddPath(Ipv4Address nextHop, uint32_t hopCount, Time lifetime)
+MultipathRouteEntry::AddPath(Ipv4Address nextHop, uint32_t hopCount, Time lifetime, uint32_t seqNo)
 {
-  NS_LOG_FUNCTION(this << nextHop << hopCount << lifetime.As(Time::S));
+  NS_LOG_FUNCTION(this << nextHop << hopCount << lifetime.As(Time::S) << seqNo);
   
   // First, remove any expired paths
-  auto now = Simulator::Now();
-  m_paths.erase(
-    std::remove_if(m_paths.begin(), m_paths.end(),
-      [now](const PathInfo& path) {
-        return path.expiryTime <= now;
-      }),
-    m_paths.end()
-  );
+  Expire();
+  Time expiryTime = Simulator::Now() + lifetime;
+  m_nextExpiry = std::min(m_nextExpiry, expiryTime);
   
   // Check if path already exists
-  for (auto& path : m_paths) {
+  for (size_t i = 0; i < m_paths.size(); ++i) {
+    PathInfo& path = m_paths[i];
     if (path.nextHop == nextHop) {
       // Update existing path
+      bool earliest = path.expiryTime == m_nextExpiry;
       path.hopCount = hopCount;
-      path.expiryTime = Simulator::Now() + lifetime;
+      path.expiryTime = expiryTime;
       path.isValid = true;
+      path.seqNo = seqNo;
+      Rescore(path);
+      Reposition(i);
+      if (earliest) {
+        m_nextExpiry = Time::Max();
+        for (const auto& other : m_paths) {
+          m_nextExpiry = std::min(m_nextExpiry, other.expiryTime);
+        }
+      }
       NS_LOG_LOGIC("Updated existing path to " << m_destination << " via " << nextHop);
       return;
     }
@@ -532,11 +1259,15 @@ MultipathRouteEntry::AddPath(Ipv4Address nextHop, uint32_t hopCount, Time lifeti
   PathInfo newPath;
   newPath.nextHop = nextHop;
   newPath.hopCount = hopCount;
-  newPath.expiryTime = Simulator::Now() + lifetime;
+  newPath.expiryTime = expiryTime;
   newPath.pathQuality = 1.0; // Default quality
   newPath.isValid = true;
+  newPath.seqNo = seqNo;
+  newPath.metricsRow = m_metrics ? m_metrics->Allocate() : PathScoreBatch::NONE;
+  Rescore(newPath);
   
   m_paths.push_back(newPath);
+  Reposition(m_paths.size() - 1);
   NS_LOG_LOGIC("Added new path to " << m_destination << " via " << nextHop 
                << " with hop count " << hopCount << " and lifetime " << lifetime.As(Time::S));
 }
@@ -547,6 +1278,11 @@ MultipathRouteEntry::RemovePath(Ipv4Address nextHop)
   NS_LOG_FUNCTION(this << nextHop);
   
   size_t initialSize = m_paths.size();
+  for (auto& path : m_paths) {
+    if (path.nextHop == nextHop) {
+      ReleaseRow(path);
+    }
+  }
   m_paths.erase(
     std::remove_if(m_paths.begin(), m_paths.end(),
       [nextHop](const PathInfo& path) { 
@@ -556,6 +1292,10 @@ MultipathRouteEntry::RemovePath(Ipv4Address nextHop)
   );
   
   if (m_paths.size() < initialSize) {
+    m_nextExpiry = Time::Max();
+    for (const auto& path : m_paths) {
+      m_nextExpiry = std::min(m_nextExpiry, path.expiryTime);
+    }
     NS_LOG_LOGIC("Removed path to " << m_destination << " via " << nextHop);
   }
 }
@@ -566,85 +1306,355 @@ MultipathRouteEntry::GetBestPath()
   NS_LOG_FUNCTION(this);
   
   // Remove expired paths first
-  auto now = Simulator::Now();
-  m_paths.erase(
-    std::remove_if(m_paths.begin(), m_paths.end(),
-      [now](const PathInfo& path) {
-        return path.expiryTime <= now;
-      }),
-    m_paths.end()
-  );
+  Expire();
   
   if (m_paths.empty()) {
     NS_LOG_LOGIC("No valid paths available for " << m_destination);
     return PathInfo(); // Return invalid path
   }
   
-  // ============ PENAMBAHAN BLE-MAODV: Use multi-metric selection ================= 
-  NS_LOG_LOGIC("Using BLE-MAODV multi-metric path selection for " << m_destination);
+  // ============ BLE-MAODV: paths are kept in composite score order =================
+  const PathInfo& bestPath = m_paths.front();
+  NS_LOG_LOGIC("Selected best path to " << m_destination << " via " << bestPath.nextHop 
+               << " with hop count " << bestPath.hopCount
+               << " and score " << bestPath.compositeScore);
+  return bestPath;
+}
+
+// ==================== END ==============
+
+std::vector<MultipathRouteEntry::PathInfo> 
+MultipathRouteEntry::GetAllPaths()
+{
+  NS_LOG_FUNCTION(this);
+  
+  // Remove expired paths first
+  Expire();
+  
+  NS_LOG_LOGIC("Returning " << m_paths.size() << " paths for " << m_destination);
+  return m_paths;
+}
+
+MultipathRouteEntry::PathSpan
+MultipathRouteEntry::GetPaths()
+{
+  Expire();
+  return PathSpan(m_paths.data(), m_paths.data() + m_paths.size());
+}
+
+bool 
+MultipathRouteEntry::HasValidPath()
+{
+  // Remove expired paths
+  Expire();
+  
+  bool hasValid = !m_paths.empty();
+  NS_LOG_LOGIC("Has valid path for " << m_destination << ": " << hasValid);
+  return hasValid;
+}
+
+void
+MultipathRouteEntry::SetWeights(const WeightFactors& weights)
+{
+  NS_LOG_FUNCTION(this);
+  m_weights = weights;
+  for (auto& path : m_paths) {
+    Rescore(path);
+  }
+  SortPaths();
+}
+
+void
+MultipathRouteEntry::SetMetricStore(PathScoreBatch* metrics)
+{
+  NS_ASSERT(m_paths.empty());
+  m_metrics = metrics;
+}
+
+void
+MultipathRouteEntry::ReleaseMetrics()
+{
+  for (auto& path : m_paths) {
+    ReleaseRow(path);
+  }
+  m_metrics = nullptr;
+}
+
+void
+MultipathRouteEntry::ApplyScores(const WeightFactors& weights)
+{
+  NS_LOG_FUNCTION(this);
+  m_weights = weights;
+  for (auto& path : m_paths) {
+    if (path.metricsRow == PathScoreBatch::NONE) {
+      path.compositeScore = path.CalculateCompositeScore(m_weights);
+    } else {
+      path.compositeScore = m_metrics->GetScore(path.metricsRow);
+    }
+  }
+  SortPaths();
+}
+
+bool
+MultipathRouteEntry::UpdatePathMetrics(Ipv4Address nextHop, const BLEMetrics& metrics)
+{
+  NS_LOG_FUNCTION(this << nextHop);
+  for (size_t i = 0; i < m_paths.size(); ++i) {
+    if (m_paths[i].nextHop == nextHop) {
+      m_paths[i].bleMetrics = metrics;
+      Rescore(m_paths[i]);
+      Reposition(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+MultipathRouteEntry::UpdatePathLinkMetrics(Ipv4Address nextHop, const BLEMetrics& metrics)
+{
+  NS_LOG_FUNCTION(this << nextHop);
+  for (size_t i = 0; i < m_paths.size(); ++i) {
+    if (m_paths[i].nextHop == nextHop) {
+      m_paths[i].bleMetrics.residualEnergy = metrics.residualEnergy;
+      m_paths[i].bleMetrics.rssiValue = metrics.rssiValue;
+      m_paths[i].bleMetrics.lastUpdated = metrics.lastUpdated;
+      Rescore(m_paths[i]);
+      Reposition(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+MultipathRouteEntry::UpdatePathStability(Ipv4Address nextHop,
+                                         bool successfulTransmission,
+                                         double weight)
+{
+  NS_LOG_FUNCTION(this << nextHop << successfulTransmission);
+  for (size_t i = 0; i < m_paths.size(); ++i) {
+    if (m_paths[i].nextHop == nextHop) {
+      m_paths[i].UpdateStabilityScore(successfulTransmission, weight);
+      Rescore(m_paths[i]);
+      Reposition(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+Ipv4Address
+MultipathRouteEntry::SelectNextHop(MultipathSelection mode,
+                                   uint32_t flowHash,
+                                   Ipv4Address exclude,
+                                   uint32_t seqNo,
+                                   uint32_t hops)
+{
+  Expire();
+  auto eligible = [exclude, seqNo, hops](const PathInfo& path) {
+    return path.nextHop != exclude && IsAlternate(path, seqNo, hops);
+  };
+  double total = 0;
+  for (const auto& path : m_paths) {
+    if (eligible(path)) {
+      total += path.compositeScore;
+    }
+  }
+  PathInfo* chosen = nullptr;
+  if (mode != WEIGHTED_ROUND_ROBIN) {
+    // Map the hash onto [0, total) and find the path whose share it falls in
+    double target = total * (flowHash / 4294967296.0);
+    for (auto& path : m_paths) {
+      if (!eligible(path)) {
+        continue;
+      }
+      chosen = &path;
+      target -= path.compositeScore;
+      if (target < 0) {
+        break;
+      }
+    }
+  } else {
+    // Smooth weighted round robin: every path earns its score, the richest
+    // path is picked and pays the total back
+    for (auto& path : m_paths) {
+      if (!eligible(path)) {
+        continue;
+      }
+      path.wrrCredit += path.compositeScore;
+      if (!chosen || path.wrrCredit > chosen->wrrCredit) {
+        chosen = &path;
+      }
+    }
+    if (chosen) {
+      chosen->wrrCredit -= total;
+    }
+  }
+  if (!chosen) {
+    return Ipv4Address();
+  }
+  ++chosen->usageCount;
+  chosen->lastUsed = Simulator::Now();
+  return chosen->nextHop;
+}
+
+bool
+MultipathRouteEntry::IsAlternate(const PathInfo& path, uint32_t seqNo, uint32_t hops)
+{
+  return path.seqNo == seqNo && path.hopCount <= hops;
+}
+
+bool
+MultipathRouteEntry::HasPath(Ipv4Address nextHop)
+{
+  Expire();
+  for (const auto& path : m_paths) {
+    if (path.nextHop == nextHop) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+MultipathRouteEntry::AddDisjointPath(Ipv4Address nextHop,
+                                     Ipv4Address firstHop,
+                                     uint32_t hopCount,
+                                     Time lifetime,
+                                     uint32_t seqNo)
+{
+  NS_LOG_FUNCTION(this << nextHop << firstHop << hopCount << seqNo);
+  Expire();
+  if (m_paths.empty() || int32_t(seqNo - m_seqNo) > 0) {
+    // Paths found with an older sequence number may now form loops
+    for (auto& path : m_paths) {
+      ReleaseRow(path);
+    }
+    m_paths.clear();
+    m_nextExpiry = Time::Max();
+    m_seqNo = seqNo;
+    m_advertisedHops = std::numeric_limits<uint32_t>::max();
+  } else if (seqNo != m_seqNo) {
+    NS_LOG_LOGIC("Stale path to " << m_destination << " via " << nextHop);
+    return false;
+  }
+  if (hopCount > m_advertisedHops) {
+    NS_LOG_LOGIC("Path to " << m_destination << " via " << nextHop << " longer than advertised");
+    return false;
+  }
+  for (const auto& path : m_paths) {
+    if (path.nextHop == nextHop || path.firstHop == firstHop) {
+      NS_LOG_LOGIC("Path to " << m_destination << " via " << nextHop << " and " << firstHop
+                   << " not disjoint from the one via " << path.nextHop);
+      return false;
+    }
+  }
+  PathInfo newPath;
+  newPath.nextHop = nextHop;
+  newPath.firstHop = firstHop;
+  newPath.hopCount = hopCount;
+  newPath.expiryTime = Simulator::Now() + lifetime;
+  newPath.pathQuality = 1.0;
+  newPath.isValid = true;
+  newPath.seqNo = seqNo;
+  AddPath(newPath);
+  return true;
+}
+
+uint32_t
+MultipathRouteEntry::Advertise()
+{
+  Expire();
+  if (m_advertisedHops == std::numeric_limits<uint32_t>::max() && !m_paths.empty()) {
+    m_advertisedHops = 0;
+    for (const auto& path : m_paths) {
+      m_advertisedHops = std::max(m_advertisedHops, path.hopCount);
+    }
+  }
+  return m_advertisedHops;
+}
+
+void
+MultipathRouteEntry::Expire()
+{
+  Time now = Simulator::Now();
+  if (m_nextExpiry > now) {
+    return;
+  }
+  m_nextExpiry = Time::Max();
+  size_t kept = 0;
+  for (size_t i = 0; i < m_paths.size(); ++i) {
+    if (m_paths[i].expiryTime > now) {
+      m_nextExpiry = std::min(m_nextExpiry, m_paths[i].expiryTime);
+      if (kept != i) {
+        m_paths[kept] = m_paths[i];
+      }
+      ++kept;
+    } else {
+      ReleaseRow(m_paths[i]);
+    }
+  }
+  m_paths.resize(kept);
+}
 
-  WeightFactors weights;
+void
+MultipathRouteEntry::Rescore(PathInfo& path)
+{
+  if (path.metricsRow == PathScoreBatch::NONE) {
+    path.compositeScore = path.CalculateCompositeScore(m_weights);
+    return;
+  }
+  m_metrics->Set(path.metricsRow,
+                 path.hopCount,
+                 path.bleMetrics.residualEnergy,
+                 path.bleMetrics.rssiValue,
+                 path.bleMetrics.stabilityScore);
+  path.compositeScore = m_metrics->ScoreRow(path.metricsRow, m_weights);
+}
 
-  // Calculate scores for all paths
-    for (auto& path : m_paths) {
-        path.compositeScore = path.CalculateCompositeScore(weights);
-        NS_LOG_DEBUG("Path via " << path.nextHop << 
-                     " - Hops: " << path.hopCount <<
-                     ", Energy: " << path.bleMetrics.residualEnergy <<
-                     ", RSSI: " << path.bleMetrics.rssiValue <<
-                     ", Stability: " << path.bleMetrics.stabilityScore <<
-                     ", Score: " << path.compositeScore);
-    }
-  // ==================== BLE-MAODV END ===================
-
-  // For now, we'll use hop count as primary metric
-  auto bestPath = std::min_element(m_paths.begin(), m_paths.end(),
-    [](const PathInfo& a, const PathInfo& b) {
-      return a.hopCount < b.hopCount;
-    });
-  
-  NS_LOG_LOGIC("Selected best path to " << m_destination << " via " << bestPath->nextHop 
-               << " with hop count " << bestPath->hopCount);
-  return *bestPath;
+void
+MultipathRouteEntry::ReleaseRow(PathInfo& path)
+{
+  if (path.metricsRow != PathScoreBatch::NONE) {
+    m_metrics->Release(path.metricsRow);
+    path.metricsRow = PathScoreBatch::NONE;
+  }
 }
 
-// ==================== END ==============
+void
+MultipathRouteEntry::Reposition(size_t i)
+{
+  // Ties keep their order, so of equally ranked paths the older one stays first
+  while (i > 0 && Ranks(m_paths[i], m_paths[i - 1])) {
+    std::swap(m_paths[i], m_paths[i - 1]);
+    --i;
+  }
+  while (i + 1 < m_paths.size() && Ranks(m_paths[i + 1], m_paths[i])) {
+    std::swap(m_paths[i], m_paths[i + 1]);
+    ++i;
+  }
+}
 
-std::vector<MultipathRouteEntry::PathInfo> 
-MultipathRouteEntry::GetAllPaths()
+void
+MultipathRouteEntry::SortPaths()
 {
-  NS_LOG_FUNCTION(this);
-  
-  // Remove expired paths first
-  auto now = Simulator::Now();
-  m_paths.erase(
-    std::remove_if(m_paths.begin(), m_paths.end(),
-      [now](const PathInfo& path) {
-        return path.expiryTime <= now;
-      }),
-    m_paths.end()
-  );
-  
-  NS_LOG_LOGIC("Returning " << m_paths.size() << " paths for " << m_destination);
-  return m_paths;
+  // Insertion sort: stable, no allocation, and a single pass over the few
+  // paths when a rescoring leaves them in order
+  for (size_t i = 1; i < m_paths.size(); ++i) {
+    for (size_t j = i; j > 0 && Ranks(m_paths[j], m_paths[j - 1]); --j) {
+      std::swap(m_paths[j], m_paths[j - 1]);
+    }
+  }
 }
 
-bool 
-MultipathRouteEntry::HasValidPath()
+bool
+MultipathRouteEntry::Ranks(const PathInfo& a, const PathInfo& b)
 {
-  // Remove expired paths
-  auto now = Simulator::Now();
-  m_paths.erase(
-    std::remove_if(m_paths.begin(), m_paths.end(),
-      [now](const PathInfo& path) {
-        return path.expiryTime <= now;
-      }),
-    m_paths.end()
-  );
-  
-  bool hasValid = !m_paths.empty();
-  NS_LOG_LOGIC("Has valid path for " << m_destination << ": " << hasValid);
-  return hasValid;
+  if (a.compositeScore != b.compositeScore) {
+    return a.compositeScore > b.compositeScore;
+  }
+  return a.hopCount < b.hopCount;
 }
 
 // ==================== PENAMBAHAN MULTIPATH ====================
@@ -672,7 +1682,11 @@ MultipathRouteEntry::PathInfo::PathInfo()
       isValid(false),
       compositeScore(0.0),
       lastUsed(Simulator::Now()),
-      usageCount(0) 
+      usageCount(0),
+      wrrCredit(0.0),
+      firstHop(Ipv4Address()),
+      seqNo(0),
+      metricsRow(PathScoreBatch::NONE)
 {      
 }
 
@@ -680,38 +1694,22 @@ MultipathRouteEntry::PathInfo::PathInfo()
 double 
 MultipathRouteEntry::PathInfo::CalculateCompositeScore(const WeightFactors& weights) const
 {
-    // Normalize hop count (lower is better)
-    double hopScore = 1.0 / (1.0 + hopCount);
-    
-    // Use residual energy directly (higher is better)
-    double energyScore = bleMetrics.residualEnergy;
-    
-    // Normalize RSSI (-100 dBm to -30 dBm range)
-    double rssiScore = (bleMetrics.rssiValue + 100.0) / 70.0;
-    rssiScore = std::max(0.0, std::min(1.0, rssiScore));
-    
-    // Use stability score directly
-    double stabilityScore = bleMetrics.stabilityScore;
-    
-    // Calculate weighted composite score
-    double score = (weights.hopWeight * hopScore) +
-                   (weights.energyWeight * energyScore) +
-                   (weights.rssiWeight * rssiScore) +
-                   (weights.stabilityWeight * stabilityScore);
-    
-    return score;
+    // One formula for the paths scored alone and for the batch kernels
+    return PathScoreBatch::ScoreOne(weights,
+                                    hopCount,
+                                    bleMetrics.residualEnergy,
+                                    bleMetrics.rssiValue,
+                                    bleMetrics.stabilityScore);
 }
 
 // UpdateStabilityScore implementation
 void 
-MultipathRouteEntry::PathInfo::UpdateStabilityScore(bool successfulTransmission)
+MultipathRouteEntry::PathInfo::UpdateStabilityScore(bool successfulTransmission, double weight)
 {
-    double stabilityFactor = 0.1; // Learning rate
     double reward = successfulTransmission ? 1.0 : 0.0;
     
     // Update stability score using exponential moving average
-    bleMetrics.stabilityScore = (1.0 - stabilityFactor) * bleMetrics.stabilityScore + 
-                               stabilityFactor * reward;
+    bleMetrics.stabilityScore = (1.0 - weight) * bleMetrics.stabilityScore + weight * reward;
     
     // Update usage statistics
     usageCount++;
@@ -801,23 +1799,32 @@ AdaptiveWeightCalculator::UpdateNetworkContext(NetworkContext& context,
 // ==================== MULTIPATH ROUTING TABLE METHODS ====================
 
 bool
-RoutingTable::AddMultipathRoute(Ipv4Address dst, Ipv4Address nextHop, uint32_t hopCount, Time lifetime)
+RoutingTable::AddMultipathRoute(Ipv4Address dst,
+                                Ipv4Address nextHop,
+                                uint32_t hopCount,
+                                Time lifetime,
+                                uint32_t seqNo)
 {
-    NS_LOG_FUNCTION(this << dst << nextHop << hopCount << lifetime);
+    NS_LOG_FUNCTION(this << dst << nextHop << hopCount << lifetime << seqNo);
     
     // Cari entri untuk destination
     auto it = m_multipathTable.find(dst);
     if (it == m_multipathTable.end()) {
         // Buat entri baru jika belum ada
-        MultipathRouteEntry newEntry(dst);
-        newEntry.AddPath(nextHop, hopCount, lifetime);
-        m_multipathTable[dst] = newEntry;
+        it = m_multipathTable.emplace(dst, MultipathRouteEntry(dst)).first;
+        it->second.SetWeights(m_multipathWeights);
+        it->second.SetMetricStore(&m_pathMetrics);
         NS_LOG_DEBUG("Created new multipath entry for " << dst << " with path via " << nextHop);
     } else {
-        // Tambahkan path ke entri yang sudah ada
-        it->second.AddPath(nextHop, hopCount, lifetime);
         NS_LOG_DEBUG("Added path to existing multipath entry for " << dst << " via " << nextHop);
     }
+    Time before = it->second.GetNextExpiry();
+    it->second.AddPath(nextHop, hopCount, lifetime, seqNo);
+    QueueMultipathExpiry(dst, before, it->second.GetNextExpiry());
+    // Adding a path may drop the older or expired ones
+    UnindexMultipathPaths(dst);
+    IndexMultipathPath(dst, nextHop);
+    NotifyMultipathRerank(dst);
     
     return true;
 }
@@ -853,6 +1860,17 @@ RoutingTable::GetAllMultipathRoutes(Ipv4Address dst)
     return std::vector<MultipathRouteEntry::PathInfo>();
 }
 
+MultipathRouteEntry::PathSpan
+RoutingTable::GetMultipathPaths(Ipv4Address dst)
+{
+    auto it = m_multipathTable.find(dst);
+    if (it == m_multipathTable.end())
+    {
+        return MultipathRouteEntry::PathSpan();
+    }
+    return it->second.GetPaths();
+}
+
 bool
 RoutingTable::HasMultipathRoute(Ipv4Address dst)
 {
@@ -878,9 +1896,11 @@ RoutingTable::RemoveMultipathRoute(Ipv4Address dst, Ipv4Address nextHop)
         
         // Jika tidak ada path lagi, hapus entri
         if (!it->second.HasValidPath()) {
+            it->second.ReleaseMetrics();
             m_multipathTable.erase(it);
             NS_LOG_DEBUG("Removed empty multipath entry for " << dst);
         }
+        UnindexMultipathPaths(dst);
         return true;
     }
     
@@ -891,18 +1911,407 @@ RoutingTable::RemoveMultipathRoute(Ipv4Address dst, Ipv4Address nextHop)
 void
 RoutingTable::PurgeMultipathRoutes()
 {
-    NS_LOG_FUNCTION(this);
-    
-    for (auto it = m_multipathTable.begin(); it != m_multipathTable.end(); ) {
-        // Hapus path yang sudah kadaluarsa
-        it->second.GetBestPath(); // Ini akan menghapus path yang kadaluarsa di dalam GetBestPath
-        if (!it->second.HasValidPath()) {
+    Time now = Simulator::Now();
+    while (!m_multipathExpiryQueue.empty() && m_multipathExpiryQueue.top().first <= now)
+    {
+        ExpiryEvent event = m_multipathExpiryQueue.top();
+        m_multipathExpiryQueue.pop();
+        // Collapse the copies of the event, which pop together
+        while (!m_multipathExpiryQueue.empty() && m_multipathExpiryQueue.top() == event)
+        {
+            m_multipathExpiryQueue.pop();
+        }
+        auto it = m_multipathTable.find(event.second);
+        if (it == m_multipathTable.end())
+        {
+            continue;
+        }
+        // HasValidPath menghapus path yang sudah kadaluarsa
+        if (!it->second.HasValidPath())
+        {
             NS_LOG_DEBUG("Purging multipath entry for " << it->first);
-            it = m_multipathTable.erase(it);
-        } else {
-            ++it;
+            it->second.ReleaseMetrics();
+            m_multipathTable.erase(it);
+        }
+        else
+        {
+            // The paths may have been refreshed since the event was queued
+            m_multipathExpiryQueue.emplace(it->second.GetNextExpiry(), event.second);
+        }
+        UnindexMultipathPaths(event.second);
+    }
+}
+
+void
+RoutingTable::QueueMultipathExpiry(Ipv4Address dst, Time before, Time after)
+{
+    if (after < before)
+    {
+        m_multipathExpiryQueue.emplace(after, dst);
+    }
+}
+
+void
+RoutingTable::SetMultipathWeights(const WeightFactors& weights)
+{
+    NS_LOG_FUNCTION(this);
+    if (weights == m_multipathWeights)
+    {
+        return;
+    }
+    m_multipathWeights = weights;
+    // Rescore the paths of all destinations in one pass over the metrics
+    m_pathMetrics.Score(weights);
+    for (auto& entry : m_multipathTable)
+    {
+        entry.second.ApplyScores(weights);
+    }
+    for (const auto& entry : m_multipathTable)
+    {
+        NotifyMultipathRerank(entry.first);
+    }
+}
+
+bool
+RoutingTable::SelectMultipathNextHop(Ipv4Address dst,
+                                     MultipathSelection mode,
+                                     uint32_t flowHash,
+                                     Ipv4Address exclude,
+                                     Ipv4Address& nextHop)
+{
+    NS_LOG_FUNCTION(this << dst << mode << flowHash << exclude);
+    auto it = m_multipathTable.find(dst);
+    const RoutingTableEntry* route = Find(dst);
+    if (it == m_multipathTable.end() || !route)
+    {
+        return false;
+    }
+    nextHop = it->second.SelectNextHop(mode, flowHash, exclude, route->GetSeqNo(), route->GetHop());
+    return nextHop != Ipv4Address();
+}
+
+bool
+RoutingTable::HasMultipathPath(Ipv4Address dst, Ipv4Address nextHop)
+{
+    auto it = m_multipathTable.find(dst);
+    return it != m_multipathTable.end() && it->second.HasPath(nextHop);
+}
+
+bool
+RoutingTable::HasAlternateMultipathPath(Ipv4Address dst, Ipv4Address nextHop)
+{
+    auto it = m_multipathTable.find(dst);
+    const RoutingTableEntry* route = Find(dst);
+    if (it == m_multipathTable.end() || !route)
+    {
+        return false;
+    }
+    for (const auto& path : it->second.GetPaths())
+    {
+        if (path.nextHop == nextHop)
+        {
+            return MultipathRouteEntry::IsAlternate(path, route->GetSeqNo(), route->GetHop());
+        }
+    }
+    return false;
+}
+
+bool
+RoutingTable::AddDisjointMultipathRoute(Ipv4Address dst,
+                                        Ipv4Address nextHop,
+                                        Ipv4Address firstHop,
+                                        uint32_t hopCount,
+                                        Time lifetime,
+                                        uint32_t seqNo)
+{
+    NS_LOG_FUNCTION(this << dst << nextHop << firstHop << hopCount << seqNo);
+    auto it = m_multipathTable.find(dst);
+    if (it == m_multipathTable.end())
+    {
+        it = m_multipathTable.emplace(dst, MultipathRouteEntry(dst)).first;
+        it->second.SetWeights(m_multipathWeights);
+        it->second.SetMetricStore(&m_pathMetrics);
+    }
+    Time before = it->second.GetNextExpiry();
+    if (!it->second.AddDisjointPath(nextHop, firstHop, hopCount, lifetime, seqNo))
+    {
+        return false;
+    }
+    QueueMultipathExpiry(dst, before, it->second.GetNextExpiry());
+    UnindexMultipathPaths(dst);
+    IndexMultipathPath(dst, nextHop);
+    NotifyMultipathRerank(dst);
+    return true;
+}
+
+void
+RoutingTable::AdvertiseMultipathRoute(Ipv4Address dst)
+{
+    auto it = m_multipathTable.find(dst);
+    if (it != m_multipathTable.end())
+    {
+        it->second.Advertise();
+    }
+}
+
+bool
+RoutingTable::PromoteMultipathRoute(Ipv4Address dst, Ipv4Address brokenNextHop)
+{
+    NS_LOG_FUNCTION(this << dst << brokenNextHop);
+    auto it = m_multipathTable.find(dst);
+    if (it == m_multipathTable.end())
+    {
+        return false;
+    }
+    it->second.RemovePath(brokenNextHop);
+    const RoutingTableEntry* route = Find(dst);
+    if (route)
+    {
+        // Only a path as fresh and as short as the route may take its place,
+        // the others could lead back through this node
+        uint32_t seqNo = route->GetSeqNo();
+        uint32_t hops = route->GetHop();
+        for (const auto& path : it->second.GetAllPaths())
+        {
+            if (!MultipathRouteEntry::IsAlternate(path, seqNo, hops))
+            {
+                NS_LOG_LOGIC("Dropping path to " << dst << " via " << path.nextHop);
+                it->second.RemovePath(path.nextHop);
+            }
+        }
+    }
+    // Best path first: promote the first one still reachable. FindRoute()
+    // purges the multipath table, so the paths are copied rather than viewed.
+    std::vector<MultipathRouteEntry::PathInfo> paths = it->second.GetAllPaths();
+    if (paths.empty())
+    {
+        it->second.ReleaseMetrics();
+        m_multipathTable.erase(it);
+    }
+    UnindexMultipathPaths(dst);
+    if (paths.empty() || !route)
+    {
+        return false;
+    }
+    for (const auto& path : paths)
+    {
+        const RoutingTableEntry* neighbor = FindRoute(path.nextHop);
+        if (neighbor && neighbor->GetFlag() == VALID && neighbor->GetNextHop() == path.nextHop)
+        {
+            return MoveRouteToPath(dst, brokenNextHop, path);
+        }
+    }
+    return false;
+}
+
+bool
+RoutingTable::SwitchMultipathRoute(Ipv4Address dst, Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << dst << nextHop);
+    const RoutingTableEntry* route = FindRoute(dst);
+    if (!route || route->GetFlag() != VALID || route->GetNextHop() == nextHop)
+    {
+        return false;
+    }
+    Ipv4Address from = route->GetNextHop();
+    const RoutingTableEntry* neighbor = FindRoute(nextHop);
+    auto it = m_multipathTable.find(dst);
+    if (!neighbor || neighbor->GetFlag() != VALID || neighbor->GetNextHop() != nextHop ||
+        it == m_multipathTable.end())
+    {
+        return false;
+    }
+    for (const auto& path : it->second.GetPaths())
+    {
+        if (path.nextHop == nextHop)
+        {
+            // A copy, as MoveRouteToPath() looks routes up, which purges
+            MultipathRouteEntry::PathInfo chosen = path;
+            return MoveRouteToPath(dst, from, chosen);
+        }
+    }
+    return false;
+}
+
+bool
+RoutingTable::MoveRouteToPath(Ipv4Address dst,
+                              Ipv4Address from,
+                              const MultipathRouteEntry::PathInfo& path)
+{
+    const RoutingTableEntry* neighbor = FindRoute(path.nextHop);
+    NS_ASSERT(neighbor);
+    Ptr<NetDevice> dev = neighbor->GetOutputDevice();
+    Ipv4InterfaceAddress iface = neighbor->GetInterface();
+    Time lifetime = path.expiryTime - Simulator::Now();
+    bool stale = false;
+    bool moved = ModifyRoute(dst, [&](RoutingTableEntry& rt) {
+        if (rt.GetFlag() != VALID || rt.GetNextHop() != from)
+        {
+            return false;
+        }
+        if (!MultipathRouteEntry::IsAlternate(path, rt.GetSeqNo(), rt.GetHop()))
+        {
+            stale = true;
+            return false;
+        }
+        NS_LOG_LOGIC("Route to " << dst << " moves from " << from << " to " << path.nextHop);
+        rt.SetNextHop(path.nextHop);
+        rt.SetOutputDevice(dev);
+        rt.SetInterface(iface);
+        rt.SetHop(static_cast<uint16_t>(path.hopCount));
+        rt.SetLifeTime(std::max(rt.GetLifeTime(), lifetime));
+        return true;
+    });
+    if (stale)
+    {
+        NS_LOG_LOGIC("Dropping path to " << dst << " via " << path.nextHop);
+        RemoveMultipathRoute(dst, path.nextHop);
+    }
+    return moved;
+}
+
+void
+RoutingTable::IndexMultipathPath(Ipv4Address dst, Ipv4Address nextHop)
+{
+    // The next hops of a destination are few, unlike the destinations of a
+    // next hop, so duplicates are looked for among the former
+    std::vector<Ipv4Address>& filed =
+        m_multipathIndexedNextHops.insert(std::make_pair(dst, std::vector<Ipv4Address>()))
+            .first->second;
+    if (std::find(filed.begin(), filed.end(), nextHop) != filed.end())
+    {
+        return;
+    }
+    filed.push_back(nextHop);
+    m_multipathNextHopIndex.insert(std::make_pair(nextHop, std::vector<Ipv4Address>()))
+        .first->second.push_back(dst);
+}
+
+void
+RoutingTable::UnindexMultipathPaths(Ipv4Address dst)
+{
+    auto i = m_multipathIndexedNextHops.find(dst);
+    if (i == m_multipathIndexedNextHops.end())
+    {
+        return;
+    }
+    auto it = m_multipathTable.find(dst);
+    std::vector<Ipv4Address>& filed = i->second;
+    for (size_t k = 0; k < filed.size();)
+    {
+        if (it != m_multipathTable.end() && it->second.HasPath(filed[k]))
+        {
+            ++k;
+            continue;
+        }
+        auto j = m_multipathNextHopIndex.find(filed[k]);
+        NS_ASSERT(j != m_multipathNextHopIndex.end());
+        std::vector<Ipv4Address>& dsts = j->second;
+        *std::find(dsts.begin(), dsts.end(), dst) = dsts.back();
+        dsts.pop_back();
+        if (dsts.empty())
+        {
+            m_multipathNextHopIndex.erase(j);
+        }
+        filed[k] = filed.back();
+        filed.pop_back();
+    }
+    if (filed.empty())
+    {
+        m_multipathIndexedNextHops.erase(i);
+    }
+}
+
+void
+RoutingTable::NotifyMultipathRerank(Ipv4Address dst)
+{
+    if (!m_multipathRerank.IsNull())
+    {
+        m_multipathRerank(dst);
+    }
+}
+
+void
+RoutingTable::UpdateMultipathLinkMetrics(Ipv4Address neighbor, const BLEMetrics& metrics)
+{
+    NS_LOG_FUNCTION(this << neighbor);
+    auto j = m_multipathNextHopIndex.find(neighbor);
+    if (j == m_multipathNextHopIndex.end())
+    {
+        return;
+    }
+    std::vector<Ipv4Address> reranked;
+    std::vector<Ipv4Address> gone;
+    for (Ipv4Address dst : j->second)
+    {
+        auto it = m_multipathTable.find(dst);
+        if (it != m_multipathTable.end() && it->second.UpdatePathLinkMetrics(neighbor, metrics))
+        {
+            reranked.push_back(dst);
+        }
+        else
+        {
+            gone.push_back(dst);
+        }
+    }
+    // The path through neighbor expired since it was last indexed
+    for (Ipv4Address dst : gone)
+    {
+        UnindexMultipathPaths(dst);
+    }
+    for (Ipv4Address dst : reranked)
+    {
+        NotifyMultipathRerank(dst);
+    }
+}
+
+bool
+RoutingTable::UpdateMultipathStability(Ipv4Address dst,
+                                       Ipv4Address nextHop,
+                                       bool successfulTransmission)
+{
+    auto it = m_multipathTable.find(dst);
+    if (it == m_multipathTable.end())
+    {
+        return false;
+    }
+    const RoutingTableEntry* route = Find(dst);
+    Ipv4Address current =
+        route && route->GetFlag() == VALID ? route->GetNextHop() : Ipv4Address();
+    std::pair<Ipv4Address, bool> before = GetMultipathLeader(it->second, current);
+    if (!it->second.UpdatePathStability(nextHop,
+                                        successfulTransmission,
+                                        m_multipathStabilityWeight))
+    {
+        return false;
+    }
+    if (GetMultipathLeader(it->second, current) != before)
+    {
+        NotifyMultipathRerank(dst);
+    }
+    return true;
+}
+
+std::pair<Ipv4Address, bool>
+RoutingTable::GetMultipathLeader(MultipathRouteEntry& entry, Ipv4Address current) const
+{
+    MultipathRouteEntry::PathSpan paths = entry.GetPaths();
+    if (paths.empty())
+    {
+        return std::make_pair(Ipv4Address(), false);
+    }
+    const MultipathRouteEntry::PathInfo& best = paths.front();
+    for (const auto& path : paths)
+    {
+        if (path.nextHop == current)
+        {
+            return std::make_pair(best.nextHop,
+                                  best.nextHop != current &&
+                                      best.compositeScore >=
+                                          path.compositeScore + m_multipathSwitchMargin);
         }
     }
+    return std::make_pair(best.nextHop, false);
 }
 
 // ==================== MULTIPATH ROUTE ENTRY METHODS ====================
@@ -914,7 +2323,12 @@ void
 MultipathRouteEntry::AddPath(const MultipathRouteEntry::PathInfo& pathInfo)
 {
     NS_LOG_FUNCTION(this << pathInfo.nextHop);
+    Expire();
     m_paths.push_back(pathInfo);
+    m_paths.back().metricsRow = m_metrics ? m_metrics->Allocate() : PathScoreBatch::NONE;
+    Rescore(m_paths.back());
+    Reposition(m_paths.size() - 1);
+    m_nextExpiry = std::min(m_nextExpiry, pathInfo.expiryTime);
     NS_LOG_DEBUG("Added path to " << m_destination << " via " << pathInfo.nextHop << " with BLE metrics");
 }
 
@@ -18,6 +18,12 @@
 
 
 
+#include "aodv-address-index.h"
+#include "aodv-address-map.h"
+#include "aodv-path-scorer.h"
+#include "aodv-route-journal.h"
+
+#include "ns3/callback.h"
 #include "ns3/nstime.h"
 #include "ns3/simulator.h"
 #include "ns3/ipv4-address.h"
@@ -32,7 +38,9 @@
 
 #include <vector>
 #include <map>
+#include <queue>
 #include <cassert>
+#include <functional>
 #include <stdint.h>
 #include <sys/types.h>
 
@@ -79,6 +87,15 @@ struct WeightFactors {
     {
     }
     
+    /**
+     * @param other other weights
+     * @returns true if all weights are equal
+     */
+    bool operator==(const WeightFactors& other) const {
+        return hopWeight == other.hopWeight && energyWeight == other.energyWeight &&
+               rssiWeight == other.rssiWeight && stabilityWeight == other.stabilityWeight;
+    }
+
     void Normalize() {
         double total = hopWeight + energyWeight + rssiWeight + stabilityWeight;
         if (total > 0) {
@@ -163,7 +180,7 @@ class RoutingTableEntry
      * @param nextHop the IP address of the next hop
      * @param lifetime the lifetime of the entry
      */
-    RoutingTableEntry(Ptr<NetDevice> dev = nullptr,
+    RoutingTableEntry(Ptr<NetDevice> dev,
                       Ipv4Address dst = Ipv4Address(),
                       bool vSeqNo = false,
                       uint32_t seqNo = 0,
@@ -171,6 +188,11 @@ class RoutingTableEntry
                       uint16_t hops = 0,
                       Ipv4Address nextHop = Ipv4Address(),
                       Time lifetime = Simulator::Now());
+    /**
+     * Construct an empty entry, such as a scratch variable filled in by
+     * RoutingTable::LookupRoute().
+     */
+    RoutingTableEntry();
 
     ~RoutingTableEntry();
 
@@ -206,6 +228,21 @@ class RoutingTableEntry
      * @param prec vector of precursor addresses
      */
     void GetPrecursors(std::vector<Ipv4Address>& prec) const;
+
+    /**
+     * Get the precursors, in address order and without duplicates
+     * @returns the precursors
+     */
+    const std::vector<Ipv4Address>& GetPrecursorSet() const
+    {
+        return m_precursors;
+    }
+    /**
+     * Merge the precursors into a vector in address order, so that the
+     * precursors of several entries can be gathered without duplicates
+     * @param precursors a vector in address order and without duplicates
+     */
+    void MergePrecursors(std::vector<Ipv4Address>& precursors) const;
     //\}
 
     /**
@@ -221,7 +258,7 @@ class RoutingTableEntry
      */
     Ipv4Address GetDestination() const
     {
-        return m_ipv4Route->GetDestination();
+        return m_ipv4Route ? m_ipv4Route->GetDestination() : Ipv4Address();
     }
 
     /**
@@ -230,7 +267,7 @@ class RoutingTableEntry
      */
     Ptr<Ipv4Route> GetRoute() const
     {
-        return m_ipv4Route;
+        return Route();
     }
 
     /**
@@ -248,7 +285,7 @@ class RoutingTableEntry
      */
     void SetNextHop(Ipv4Address nextHop)
     {
-        m_ipv4Route->SetGateway(nextHop);
+        Route()->SetGateway(nextHop);
     }
 
     /**
@@ -257,7 +294,7 @@ class RoutingTableEntry
      */
     Ipv4Address GetNextHop() const
     {
-        return m_ipv4Route->GetGateway();
+        return m_ipv4Route ? m_ipv4Route->GetGateway() : Ipv4Address();
     }
 
     /**
@@ -266,7 +303,7 @@ class RoutingTableEntry
      */
     void SetOutputDevice(Ptr<NetDevice> dev)
     {
-        m_ipv4Route->SetOutputDevice(dev);
+        Route()->SetOutputDevice(dev);
     }
 
     /**
@@ -275,7 +312,7 @@ class RoutingTableEntry
      */
     Ptr<NetDevice> GetOutputDevice() const
     {
-        return m_ipv4Route->GetOutputDevice();
+        return m_ipv4Route ? m_ipv4Route->GetOutputDevice() : nullptr;
     }
 
     /**
@@ -357,15 +394,43 @@ class RoutingTableEntry
     void SetLifeTime(Time lt)
     {
         m_lifeTime = lt + Simulator::Now();
+        m_touched = Time::Min();
     }
 
     /**
-     * Get the lifetime
+     * Get the lifetime, including the extensions recorded by Touch()
      * @returns the lifetime
      */
     Time GetLifeTime() const
     {
-        return m_lifeTime - Simulator::Now();
+        return std::max(m_lifeTime, m_touched) - Simulator::Now();
+    }
+
+    /**
+     * Record a use of the route: the lifetime becomes no less than lt from now.
+     * Equivalent to SetLifeTime(std::max(lt, GetLifeTime())), but only the new
+     * deadline is stored; it is merged into the lifetime by GetLifeTime() and
+     * FoldTouch().
+     * @param lt The minimum lifetime
+     */
+    void Touch(Time lt)
+    {
+        m_touched = std::max(m_touched, lt + Simulator::Now());
+    }
+
+    /**
+     * Merge the deadline recorded by Touch() into the stored lifetime
+     * @returns true if the touch extended the lifetime
+     */
+    bool FoldTouch()
+    {
+        bool extended = m_touched > m_lifeTime;
+        if (extended)
+        {
+            m_lifeTime = m_touched;
+        }
+        m_touched = Time::Min();
+        return extended;
     }
 
     /**
@@ -412,45 +477,6 @@ class RoutingTableEntry
         m_reqCount++;
     }
 
-    /**
-     * Set the unidirectional flag
-     * @param u the uni directional flag
-     */
-    void SetUnidirectional(bool u)
-    {
-        m_blackListState = u;
-    }
-
-    /**
-     * Get the unidirectional flag
-     * @returns the unidirectional flag
-     */
-    bool IsUnidirectional() const
-    {
-        return m_blackListState;
-    }
-
-    /**
-     * Set the blacklist timeout
-     * @param t the blacklist timeout value
-     */
-    void SetBlacklistTimeout(Time t)
-    {
-        m_blackListTimeout = t;
-    }
-
-    /**
-     * Get the blacklist timeout value
-     * @returns the blacklist timeout value
-     */
-    Time GetBlacklistTimeout() const
-    {
-        return m_blackListTimeout;
-    }
-
-    /// RREP_ACK timer
-    Timer m_ackTimer;
-
     /**
      * @brief Compare destination address
      * @param dst IP address to compare
@@ -458,7 +484,7 @@ class RoutingTableEntry
      */
     bool operator==(const Ipv4Address dst) const
     {
-        return (m_ipv4Route->GetDestination() == dst);
+        return (GetDestination() == dst);
     }
 
     /**
@@ -469,6 +495,15 @@ class RoutingTableEntry
     void Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
 
   private:
+    friend class RoutingTable;
+
+    /**
+     * Get the route, allocating it with the default field values of the full
+     * constructor if this entry was default constructed and has none yet
+     * @returns the IPv4 route
+     */
+    Ptr<Ipv4Route> Route() const;
+
     /// Valid Destination Sequence Number flag
     bool m_validSeqNo;
     /// Destination Sequence Number, if m_validSeqNo = true
@@ -482,30 +517,42 @@ class RoutingTableEntry
      * it is the deletion time.
      */
     Time m_lifeTime;
+    /// Lifetime deadline recorded by Touch() and not yet merged into m_lifeTime
+    Time m_touched;
     /** Ip route, include
      *   - destination address
      *   - source address
      *   - next hop address (gateway)
      *   - output device
+     *
+     * Null in a default constructed entry until Route() allocates it.
      */
-    Ptr<Ipv4Route> m_ipv4Route;
+    mutable Ptr<Ipv4Route> m_ipv4Route;
     /// Output interface address
     Ipv4InterfaceAddress m_iface;
     /// Routing flags: valid, invalid or in search
     RouteFlags m_flag;
 
-    /// List of precursors
-    std::vector<Ipv4Address> m_precursorList;
+    /// Precursors, in address order. Usually a handful of neighbors.
+    std::vector<Ipv4Address> m_precursors;
     /// When I can send another request
     Time m_routeRequestTimeout;
     /// Number of route requests
     uint8_t m_reqCount;
-    /// Indicate if this entry is in "blacklist"
-    bool m_blackListState;
-    /// Time for which the node is put into the blacklist
-    Time m_blackListTimeout;
 };
 // ================== PENAMBAHAN MULTIPATH ==========================
+/**
+ * @ingroup aodv
+ * @brief How data packets are spread over the paths of a multipath entry
+ */
+enum MultipathSelection
+{
+    SINGLE_PATH,          //!< Use the next hop of the routing table entry only
+    WEIGHTED_ROUND_ROBIN, //!< Rotate over the paths per packet, in proportion to their scores
+    FLOW_HASH,            //!< Pin each flow to a path, chosen in proportion to the path scores
+    FLOW_PINNED,          //!< As FLOW_HASH, but a flow keeps its path until the path goes away
+};
+
 /**
  * @ingroup aodv  
  * @brief Multipath Routing table entry for BLE-MAODV
@@ -528,28 +575,328 @@ public:
     double compositeScore;
     Time lastUsed;
     uint32_t usageCount;
+    /// Credit of the smooth weighted round robin of SelectNextHop()
+    double wrrCredit;
+    /// Node next to the far end of the path, for paths found by AddDisjointPath()
+    Ipv4Address firstHop;
+    /// Destination sequence number the path was found with
+    uint32_t seqNo;
+    /// Row of the metrics of the path in the batch of its entry, if it has one
+    uint32_t metricsRow;
     
     PathInfo();
     double CalculateCompositeScore(const WeightFactors& weights) const;
-    void UpdateStabilityScore(bool successfulTransmission);
+    /**
+     * Fold the outcome of a transmission into the stability, an exponentially
+     * weighted moving average of the delivery ratio of the path
+     * @param successfulTransmission whether the transmission succeeded
+     * @param weight the weight of the outcome, 0 to 1
+     */
+    void UpdateStabilityScore(bool successfulTransmission, double weight);
+  };
+
+  /**
+   * Read-only view of the stored paths, best first. It stays valid until
+   * the entry is next changed or one of its non-const methods is called.
+   */
+  class PathSpan
+  {
+  public:
+    PathSpan()
+      : m_begin(nullptr),
+        m_end(nullptr)
+    {
+    }
+    /**
+     * @param begin the first path
+     * @param end past the last path
+     */
+    PathSpan(const PathInfo* begin, const PathInfo* end)
+      : m_begin(begin),
+        m_end(end)
+    {
+    }
+    /// @returns the first path
+    const PathInfo* begin() const
+    {
+      return m_begin;
+    }
+    /// @returns past the last path
+    const PathInfo* end() const
+    {
+      return m_end;
+    }
+    /// @returns the number of paths
+    size_t size() const
+    {
+      return m_end - m_begin;
+    }
+    /// @returns true if there is no path
+    bool empty() const
+    {
+      return m_begin == m_end;
+    }
+    /// @returns the best path; the span must not be empty
+    const PathInfo& front() const
+    {
+      return *m_begin;
+    }
+    /**
+     * @param i a position, less than size()
+     * @returns the path at position i
+     */
+    const PathInfo& operator[](size_t i) const
+    {
+      return m_begin[i];
+    }
+
+  private:
+    const PathInfo* m_begin; //!< The first path
+    const PathInfo* m_end;   //!< Past the last path
   };
   
   // Method declarations - PERBAIKAN: Gunakan MultipathRouteEntry::PathInfo
-  void AddPath(Ipv4Address nextHop, uint32_t hopCount, Time lifetime);
+  void AddPath(Ipv4Address nextHop, uint32_t hopCount, Time lifetime, uint32_t seqNo);
   void AddPath(const MultipathRouteEntry::PathInfo& pathInfo);  // PERBAIKAN DI SINI
   void RemovePath(Ipv4Address nextHop);
+  /// @returns the unexpired path with the highest composite score, or an invalid PathInfo
   PathInfo GetBestPath();
+  /// @returns a copy of the unexpired paths, highest composite score first
   std::vector<PathInfo> GetAllPaths();
+  /// @returns a view of the unexpired paths, highest composite score first
+  PathSpan GetPaths();
+  /**
+   * Call a function on each unexpired path, highest composite score first
+   * @param fn the function, called with a const PathInfo&
+   */
+  template <typename F>
+  void ForEachPath(F fn)
+  {
+    for (const PathInfo& path : GetPaths()) {
+      fn(path);
+    }
+  }
   bool HasValidPath();
-  
+  /// @returns the earliest expiry time of the stored paths, Time::Max() if there are none
+  Time GetNextExpiry() const
+  {
+    return m_nextExpiry;
+  }
+
+  /**
+   * Set the weights of the composite score and rescore all paths
+   * @param weights the weights
+   */
+  void SetWeights(const WeightFactors& weights);
+  /// @returns the weights of the composite score
+  const WeightFactors& GetWeights() const
+  {
+    return m_weights;
+  }
+  /**
+   * Keep the metrics of the paths in rows of a batch shared by the entries
+   * of a node, so that all of them are rescored in one pass (see
+   * ApplyScores()). Must be called while the entry has no path. The entry
+   * must then not be copied, since the copy would share its rows.
+   * @param metrics the batch
+   */
+  void SetMetricStore(PathScoreBatch* metrics);
+  /// Release the rows of the paths in the batch, before the entry goes away
+  void ReleaseMetrics();
+  /**
+   * Set the weights of the composite score and take the scores of the paths
+   * from the batch, which the caller has just scored with them
+   * (PathScoreBatch::Score())
+   * @param weights the weights
+   */
+  void ApplyScores(const WeightFactors& weights);
+  /**
+   * Replace the BLE metrics of a path and rescore it
+   * @param nextHop the next hop of the path
+   * @param metrics the new metrics
+   * @returns false if there is no path through nextHop
+   */
+  bool UpdatePathMetrics(Ipv4Address nextHop, const BLEMetrics& metrics);
+  /**
+   * Replace the link metrics of a path, the residual energy and RSSI of its
+   * next hop, and rescore it; its stability is kept
+   * @param nextHop the next hop of the path
+   * @param metrics the new metrics
+   * @returns false if there is no path through nextHop
+   */
+  bool UpdatePathLinkMetrics(Ipv4Address nextHop, const BLEMetrics& metrics);
+  /**
+   * Record the outcome of a transmission on a path (see
+   * PathInfo::UpdateStabilityScore()) and rescore it
+   * @param nextHop the next hop of the path
+   * @param successfulTransmission whether the transmission succeeded
+   * @param weight the weight of the outcome in the stability
+   * @returns false if there is no path through nextHop
+   */
+  bool UpdatePathStability(Ipv4Address nextHop, bool successfulTransmission, double weight);
+  /**
+   * Pick the next hop of a data packet among the unexpired paths that are as
+   * fresh and as short as the route in use (see IsAlternate()), each path
+   * getting a share of the packets proportional to its composite score.
+   * WEIGHTED_ROUND_ROBIN interleaves the paths packet by packet (smooth
+   * weighted round robin); FLOW_HASH maps flowHash onto the cumulated scores,
+   * so all packets of a flow take the same path while the paths and their
+   * scores stay the same.
+   * FLOW_PINNED picks as FLOW_HASH does.
+   * @param mode WEIGHTED_ROUND_ROBIN, FLOW_HASH or FLOW_PINNED
+   * @param flowHash hash of the flow of the packet, for FLOW_HASH and FLOW_PINNED
+   * @param exclude a next hop not to pick, e.g. the previous hop of the packet
+   * @param seqNo the destination sequence number of the route in use
+   * @param hops the hop count of the route in use
+   * @returns the next hop, or Ipv4Address() if there is no path to pick
+   */
+  Ipv4Address SelectNextHop(MultipathSelection mode,
+                            uint32_t flowHash,
+                            Ipv4Address exclude,
+                            uint32_t seqNo,
+                            uint32_t hops);
+  /**
+   * A path may carry the packets of a route only if it was found with the
+   * same destination sequence number and is no longer. An older path may
+   * lead back through this node, and a longer one may lead through a node
+   * that routes to the destination through this one.
+   * @param path a path
+   * @param seqNo the destination sequence number of the route
+   * @param hops the hop count of the route
+   * @returns true if path may carry the packets of the route
+   */
+  static bool IsAlternate(const PathInfo& path, uint32_t seqNo, uint32_t hops);
+  /**
+   * @param nextHop a next hop
+   * @returns true if there is an unexpired path through nextHop
+   */
+  bool HasPath(Ipv4Address nextHop);
+  /**
+   * Add a path found by link-disjoint discovery, as AOMDV does. Paths are
+   * kept for the freshest destination sequence number only: a newer one
+   * drops the paths of the older one, and paths of an older one are
+   * refused. A path is refused if another path already goes through its
+   * next hop or its first hop, so that the paths stay link-disjoint, or if
+   * it is longer than the advertised hop count (see Advertise()), so that
+   * no loop forms.
+   * @param nextHop the next hop of the path
+   * @param firstHop the node next to the far end of the path
+   * @param hopCount the hop count of the path
+   * @param lifetime the lifetime of the path
+   * @param seqNo the destination sequence number the path was found with
+   * @returns true if the path was added
+   */
+  bool AddDisjointPath(Ipv4Address nextHop,
+                       Ipv4Address firstHop,
+                       uint32_t hopCount,
+                       Time lifetime,
+                       uint32_t seqNo);
+  /**
+   * Record that this node advertises a route to the destination, e.g. by
+   * relaying a RREQ or RREP. The first time for the current sequence number,
+   * the advertised hop count is fixed to the longest path.
+   * @returns the advertised hop count, the maximum uint32_t if there is none
+   */
+  uint32_t Advertise();
+
 private:
+  /// Remove the expired paths, if the earliest expiry has passed
+  void Expire();
+  /**
+   * Compute the composite score of a path, through its row of the batch if
+   * it has one
+   * @param path the path
+   */
+  void Rescore(PathInfo& path);
+  /**
+   * Give back the row of a path about to be removed
+   * @param path the path
+   */
+  void ReleaseRow(PathInfo& path);
+  /**
+   * Move a path whose score or hop count changed to its place in the order
+   * @param i the position of the path
+   */
+  void Reposition(size_t i);
+  /// Sort the paths by Ranks() after all of them were rescored
+  void SortPaths();
+  /**
+   * @param a a path
+   * @param b another path
+   * @returns true if a ranks before b: higher score, then fewer hops
+   */
+  static bool Ranks(const PathInfo& a, const PathInfo& b);
+
   Ipv4Address m_destination;
+  /// The paths, kept sorted by Ranks(); there are only a few per destination
   std::vector<PathInfo> m_paths;
+  /// Weights of the composite score of the paths
+  WeightFactors m_weights;
+  /// Batch holding the metrics of the paths, if any
+  PathScoreBatch* m_metrics;
+  /// Earliest expiry time of the paths, Time::Max() if there are none
+  Time m_nextExpiry;
+  /// Destination sequence number of the paths found by AddDisjointPath()
+  uint32_t m_seqNo;
+  /// Longest path accepted by AddDisjointPath(), fixed by Advertise()
+  uint32_t m_advertisedHops;
 };
 // ======================= END ===========================
+/**
+ * @ingroup aodv
+ * @brief One route of a binary routing table snapshot.
+ *
+ * A snapshot file starts with a HEADER_SIZE byte header: the eight
+ * characters "AODVSNAP", the format VERSION and SIZE as 32-bit integers,
+ * and the simulation time in nanoseconds as a 64-bit integer. SIZE byte
+ * records follow until the end of the file. All integers are little endian,
+ * so the files can be decoded offline on any host.
+ */
+struct RouteRecord
+{
+    static constexpr uint32_t HEADER_SIZE = 24; //!< Bytes of the file header
+    static constexpr uint32_t VERSION = 1;      //!< Format version
+    static constexpr uint32_t SIZE = 28;        //!< Bytes of a record
+
+    uint32_t node;    //!< Id of the node holding the route
+    uint32_t dst;     //!< Destination address
+    uint32_t nextHop; //!< Next hop address
+    uint32_t iface;   //!< Local address of the output interface
+    uint32_t seqNo;   //!< Destination sequence number
+    int32_t expire;   //!< Remaining lifetime, milliseconds
+    uint16_t hops;    //!< Hop count
+    uint8_t state;    //!< RouteFlags in bits 0-1, valid seqno in bit 2
+
+    /**
+     * Encode the record
+     * @param buffer SIZE bytes to write to
+     */
+    void Write(uint8_t* buffer) const;
+    /**
+     * Decode a record
+     * @param buffer SIZE bytes to read from
+     */
+    void Read(const uint8_t* buffer);
+};
+
 /**
  * @ingroup aodv
  * @brief The Routing table used by AODV protocol
+ *
+ * By default the entries are stored whole in a hash table. SetCompact()
+ * selects a structure-of-arrays layout instead, meant for simulations with
+ * many nodes that each learn routes to most others: one row per destination
+ * id of the table's AddressIndex, holding the sequence number, hop count,
+ * flags, RREQ count, lifetime in milliseconds, next hop id and interface;
+ * precursors live in a side table keyed by the few destinations that have
+ * them. A row takes 16 bytes, plus 4 in the index of rows by next hop and 8
+ * for each queued expiry event; each address the table has seen also keeps an
+ * entry in the AddressIndex. Entries are rebuilt from the rows when they are
+ * looked up, so in this layout FindRoute() returns a copy, valid until the
+ * next call on the table, whose Ipv4Route is reused by the next lookup unless
+ * a caller of GetRoute() still holds it. Lifetimes are rounded up to the next
+ * millisecond, and the layout cannot be used past about 49.7 days of
+ * simulated time (see ToTicks()).
  */
 class RoutingTable 
 {
@@ -560,6 +907,28 @@ class RoutingTable
      */
     RoutingTable(Time t);
 
+    /**
+     * Select the storage layout. Must be called while the table is empty.
+     * @param compact true for the structure-of-arrays layout
+     */
+    void SetCompact(bool compact);
+
+    /**
+     * @return true if the structure-of-arrays layout is used
+     */
+    bool IsCompact() const
+    {
+        return m_compact;
+    }
+
+    /**
+     * @return the number of entries
+     */
+    uint32_t GetSize() const
+    {
+        return m_compact ? m_rowCount : m_ipv4AddressEntry.size();
+    }
+
     /// @name Handle lifetime of invalid route
     //\{
     /**
@@ -609,6 +978,57 @@ class RoutingTable
      * @return true on success
      */
     bool LookupValidRoute(Ipv4Address dst, RoutingTableEntry& rt);
+    /**
+     * Lookup routing table entry with destination address dst without copying it.
+     * The pointer is invalidated by the next call that adds, deletes or modifies
+     * routes, including the implicit purge done by all lookups. In the compact
+     * layout it points to a copy, which is invalidated by any call on the table.
+     * @param dst destination address
+     * @return the entry, or nullptr if there is none
+     */
+    const RoutingTableEntry* FindRoute(Ipv4Address dst);
+    /**
+     * Modify routing table entry with destination address dst in place. This
+     * is equivalent to LookupRoute() followed by Update() with the modified
+     * copy, but no entry is copied.
+     * @param dst destination address
+     * @param fn callable taking a RoutingTableEntry&. It must not change the
+     *        destination nor access the routing table. It returns true to
+     *        complete the update as Update() does, or false if it left the
+     *        entry unchanged.
+     * @return the value returned by fn, false if there is no such entry
+     */
+    template <typename F>
+    bool ModifyRoute(Ipv4Address dst, F fn)
+    {
+        Purge();
+        RoutingTableEntry* rt = Find(dst);
+        if (!rt)
+        {
+            return false;
+        }
+        RouteFlags flag = rt->GetFlag();
+        Ipv4Address nextHop = rt->GetNextHop();
+        if (!fn(*rt))
+        {
+            return false;
+        }
+        CompleteUpdate(*rt);
+        Store(*rt);
+        RecordUpdate(flag, nextHop, *rt);
+        return true;
+    }
+    /**
+     * Refresh a VALID route on use: reset its RREQ count and make its lifetime
+     * no less than lifetime from now. This has the same observable effect as
+     * the equivalent ModifyRoute(), but only records the new deadline in the
+     * entry (see RoutingTableEntry::Touch()); Purge() merges it when the old
+     * lifetime runs out, so no expiry event is queued per packet.
+     * @param dst destination address
+     * @param lifetime the minimum lifetime
+     * @return true if a VALID route to dst exists
+     */
+    bool TouchRoute(Ipv4Address dst, Time lifetime);
     /**
      * Update routing table
      * @param rt entry with destination address dst, if exists
@@ -624,6 +1044,10 @@ class RoutingTable
     bool SetEntryState(Ipv4Address dst, RouteFlags state);
     /**
      * Lookup routing entries with next hop Address dst and not empty list of precursors.
+     * The entries are found through an index on the next hop, so the cost depends on
+     * the number of matching entries only. For the index to stay accurate the next hop
+     * of a stored entry must only be changed through AddRoute(), Update() or
+     * ModifyRoute().
      *
      * @param nextHop the next hop IP address
      * @param unreachable
@@ -636,9 +1060,14 @@ class RoutingTable
      *    exists and is valid, is incremented.
      * 2. The entry is invalidated by marking the route entry as invalid
      * 3. The Lifetime field is updated to current time plus DELETE_PERIOD.
+     *
+     * All destinations of a RERR are handled in one call, with one table lookup
+     * per destination, so the cost is linear in the size of unreachable and
+     * independent of the table size.
      * @param unreachable routes to invalidate
+     * @return the number of routes invalidated
      */
-    void InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unreachable);
+    uint32_t InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unreachable);
     /**
      * Delete all route from interface with address iface
      * @param iface the interface IP address
@@ -649,7 +1078,11 @@ class RoutingTable
     /**
      * @brief Add multipath route entry
      */
-    bool AddMultipathRoute(Ipv4Address dst, Ipv4Address nextHop, uint32_t hopCount, Time lifetime);
+    bool AddMultipathRoute(Ipv4Address dst,
+                           Ipv4Address nextHop,
+                           uint32_t hopCount,
+                           Time lifetime,
+                           uint32_t seqNo);
 
     /**
      * @brief Get best multipath route for destination
@@ -661,6 +1094,33 @@ class RoutingTable
      */
     std::vector<MultipathRouteEntry::PathInfo> GetAllMultipathRoutes(Ipv4Address dst);  // PERBAIKAN
 
+    /**
+     * View the unexpired multipath paths to a destination without copying
+     * them (see MultipathRouteEntry::GetPaths()). The view stays valid until
+     * the multipath table is next changed or purged, which includes any
+     * route lookup.
+     * @param dst the destination
+     * @returns the paths, highest composite score first; empty if there are none
+     */
+    MultipathRouteEntry::PathSpan GetMultipathPaths(Ipv4Address dst);
+
+    /**
+     * Call a function on each unexpired multipath path to a destination,
+     * highest composite score first. The function must not change the
+     * routing table.
+     * @param dst the destination
+     * @param fn the function, called with a const MultipathRouteEntry::PathInfo&
+     */
+    template <typename F>
+    void ForEachMultipathPath(Ipv4Address dst, F fn)
+    {
+        auto it = m_multipathTable.find(dst);
+        if (it != m_multipathTable.end())
+        {
+            it->second.ForEachPath(fn);
+        }
+    }
+
     /**
      * @brief Check if multipath route exists for destination
      */
@@ -672,9 +1132,184 @@ class RoutingTable
     bool RemoveMultipathRoute(Ipv4Address dst, Ipv4Address nextHop);
 
     /**
-     * @brief Purge expired multipath routes
+     * Remove the expired multipath paths, and the entries left without
+     * paths. Only the entries with an expiry event due are visited.
      */
     void PurgeMultipathRoutes();
+    /// @returns the number of multipath entries, including those with only expired paths
+    size_t GetMultipathSize() const
+    {
+        return m_multipathTable.size();
+    }
+
+    /**
+     * Set the weights of the composite score of all multipath entries, present
+     * and future. The paths are rescored only if the weights changed, all of
+     * them in one pass over the metric columns of the table.
+     * @param weights the weights
+     */
+    void SetMultipathWeights(const WeightFactors& weights);
+    /// @returns the metric columns of the multipath paths
+    const PathScoreBatch& GetPathMetrics() const
+    {
+        return m_pathMetrics;
+    }
+
+    /**
+     * Set the weight of a transmission outcome in the stability of a
+     * multipath path (see UpdateMultipathStability())
+     * @param weight the weight, 0 to 1
+     */
+    void SetMultipathStabilityWeight(double weight)
+    {
+        m_multipathStabilityWeight = weight;
+    }
+
+    /// @returns the weight of a transmission outcome in the stability of a path
+    double GetMultipathStabilityWeight() const
+    {
+        return m_multipathStabilityWeight;
+    }
+
+    /**
+     * Set the composite score by which the best multipath path to a
+     * destination must beat the path of its route for a route switch to be
+     * considered (see UpdateMultipathStability())
+     * @param margin the margin
+     */
+    void SetMultipathSwitchMargin(double margin)
+    {
+        m_multipathSwitchMargin = margin;
+    }
+
+    /// @returns the score margin of a route switch
+    double GetMultipathSwitchMargin() const
+    {
+        return m_multipathSwitchMargin;
+    }
+
+    /**
+     * Pick the next hop of a data packet among the multipath routes to dst
+     * that may stand in for the route to dst (see
+     * MultipathRouteEntry::SelectNextHop())
+     * @param dst the destination of the packet
+     * @param mode WEIGHTED_ROUND_ROBIN, FLOW_HASH or FLOW_PINNED
+     * @param flowHash hash of the flow of the packet, for FLOW_HASH and FLOW_PINNED
+     * @param exclude a next hop not to pick
+     * @param nextHop the next hop picked
+     * @return false if dst has no route or no multipath route to pick
+     */
+    bool SelectMultipathNextHop(Ipv4Address dst,
+                                MultipathSelection mode,
+                                uint32_t flowHash,
+                                Ipv4Address exclude,
+                                Ipv4Address& nextHop);
+
+    /**
+     * @param dst a destination
+     * @param nextHop a next hop
+     * @return true if dst has an unexpired multipath route through nextHop
+     */
+    bool HasMultipathPath(Ipv4Address dst, Ipv4Address nextHop);
+
+    /**
+     * @param dst a destination
+     * @param nextHop a next hop
+     * @return true if dst has an unexpired multipath route through nextHop
+     * that may stand in for the route to dst (see
+     * MultipathRouteEntry::IsAlternate())
+     */
+    bool HasAlternateMultipathPath(Ipv4Address dst, Ipv4Address nextHop);
+
+    /**
+     * Move the VALID route to dst off a broken next hop, onto the best
+     * multipath route left to dst whose next hop is still a VALID neighbor.
+     * The paths through the broken next hop are dropped in any case, and so
+     * are those that may not stand in for the route (see
+     * MultipathRouteEntry::IsAlternate()). The
+     * route takes the hop count, device and interface of the promoted path and
+     * keeps its sequence number and precursors; its lifetime is extended to
+     * the path's if that is longer.
+     * @param dst the destination
+     * @param brokenNextHop the next hop that can no longer be reached
+     * @return true if the route to dst now goes through another next hop
+     */
+    bool PromoteMultipathRoute(Ipv4Address dst, Ipv4Address brokenNextHop);
+
+    /**
+     * Move the VALID route to dst onto the multipath route through nextHop,
+     * as PromoteMultipathRoute() does, e.g. because that path now scores
+     * better than the one in use. The route is left alone if nextHop is not
+     * a VALID neighbor, and the path is dropped if it may not stand in for
+     * the route.
+     * @param dst the destination
+     * @param nextHop the next hop of the path to take
+     * @return true if the route to dst now goes through nextHop
+     */
+    bool SwitchMultipathRoute(Ipv4Address dst, Ipv4Address nextHop);
+
+    /**
+     * Replace the link metrics (residual energy and RSSI) of the multipath
+     * paths through a neighbor and rerank the paths of their destinations.
+     * Only the destinations with a path through the neighbor are visited.
+     * @param neighbor the neighbor
+     * @param metrics its new metrics
+     */
+    void UpdateMultipathLinkMetrics(Ipv4Address neighbor, const BLEMetrics& metrics);
+
+    /**
+     * Record the outcome of a transmission on the multipath path to dst
+     * through nextHop (see MultipathRouteEntry::UpdatePathStability()) and
+     * rerank the paths to dst. Only the stability of the path changes, so it
+     * alone is rescored, from its row of the metric columns of the table.
+     * Since this happens for every frame, the rerank callback is only called
+     * if the best path changed, or started or stopped beating the path of the
+     * route to dst by the switch margin.
+     * @param dst the destination
+     * @param nextHop the next hop of the path
+     * @param successfulTransmission whether the transmission succeeded
+     * @return false if there is no such path
+     */
+    bool UpdateMultipathStability(Ipv4Address dst,
+                                  Ipv4Address nextHop,
+                                  bool successfulTransmission);
+
+    /**
+     * Set the callback called with a destination whenever its multipath
+     * paths are added to or rescored, so that the caller can act on the new
+     * ranking. The callback runs while the table is being changed, so it
+     * should defer any use of the table.
+     * @param cb the callback function
+     */
+    void SetMultipathRerankCallback(Callback<void, Ipv4Address> cb)
+    {
+        m_multipathRerank = cb;
+    }
+
+    /**
+     * Add a multipath route found by link-disjoint discovery (see
+     * MultipathRouteEntry::AddDisjointPath())
+     * @param dst the destination
+     * @param nextHop the next hop of the path
+     * @param firstHop the node next to dst on the path
+     * @param hopCount the hop count of the path
+     * @param lifetime the lifetime of the path
+     * @param seqNo the destination sequence number the path was found with
+     * @return true if the path was added
+     */
+    bool AddDisjointMultipathRoute(Ipv4Address dst,
+                                   Ipv4Address nextHop,
+                                   Ipv4Address firstHop,
+                                   uint32_t hopCount,
+                                   Time lifetime,
+                                   uint32_t seqNo);
+
+    /**
+     * Record that this node advertises its route to dst (see
+     * MultipathRouteEntry::Advertise())
+     * @param dst the destination
+     */
+    void AdvertiseMultipathRoute(Ipv4Address dst);
     
     // =============== END ==================
 
@@ -682,39 +1317,345 @@ class RoutingTable
     void Clear()
     {
         m_ipv4AddressEntry.clear();
+        m_expiryQueue = ExpiryQueue();
+        m_nextHopIndex.clear();
+        m_indexedNextHop.clear();
+        m_rows.Clear();
+        m_rowCount = 0;
+        m_rowExpiryQueue = RowExpiryQueue();
+        m_rowPrecursors.clear();
+        m_rowsByNextHop.clear();
+        m_multipathTable.clear();
+        m_pathMetrics.Clear();
+        m_multipathExpiryQueue = ExpiryQueue();
+        m_multipathNextHopIndex.clear();
+        m_multipathIndexedNextHops.clear();
+        m_journal.Clear();
     }
 
-    /// Delete all outdated entries and invalidate valid entry if Lifetime is expired
+    /**
+     * Delete all outdated entries and invalidate valid entry if Lifetime is expired.
+     * Only the entries whose lifetime has run out are visited, so the cost does
+     * not depend on the table size.
+     */
     void Purge();
-    /** Mark entry as unidirectional (e.g. add this neighbor to "blacklist" for blacklistTimeout
-     * period)
-     * @param neighbor neighbor address link to which assumed to be unidirectional
-     * @param blacklistTimeout time for which the neighboring node is put into the blacklist
-     * @return true on success
+    /**
+     * Get a copy of every route, in destination order, as Purge() would
+     * leave them: expired valid routes are invalidated and expired invalid
+     * ones left out
+     * @param routes the vector to fill
      */
-    bool MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeout);
+    void GetRoutes(std::vector<RoutingTableEntry>& routes) const;
     /**
-     * Print routing table
+     * Print routing table, in destination order. The routes are read in
+     * place; expired ones are shown as Purge() would leave them.
      * @param stream the output stream
      * @param unit The time unit to use (default Time::S)
      */
     void Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
+    /**
+     * Write a RouteRecord for each route, in no particular order. The routes
+     * are read in place and written as Print() shows them, so an expired
+     * valid route is written as invalid and an expired invalid one is left
+     * out. Remaining lifetimes beyond the range of RouteRecord::expire are
+     * clamped to it.
+     * @param os the binary stream to write to
+     * @param node the node id to put in the records
+     * @return the number of records written
+     */
+    uint32_t WriteSnapshot(std::ostream& os, uint32_t node) const;
+
+    /**
+     * Get the journal of the changes of the table. It records nothing until
+     * its capacity is set. Lifetime extensions by TouchRoute() and changes of
+     * the RREQ count alone are not recorded.
+     * @return the journal
+     */
+    RouteJournal& GetJournal()
+    {
+        return m_journal;
+    }
+
+    /**
+     * Get the journal of the changes of the table
+     * @return the journal
+     */
+    const RouteJournal& GetJournal() const
+    {
+        return m_journal;
+    }
 
   private:
-    /// The routing table
-    std::map<Ipv4Address, RoutingTableEntry> m_ipv4AddressEntry;
+    /// The routing table, hashed on destination address
+    AddressMap<RoutingTableEntry> m_ipv4AddressEntry;
     
     /// Multipath routing table - TAMBAHAN BARU
     std::map<Ipv4Address, MultipathRouteEntry> m_multipathTable;
     
     /// Deletion time for invalid routes
     Time m_badLinkLifetime;
-    
+
+    /// Expiration time and destination of a routing table entry
+    typedef std::pair<Time, Ipv4Address> ExpiryEvent;
+    /// Min-heap of expiry events, earliest first
+    typedef std::priority_queue<ExpiryEvent, std::vector<ExpiryEvent>, std::greater<ExpiryEvent>>
+        ExpiryQueue;
+    /**
+     * Expiry events of the routing table entries. An event is queued whenever
+     * the lifetime or the state of an entry changes, so an entry may have
+     * several events of which only the latest one is current; Purge() checks
+     * the entry itself before acting on an event.
+     */
+    ExpiryQueue m_expiryQueue;
+    /**
+     * Expiry events of the multipath entries. An event is queued whenever the
+     * earliest path expiry of an entry moves earlier, and requeued when it
+     * fires for an entry whose paths were refreshed meanwhile, so every entry
+     * has an event no later than its earliest expiry. Stale events of an entry
+     * are only checked against the entry when they fire.
+     */
+    ExpiryQueue m_multipathExpiryQueue;
+    /**
+     * Destinations with a multipath path through each next hop. A path that
+     * expires stays in the index until the expiry event of its destination
+     * fires; removed paths leave it at once.
+     */
+    AddressMap<std::vector<Ipv4Address>> m_multipathNextHopIndex;
+    /// Next hops each destination is filed under in m_multipathNextHopIndex
+    AddressMap<std::vector<Ipv4Address>> m_multipathIndexedNextHops;
+    /// Called with the destinations whose multipath paths were reranked
+    Callback<void, Ipv4Address> m_multipathRerank;
+    /// Weights of the composite score of the multipath entries
+    WeightFactors m_multipathWeights;
+    /// Metrics and scores of the paths of all multipath entries, in columns
+    PathScoreBatch m_pathMetrics;
+    /// Weight of a transmission outcome in the stability of a multipath path
+    double m_multipathStabilityWeight;
+    /// Score margin of a route switch
+    double m_multipathSwitchMargin;
+    /// Destinations of the entries routed through each next hop
+    AddressMap<std::vector<Ipv4Address>> m_nextHopIndex;
+    /// Next hop under which each destination is filed in m_nextHopIndex
+    AddressMap<Ipv4Address> m_indexedNextHop;
+    /// Changes of the table
+    RouteJournal m_journal;
+
+    /// @name Compact layout
+    //\{
+    /// Bits of RouteRows::m_state
+    enum RowState : uint8_t
+    {
+        ROW_FLAG_MASK = 0x03, //!< RouteFlags of the entry
+        ROW_VALID_SEQNO = 0x04, //!< Valid sequence number flag
+        ROW_TOUCHED = 0x10, //!< Lifetime extended by TouchRoute() beyond its queued event
+        ROW_PRESENT = 0x80, //!< The row holds an entry
+    };
+
+    /// The entries, one column per field, indexed by destination id
+    struct RouteRows
+    {
+        std::vector<uint32_t> m_seqNo;    //!< Sequence numbers
+        std::vector<uint32_t> m_lifetime; //!< Lifetimes, in milliseconds since the start
+        std::vector<uint32_t> m_nextHop;  //!< Next hop ids
+        std::vector<uint8_t> m_hops;      //!< Hop counts, saturated at 255
+        std::vector<uint8_t> m_state;     //!< RowState bits
+        std::vector<uint8_t> m_reqCount;  //!< RREQ counts
+        std::vector<uint8_t> m_iface;     //!< Positions in m_rowIfaces
+
+        /**
+         * Make room for a row
+         * @param id the row
+         */
+        void Reserve(uint32_t id);
+        /// Remove all rows
+        void Clear();
+    };
+
+    /// Whether the compact layout is used
+    bool m_compact;
+    /// Numbering of destinations and next hops
+    AddressIndex m_addressIndex;
+    /// The rows
+    RouteRows m_rows;
+    /// Number of present rows
+    uint32_t m_rowCount;
+    /// Distinct interfaces and output devices of the rows
+    std::vector<std::pair<Ipv4InterfaceAddress, Ptr<NetDevice>>> m_rowIfaces;
+    /// Precursors of the rows that have some
+    AddressMap<std::vector<Ipv4Address>> m_rowPrecursors;
+    /// Present rows routed through each next hop, indexed by next hop id
+    std::vector<std::vector<uint32_t>> m_rowsByNextHop;
+    /// Expiry events of the rows, as lifetime << 32 | id, earliest first
+    typedef std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>>
+        RowExpiryQueue;
+    /// Expiry events of the rows, handled as m_expiryQueue
+    RowExpiryQueue m_rowExpiryQueue;
+    /// Entry rebuilt from a row by Find()
+    RoutingTableEntry m_scratch;
+
+    /**
+     * Convert a time to the lifetime unit of the rows, rounding up. Times
+     * before the start of the simulation are stored as 0, and times past
+     * UINT32_MAX milliseconds (about 49.7 days) as UINT32_MAX. The table never
+     * reaches that lifetime: it aborts once the simulation itself gets there.
+     * @param t the absolute time
+     * @return t in milliseconds
+     */
+    static uint32_t ToTicks(Time t);
+    /**
+     * Rebuild the entry of a present row
+     * @param id the row
+     * @param rt the entry to fill in
+     */
+    void LoadRow(uint32_t id, RoutingTableEntry& rt) const;
+    /**
+     * Write an entry to its row
+     * @param id the row
+     * @param rt the entry
+     */
+    void StoreRow(uint32_t id, const RoutingTableEntry& rt);
+    /**
+     * Remove a row from m_rowsByNextHop
+     * @param id the row, present
+     */
+    void UnindexRow(uint32_t id);
+    /**
+     * @param dst a destination
+     * @return the row of dst, or AddressIndex::NONE if it has no entry
+     */
+    uint32_t FindRow(Ipv4Address dst) const;
+    /// Purge() for the compact layout
+    void PurgeRows();
+    //\}
+
+    /// Fields of a route as Print() and WriteSnapshot() show it
+    struct RouteView
+    {
+        Ipv4Address dst;     //!< Destination
+        Ipv4Address nextHop; //!< Next hop
+        Ipv4Address iface;   //!< Local address of the output interface
+        RouteFlags flag;     //!< State
+        Time expire;         //!< Remaining lifetime
+        uint32_t seqNo;      //!< Destination sequence number
+        uint16_t hops;       //!< Hop count
+        bool validSeqNo;     //!< Valid sequence number flag
+    };
+
+    /**
+     * Call fn(view) for each route, in place and in no particular order.
+     * Routes are shown as Purge() would leave them: expired valid ones as
+     * invalid for the bad link lifetime, expired invalid ones not at all.
+     * @param fn the callable
+     */
+    template <typename F>
+    void ForEachRoute(F fn) const;
+
+    /// Routes sorted by Print(), kept to reuse the storage
+    mutable std::vector<RouteView> m_printBuffer;
+
+    /**
+     * Find an entry: the stored one, or in the compact layout a copy in m_scratch
+     * @param dst the destination address
+     * @return the entry, or nullptr if there is none
+     */
+    RoutingTableEntry* Find(Ipv4Address dst);
+    /**
+     * Write back an entry returned by Find() after modifying it; nothing to do
+     * unless the compact layout is used
+     * @param rt the entry
+     */
+    void Store(const RoutingTableEntry& rt);
+    /**
+     * Insert an entry
+     * @param rt the entry
+     * @return false if there is already an entry for its destination
+     */
+    bool Insert(const RoutingTableEntry& rt);
+    /**
+     * Remove the entry of a destination, which must exist
+     * @param dst the destination address
+     */
+    void Erase(Ipv4Address dst);
+
+    /**
+     * Queue an expiry event for the current lifetime of an entry
+     * @param rt the routing table entry
+     */
+    void ScheduleExpiry(const RoutingTableEntry& rt);
+    /**
+     * Queue an expiry event for a multipath entry if its earliest expiry
+     * moved earlier
+     * @param dst the destination of the entry
+     * @param before the earliest expiry before the change
+     * @param after the earliest expiry after the change
+     */
+    void QueueMultipathExpiry(Ipv4Address dst, Time before, Time after);
+    /**
+     * File a destination under a next hop of one of its multipath paths
+     * @param dst the destination
+     * @param nextHop the next hop
+     */
+    void IndexMultipathPath(Ipv4Address dst, Ipv4Address nextHop);
+    /**
+     * Take a destination out of the index under the next hops it no longer
+     * has a multipath path through
+     * @param dst the destination
+     */
+    void UnindexMultipathPaths(Ipv4Address dst);
+    /**
+     * Move the VALID route to dst from one next hop onto a multipath path.
+     * A path with another sequence number or more hops than the route is
+     * dropped instead.
+     * @param dst the destination
+     * @param from the next hop the route must have
+     * @param path the path; its next hop must be a VALID neighbor
+     * @return true if the route was moved
+     */
+    bool MoveRouteToPath(Ipv4Address dst,
+                         Ipv4Address from,
+                         const MultipathRouteEntry::PathInfo& path);
+    /**
+     * Call the rerank callback, if any
+     * @param dst the destination whose paths were reranked
+     */
+    void NotifyMultipathRerank(Ipv4Address dst);
+    /**
+     * @param entry the multipath entry of a destination
+     * @param current the next hop of the route to the destination
+     * @returns the next hop of the best path of entry, and whether it beats
+     * the path through current by the switch margin
+     */
+    std::pair<Ipv4Address, bool> GetMultipathLeader(MultipathRouteEntry& entry,
+                                                    Ipv4Address current) const;
+    /**
+     * Bookkeeping after an entry in the table has been updated: reset its RREQ
+     * count unless it is in search and queue its new expiry
+     * @param rt the updated routing table entry
+     */
+    void CompleteUpdate(RoutingTableEntry& rt);
+    /**
+     * Journal the update of an entry in the table
+     * @param flag the state of the entry before the update
+     * @param nextHop the next hop of the entry before the update
+     * @param rt the updated routing table entry
+     */
+    void RecordUpdate(RouteFlags flag, Ipv4Address nextHop, const RoutingTableEntry& rt);
+    /**
+     * File an entry in the next hop index under its current next hop
+     * @param rt the routing table entry
+     */
+    void IndexNextHop(const RoutingTableEntry& rt);
+    /**
+     * Remove a destination from the next hop index, before its entry is erased
+     * @param dst the destination address
+     */
+    void UnindexNextHop(Ipv4Address dst);
+
     /**
      * const version of Purge, for use by Print() method
      * @param table the routing table entry to purge
      */
-    void Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const;
+    void Purge(AddressMap<RoutingTableEntry>& table) const;
 };
 
 
@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AODV_STATE_IO_H
+#define AODV_STATE_IO_H
+
+#include "ns3/abort.h"
+
+#include <istream>
+#include <ostream>
+#include <stdint.h>
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * @ingroup aodv
+ * Write an unsigned integer of the saved routing state in little endian order
+ * @param os the stream to write to
+ * @param value the value
+ * @param bytes the number of bytes to write
+ */
+inline void
+WriteStateField(std::ostream& os, uint64_t value, uint32_t bytes)
+{
+    for (uint32_t i = 0; i < bytes; ++i)
+    {
+        os.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+/**
+ * @ingroup aodv
+ * Read an unsigned integer written by WriteStateField()
+ * @param is the stream to read from
+ * @param bytes the number of bytes to read
+ * @returns the value
+ */
+inline uint64_t
+ReadStateField(std::istream& is, uint32_t bytes)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < bytes; ++i)
+    {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(is.get())) << (8 * i);
+    }
+    NS_ABORT_MSG_IF(!is, "AODV: truncated routing state");
+    return value;
+}
+
+} // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_STATE_IO_H */
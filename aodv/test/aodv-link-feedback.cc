@@ -0,0 +1,218 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "ns3/aodv-helper.h"
+#include "ns3/aodv-routing-protocol.h"
+#include "ns3/double.h"
+#include "ns3/error-model.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "ns3/socket-factory.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/uinteger.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/yans-wifi-helper.h"
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief MAC feedback test case
+ *
+ * Node 0 sends UDP packets to node 2 through node 1, and to node 1 itself,
+ * on a chain where node 1 loses a share of the frames it receives. The
+ * acknowledged and negatively acknowledged data frames of node 0 must show
+ * up in the stability of its multipath paths through node 1, both to node 2
+ * and to node 1 itself.
+ */
+class LinkFeedbackTestCase : public TestCase
+{
+    NodeContainer m_nodes;            //!< the chain
+    Ipv4InterfaceContainer m_ifaces;  //!< interfaces of the chain
+    Ptr<Socket> m_txSocket;           //!< transmit socket of node 0
+    std::vector<Ptr<Socket>> m_sinks; //!< receive sockets of nodes 1 and 2
+
+    /// @returns the AODV routing protocol of node 0
+    Ptr<RoutingProtocol> GetSource() const;
+    /// Add the multipath paths of node 0 along its routes
+    void AddPaths();
+    /**
+     * Send one packet to each of nodes 1 and 2
+     * @param socket the socket to send from
+     */
+    void SendData(Ptr<Socket> socket);
+
+  public:
+    LinkFeedbackTestCase();
+    void DoRun() override;
+};
+
+LinkFeedbackTestCase::LinkFeedbackTestCase()
+    : TestCase("AODV MAC feedback of routed data")
+{
+}
+
+Ptr<RoutingProtocol>
+LinkFeedbackTestCase::GetSource() const
+{
+    return DynamicCast<RoutingProtocol>(m_nodes.Get(0)->GetObject<Ipv4>()->GetRoutingProtocol());
+}
+
+void
+LinkFeedbackTestCase::AddPaths()
+{
+    RoutingTable& rtable = GetSource()->GetRoutingTable();
+    for (uint32_t i : {1, 2})
+    {
+        Ipv4Address dst = m_ifaces.GetAddress(i);
+        const RoutingTableEntry* rt = rtable.FindRoute(dst);
+        NS_TEST_ASSERT_MSG_NE(rt, nullptr, "Route discovered");
+        rtable.AddMultipathRoute(dst,
+                                 rt->GetNextHop(),
+                                 rt->GetHop(),
+                                 Seconds(100),
+                                 rt->GetSeqNo());
+    }
+}
+
+void
+LinkFeedbackTestCase::SendData(Ptr<Socket> socket)
+{
+    for (uint32_t i : {1, 2})
+    {
+        socket->SendTo(Create<Packet>(64), 0, InetSocketAddress(m_ifaces.GetAddress(i), 9));
+    }
+    Simulator::ScheduleWithContext(socket->GetNode()->GetId(),
+                                   MilliSeconds(50),
+                                   &LinkFeedbackTestCase::SendData,
+                                   this,
+                                   socket);
+}
+
+void
+LinkFeedbackTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    m_nodes.Create(3);
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                  "MinX",
+                                  DoubleValue(0.0),
+                                  "MinY",
+                                  DoubleValue(0.0),
+                                  "DeltaX",
+                                  DoubleValue(120),
+                                  "DeltaY",
+                                  DoubleValue(0),
+                                  "GridWidth",
+                                  UintegerValue(3),
+                                  "LayoutType",
+                                  StringValue("RowFirst"));
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(m_nodes);
+
+    // Setup WiFi, the adhoc MAC sends non-QoS data frames
+    WifiMacHelper wifiMac;
+    wifiMac.SetType("ns3::AdhocWifiMac");
+    YansWifiPhyHelper wifiPhy;
+    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
+    wifiPhy.SetChannel(wifiChannel.Create());
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211a);
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode",
+                                 StringValue("OfdmRate6Mbps"),
+                                 "RtsCtsThreshold",
+                                 StringValue("2200"));
+    NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, m_nodes);
+
+    // Node 1 loses a fifth of the frames it receives
+    Ptr<RateErrorModel> em = CreateObject<RateErrorModel>();
+    em->SetAttribute("ErrorRate", DoubleValue(0.2));
+    em->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+    DynamicCast<WifiNetDevice>(devices.Get(1))->GetPhy()->SetPostReceptionErrorModel(em);
+
+    // Setup TCP/IP & AODV
+    AodvHelper aodv;
+    InternetStackHelper internetStack;
+    internetStack.SetRoutingHelper(aodv);
+    internetStack.Install(m_nodes);
+    Ipv4AddressHelper address;
+    address.SetBase("10.1.1.0", "255.255.255.0");
+    m_ifaces = address.Assign(devices);
+    GetSource()->SetMultipathEnabled(true);
+
+    for (uint32_t i : {1, 2})
+    {
+        Ptr<Socket> sink = m_nodes.Get(i)->GetObject<UdpSocketFactory>()->CreateSocket();
+        sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), 9));
+        m_sinks.push_back(sink);
+    }
+    m_txSocket = m_nodes.Get(0)->GetObject<UdpSocketFactory>()->CreateSocket();
+    Simulator::ScheduleWithContext(m_txSocket->GetNode()->GetId(),
+                                   Seconds(1),
+                                   &LinkFeedbackTestCase::SendData,
+                                   this,
+                                   m_txSocket);
+    Simulator::Schedule(Seconds(3), &LinkFeedbackTestCase::AddPaths, this);
+
+    Simulator::Stop(Seconds(10));
+    Simulator::Run();
+
+    RoutingTable& rtable = GetSource()->GetRoutingTable();
+    MultipathRouteEntry::PathSpan routed = rtable.GetMultipathPaths(m_ifaces.GetAddress(2));
+    NS_TEST_ASSERT_MSG_EQ(routed.size(), 1, "Path to node 2 kept");
+    NS_TEST_EXPECT_MSG_EQ(routed.front().nextHop, m_ifaces.GetAddress(1), "Through node 1");
+    NS_TEST_EXPECT_MSG_LT(routed.front().bleMetrics.stabilityScore, 1.0, "Lost frames seen");
+    NS_TEST_EXPECT_MSG_GT(routed.front().bleMetrics.stabilityScore,
+                          0.5,
+                          "Acknowledged frames seen");
+    MultipathRouteEntry::PathSpan direct = rtable.GetMultipathPaths(m_ifaces.GetAddress(1));
+    NS_TEST_ASSERT_MSG_EQ(direct.size(), 1, "Path to node 1 kept");
+    NS_TEST_EXPECT_MSG_LT(direct.front().bleMetrics.stabilityScore,
+                          1.0,
+                          "Lost frames to a neighbor seen");
+    NS_TEST_EXPECT_MSG_GT(direct.front().bleMetrics.stabilityScore,
+                          0.5,
+                          "Acknowledged frames to a neighbor seen");
+
+    m_txSocket->Close();
+    for (Ptr<Socket> sink : m_sinks)
+    {
+        sink->Close();
+    }
+    m_sinks.clear();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief AODV MAC feedback test suite
+ */
+class AodvLinkFeedbackTestSuite : public TestSuite
+{
+  public:
+    AodvLinkFeedbackTestSuite()
+        : TestSuite("routing-aodv-link-feedback", Type::SYSTEM)
+    {
+        AddTestCase(new LinkFeedbackTestCase(), TestCase::Duration::QUICK);
+    }
+} g_aodvLinkFeedbackTestSuite; ///< the test suite
+
+} // namespace aodv
+} // namespace ns3
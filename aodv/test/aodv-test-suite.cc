@@ -5,12 +5,23 @@
  *
  * Authors: Pavel Boyko <boyko@iitp.ru>
  */
+#include "ns3/aodv-address-index.h"
+#include "ns3/aodv-address-map.h"
+#include "ns3/aodv-blacklist.h"
+#include "ns3/aodv-flow-table.h"
 #include "ns3/aodv-neighbor.h"
 #include "ns3/aodv-packet.h"
 #include "ns3/aodv-rqueue.h"
+#include "ns3/aodv-routing-protocol.h"
 #include "ns3/aodv-rtable.h"
+#include "ns3/double.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/test.h"
+#include "ns3/wifi-mac-header.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
 
 namespace ns3
 {
@@ -205,6 +216,16 @@ struct RreqHeaderTest : public TestCase
         uint32_t bytes = p->RemoveHeader(h2);
         NS_TEST_EXPECT_MSG_EQ(bytes, 23, "RREP is 23 bytes long");
         NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+
+        h.SetMultipath(true);
+        NS_TEST_EXPECT_MSG_EQ(h.GetMultipath(), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.GetUnknownSeqno(), true, "Flags independent");
+        h.SetFirstHop(Ipv4Address("5.5.5.5"));
+        p->AddHeader(h);
+        bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 27, "Multipath RREQ carries the first hop");
+        NS_TEST_EXPECT_MSG_EQ(h2.GetFirstHop(), Ipv4Address("5.5.5.5"), "First hop read back");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
     }
 };
 
@@ -262,6 +283,16 @@ struct RrepHeaderTest : public TestCase
         uint32_t bytes = p->RemoveHeader(h2);
         NS_TEST_EXPECT_MSG_EQ(bytes, 19, "RREP is 19 bytes long");
         NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+
+        h.SetMultipath(true);
+        NS_TEST_EXPECT_MSG_EQ(h.GetMultipath(), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.GetAckRequired(), false, "Flags independent");
+        h.SetFirstHop(Ipv4Address("5.5.5.5"));
+        p->AddHeader(h);
+        bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 23, "Multipath RREP carries the first hop");
+        NS_TEST_EXPECT_MSG_EQ(h2.GetFirstHop(), Ipv4Address("5.5.5.5"), "First hop read back");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
     }
 };
 
@@ -593,10 +624,6 @@ struct AodvRtableEntryTest : public TestCase
         NS_TEST_EXPECT_MSG_EQ(rt.GetLifeTime(), Seconds(1), "trivial");
         rt.SetNextHop(Ipv4Address("1.1.1.1"));
         NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("1.1.1.1"), "trivial");
-        rt.SetUnidirectional(true);
-        NS_TEST_EXPECT_MSG_EQ(rt.IsUnidirectional(), true, "trivial");
-        rt.SetBlacklistTimeout(Seconds(7));
-        NS_TEST_EXPECT_MSG_EQ(rt.GetBlacklistTimeout(), Seconds(7), "trivial");
         rt.SetRreqCnt(2);
         NS_TEST_EXPECT_MSG_EQ(rt.GetRreqCnt(), 2, "trivial");
         rt.IncrementRreqCnt();
@@ -699,11 +726,7 @@ struct AodvRtableTest : public TestCase
                               true,
                               "trivial");
         NS_TEST_EXPECT_MSG_EQ(rtable.LookupRoute(Ipv4Address("5.5.5.5"), rt), false, "trivial");
-        NS_TEST_EXPECT_MSG_EQ(rtable.MarkLinkAsUnidirectional(Ipv4Address("1.2.3.4"), Seconds(2)),
-                              true,
-                              "trivial");
         NS_TEST_EXPECT_MSG_EQ(rtable.LookupRoute(Ipv4Address("1.2.3.4"), rt), true, "trivial");
-        NS_TEST_EXPECT_MSG_EQ(rt.IsUnidirectional(), true, "trivial");
         rt.SetLifeTime(Seconds(-5));
         NS_TEST_EXPECT_MSG_EQ(rtable.Update(rt), true, "trivial");
         std::map<Ipv4Address, uint32_t> unreachable;
@@ -719,6 +742,2228 @@ struct AodvRtableTest : public TestCase
     }
 };
 
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for AODV routing table lifetime expiry
+ */
+struct AodvRtableExpiryTest : public TestCase
+{
+    AodvRtableExpiryTest()
+        : TestCase("RtableExpiry"),
+          rtable(Seconds(2))
+    {
+    }
+
+    void DoRun() override;
+    /// Check state at 1.5 s: the first route has expired, the refreshed one has not
+    void CheckInvalidated();
+    /// Check state at 4 s: the expired route is gone after the bad link lifetime
+    void CheckDeleted();
+    /// The routing table
+    RoutingTable rtable;
+};
+
+void
+AodvRtableExpiryTest::DoRun()
+{
+    Ptr<NetDevice> dev;
+    Ipv4InterfaceAddress iface;
+    RoutingTableEntry rt(/*output device*/ dev,
+                         /*dst*/ Ipv4Address("1.2.3.4"),
+                         /*validSeqNo*/ true,
+                         /*seqNo*/ 10,
+                         /*interface*/ iface,
+                         /*hop*/ 1,
+                         /*next hop*/ Ipv4Address("1.2.3.4"),
+                         /*lifetime*/ Seconds(1));
+    NS_TEST_EXPECT_MSG_EQ(rtable.AddRoute(rt), true, "trivial");
+    RoutingTableEntry rt2(/*output device*/ dev,
+                          /*dst*/ Ipv4Address("4.3.2.1"),
+                          /*validSeqNo*/ true,
+                          /*seqNo*/ 10,
+                          /*interface*/ iface,
+                          /*hop*/ 2,
+                          /*next hop*/ Ipv4Address("1.2.3.4"),
+                          /*lifetime*/ Seconds(1));
+    NS_TEST_EXPECT_MSG_EQ(rtable.AddRoute(rt2), true, "trivial");
+    // Refreshing the lifetime must supersede the expiry queued by AddRoute
+    rt2.SetLifeTime(Seconds(10));
+    NS_TEST_EXPECT_MSG_EQ(rtable.Update(rt2), true, "trivial");
+    // An expired route in search is kept until its state changes
+    RoutingTableEntry rt3(/*output device*/ dev,
+                          /*dst*/ Ipv4Address("5.5.5.5"),
+                          /*validSeqNo*/ false,
+                          /*seqNo*/ 0,
+                          /*interface*/ iface,
+                          /*hop*/ 3,
+                          /*next hop*/ Ipv4Address("1.2.3.4"),
+                          /*lifetime*/ Seconds(1));
+    rt3.SetFlag(IN_SEARCH);
+    NS_TEST_EXPECT_MSG_EQ(rtable.AddRoute(rt3), true, "trivial");
+
+    Simulator::Schedule(Seconds(1.5), &AodvRtableExpiryTest::CheckInvalidated, this);
+    Simulator::Schedule(Seconds(4), &AodvRtableExpiryTest::CheckDeleted, this);
+    Simulator::Run();
+    Simulator::Destroy();
+}
+
+void
+AodvRtableExpiryTest::CheckInvalidated()
+{
+    RoutingTableEntry rt;
+    NS_TEST_EXPECT_MSG_EQ(rtable.LookupRoute(Ipv4Address("1.2.3.4"), rt), true, "Route kept");
+    NS_TEST_EXPECT_MSG_EQ(rt.GetFlag(), INVALID, "Expired route invalidated");
+    NS_TEST_EXPECT_MSG_EQ(rt.GetLifeTime(), Seconds(2), "Deletion after the bad link lifetime");
+    NS_TEST_EXPECT_MSG_EQ(rtable.LookupValidRoute(Ipv4Address("4.3.2.1"), rt),
+                          true,
+                          "Refreshed route still valid");
+    NS_TEST_EXPECT_MSG_EQ(rtable.LookupRoute(Ipv4Address("5.5.5.5"), rt), true, "Route kept");
+    NS_TEST_EXPECT_MSG_EQ(rt.GetFlag(), IN_SEARCH, "Route in search untouched");
+    NS_TEST_EXPECT_MSG_EQ(rtable.SetEntryState(Ipv4Address("5.5.5.5"), VALID), true, "trivial");
+}
+
+void
+AodvRtableExpiryTest::CheckDeleted()
+{
+    RoutingTableEntry rt;
+    NS_TEST_EXPECT_MSG_EQ(rtable.LookupRoute(Ipv4Address("1.2.3.4"), rt),
+                          false,
+                          "Invalid route deleted");
+    NS_TEST_EXPECT_MSG_EQ(rtable.LookupValidRoute(Ipv4Address("4.3.2.1"), rt),
+                          true,
+                          "Refreshed route still valid");
+    // Invalidated on the first purge after SetEntryState, deleted 2 s later
+    NS_TEST_EXPECT_MSG_EQ(rtable.LookupRoute(Ipv4Address("5.5.5.5"), rt), true, "Route kept");
+    NS_TEST_EXPECT_MSG_EQ(rt.GetFlag(), INVALID, "Expired route invalidated");
+}
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for in-place access to the AODV routing table
+ *
+ * Replays the routing table accesses made by RoutingProtocol::Forwarding for one
+ * data packet, once with the copying LookupRoute()/Update() API and once with
+ * FindRoute()/ModifyRoute(), and checks both leave the table in the same state.
+ */
+struct AodvRtableInPlaceTest : public TestCase
+{
+    AodvRtableInPlaceTest()
+        : TestCase("RtableInPlace")
+    {
+    }
+
+    /**
+     * Fill a routing table with routes to the origin, the destination and the
+     * next hops towards both, each with a precursor
+     * @param rtable the routing table
+     */
+    void Fill(RoutingTable& rtable)
+    {
+        const char* dst[] = {"10.0.0.1", "10.0.0.2", "10.0.0.3", "10.0.0.4"};
+        const char* nextHop[] = {"10.0.0.3", "10.0.0.4", "10.0.0.3", "10.0.0.4"};
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            RoutingTableEntry rt(/*output device*/ nullptr,
+                                 /*dst*/ Ipv4Address(dst[i]),
+                                 /*validSeqNo*/ true,
+                                 /*seqNo*/ 1,
+                                 /*interface*/ Ipv4InterfaceAddress(),
+                                 /*hop*/ i < 2 ? 2 : 1,
+                                 /*next hop*/ Ipv4Address(nextHop[i]),
+                                 /*lifetime*/ Seconds(1));
+            rt.InsertPrecursor(Ipv4Address("10.0.0.5"));
+            rtable.AddRoute(rt);
+        }
+    }
+
+    /**
+     * Refresh a VALID route the way UpdateRouteLifeTime did before in-place access
+     * @param rtable the routing table
+     * @param addr the destination
+     */
+    void CopyingRefresh(RoutingTable& rtable, Ipv4Address addr)
+    {
+        RoutingTableEntry rt;
+        if (rtable.LookupRoute(addr, rt) && rt.GetFlag() == VALID)
+        {
+            rt.SetRreqCnt(0);
+            rt.SetLifeTime(std::max(Seconds(3), rt.GetLifeTime()));
+            rtable.Update(rt);
+        }
+    }
+
+    /**
+     * Refresh a VALID route in place
+     * @param rtable the routing table
+     * @param addr the destination
+     */
+    void InPlaceRefresh(RoutingTable& rtable, Ipv4Address addr)
+    {
+        rtable.ModifyRoute(addr, [](RoutingTableEntry& rt) {
+            if (rt.GetFlag() != VALID)
+            {
+                return false;
+            }
+            rt.SetRreqCnt(0);
+            rt.SetLifeTime(std::max(Seconds(3), rt.GetLifeTime()));
+            return true;
+        });
+    }
+
+    void DoRun() override
+    {
+        Ipv4Address origin("10.0.0.1");
+        Ipv4Address dst("10.0.0.2");
+
+        RoutingTable copying(Seconds(2));
+        Fill(copying);
+        RoutingTableEntry toDst;
+        NS_TEST_ASSERT_MSG_EQ(copying.LookupRoute(dst, toDst), true, "trivial");
+        CopyingRefresh(copying, origin);
+        CopyingRefresh(copying, dst);
+        CopyingRefresh(copying, toDst.GetNextHop());
+        RoutingTableEntry toOrigin;
+        copying.LookupRoute(origin, toOrigin);
+        CopyingRefresh(copying, toOrigin.GetNextHop());
+
+        RoutingTable inPlace(Seconds(2));
+        Fill(inPlace);
+        const RoutingTableEntry* toDstPtr = inPlace.FindRoute(dst);
+        NS_TEST_ASSERT_MSG_NE(toDstPtr, nullptr, "trivial");
+        Ipv4Address nextHop = toDstPtr->GetNextHop();
+        InPlaceRefresh(inPlace, origin);
+        InPlaceRefresh(inPlace, dst);
+        InPlaceRefresh(inPlace, nextHop);
+        const RoutingTableEntry* toOriginPtr = inPlace.FindRoute(origin);
+        NS_TEST_ASSERT_MSG_NE(toOriginPtr, nullptr, "trivial");
+        InPlaceRefresh(inPlace, toOriginPtr->GetNextHop());
+        // FindRoute() hands out the stored entry, which ModifyRoute() updates in place
+        NS_TEST_EXPECT_MSG_EQ(inPlace.FindRoute(dst), toDstPtr, "Entry not modified in place");
+        NS_TEST_EXPECT_MSG_EQ(toDstPtr->GetLifeTime(), Seconds(3), "Refresh seen through pointer");
+
+        // Both variants leave the same table behind
+        const char* addrs[] = {"10.0.0.1", "10.0.0.2", "10.0.0.3", "10.0.0.4"};
+        for (const char* addr : addrs)
+        {
+            RoutingTableEntry a;
+            RoutingTableEntry b;
+            NS_TEST_ASSERT_MSG_EQ(copying.LookupRoute(Ipv4Address(addr), a), true, "trivial");
+            NS_TEST_ASSERT_MSG_EQ(inPlace.LookupRoute(Ipv4Address(addr), b), true, "trivial");
+            NS_TEST_EXPECT_MSG_EQ(a.GetLifeTime(), Seconds(3), "Lifetime refreshed");
+            NS_TEST_EXPECT_MSG_EQ(b.GetLifeTime(), a.GetLifeTime(), "Lifetime mismatch");
+            NS_TEST_EXPECT_MSG_EQ(b.GetRreqCnt(), a.GetRreqCnt(), "RREQ count mismatch");
+            NS_TEST_EXPECT_MSG_EQ(b.LookupPrecursor(Ipv4Address("10.0.0.5")),
+                                  true,
+                                  "Precursor lost");
+        }
+
+        // ModifyRoute leaves entries alone when the callable declines
+        inPlace.SetEntryState(dst, IN_SEARCH);
+        inPlace.ModifyRoute(dst, [](RoutingTableEntry& rt) {
+            rt.SetRreqCnt(3);
+            return true;
+        });
+        InPlaceRefresh(inPlace, dst);
+        NS_TEST_EXPECT_MSG_EQ(inPlace.FindRoute(dst)->GetRreqCnt(),
+                              3,
+                              "Route in search keeps its RREQ count");
+        NS_TEST_EXPECT_MSG_EQ(inPlace.ModifyRoute(Ipv4Address("10.0.0.9"),
+                                                  [](RoutingTableEntry&) { return true; }),
+                              false,
+                              "No such route");
+        Simulator::Destroy();
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the next hop index of the AODV routing table
+ *
+ * Moves routes between next hops with Update(), ModifyRoute(), DeleteRoute()
+ * and expiry, and checks GetListOfDestinationWithNextHop() after each step.
+ */
+struct AodvRtableNextHopTest : public TestCase
+{
+    AodvRtableNextHopTest()
+        : TestCase("RtableNextHop"),
+          rtable(Seconds(2))
+    {
+    }
+
+    /**
+     * @param nextHop the next hop
+     * @returns the destinations routed through nextHop
+     */
+    std::map<Ipv4Address, uint32_t> Via(Ipv4Address nextHop)
+    {
+        std::map<Ipv4Address, uint32_t> unreachable;
+        rtable.GetListOfDestinationWithNextHop(nextHop, unreachable);
+        return unreachable;
+    }
+
+    void DoRun() override
+    {
+        Ipv4Address a("10.0.0.1");
+        Ipv4Address b("10.0.0.2");
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            RoutingTableEntry rt(/*output device*/ nullptr,
+                                 /*dst*/ Ipv4Address(0x0a000010 + i),
+                                 /*validSeqNo*/ true,
+                                 /*seqNo*/ i,
+                                 /*interface*/ Ipv4InterfaceAddress(),
+                                 /*hop*/ 2,
+                                 /*next hop*/ i < 4 ? a : b,
+                                 /*lifetime*/ Seconds(i < 5 ? 10 : 1));
+            NS_TEST_ASSERT_MSG_EQ(rtable.AddRoute(rt), true, "trivial");
+        }
+        NS_TEST_EXPECT_MSG_EQ(Via(a).size(), 4, "Routes through a");
+        NS_TEST_EXPECT_MSG_EQ(Via(b).size(), 2, "Routes through b");
+        NS_TEST_EXPECT_MSG_EQ(Via(a)[Ipv4Address(0x0a000012)], 2, "Sequence number");
+
+        RoutingTableEntry rt;
+        NS_TEST_ASSERT_MSG_EQ(rtable.LookupRoute(Ipv4Address(0x0a000010), rt), true, "trivial");
+        rt.SetNextHop(b);
+        NS_TEST_ASSERT_MSG_EQ(rtable.Update(rt), true, "trivial");
+        rtable.ModifyRoute(Ipv4Address(0x0a000011), [b](RoutingTableEntry& entry) {
+            entry.SetNextHop(b);
+            return true;
+        });
+        NS_TEST_EXPECT_MSG_EQ(Via(a).size(), 2, "Two routes moved away from a");
+        NS_TEST_EXPECT_MSG_EQ(Via(b).size(), 4, "Two routes moved to b");
+
+        NS_TEST_ASSERT_MSG_EQ(rtable.DeleteRoute(Ipv4Address(0x0a000012)), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(Via(a).size(), 1, "Deleted route unindexed");
+
+        Simulator::Schedule(Seconds(2), &AodvRtableNextHopTest::CheckInvalidated, this);
+        Simulator::Schedule(Seconds(5), &AodvRtableNextHopTest::CheckExpired, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// Check state at 2 s: the route through b with a short lifetime is invalid but kept
+    void CheckInvalidated()
+    {
+        NS_TEST_EXPECT_MSG_EQ(Via(Ipv4Address("10.0.0.2")).size(), 4, "Invalid route indexed");
+        RoutingTableEntry rt;
+        rtable.LookupRoute(Ipv4Address(0x0a000015), rt);
+        NS_TEST_EXPECT_MSG_EQ(rt.GetFlag(), INVALID, "Route invalidated");
+    }
+
+    /// Check state at 5 s: the invalid route is gone after the bad link lifetime
+    void CheckExpired()
+    {
+        std::map<Ipv4Address, uint32_t> viaB = Via(Ipv4Address("10.0.0.2"));
+        NS_TEST_EXPECT_MSG_EQ(viaB.size(), 3, "Expired route unindexed");
+        NS_TEST_EXPECT_MSG_EQ(viaB.count(Ipv4Address(0x0a000015)), 0, "Expired route unindexed");
+        NS_TEST_EXPECT_MSG_EQ(Via(Ipv4Address("10.0.0.3")).size(), 0, "Unknown next hop");
+    }
+
+    /// The routing table
+    RoutingTable rtable;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for batch invalidation of the routes listed in a RERR
+ *
+ * Invalidates the same RERR against tables of 500 and 5000 routes and checks
+ * that exactly the listed VALID routes are invalidated.
+ */
+struct AodvRtableInvalidateTest : public TestCase
+{
+    AodvRtableInvalidateTest()
+        : TestCase("RtableInvalidate")
+    {
+    }
+
+    void DoRun() override
+    {
+        const uint32_t base = Ipv4Address("10.0.0.1").Get();
+        for (uint32_t size : {500, 5000})
+        {
+            RoutingTable rtable(Seconds(2));
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                RoutingTableEntry rt(/*output device*/ nullptr,
+                                     /*dst*/ Ipv4Address(base + i),
+                                     /*validSeqNo*/ true,
+                                     /*seqNo*/ i,
+                                     /*interface*/ Ipv4InterfaceAddress(),
+                                     /*hop*/ 2,
+                                     /*next hop*/ Ipv4Address(base + i % 8),
+                                     /*lifetime*/ Seconds(10));
+                rtable.AddRoute(rt);
+            }
+            // 30 valid routes, 5 invalid ones and 5 unknown destinations
+            std::map<Ipv4Address, uint32_t> unreachable;
+            for (uint32_t i = 0; i < 40; ++i)
+            {
+                Ipv4Address dst(base + (i < 35 ? 100 + i * 7 : size + i));
+                if (i >= 30 && i < 35)
+                {
+                    rtable.SetEntryState(dst, INVALID);
+                }
+                unreachable.insert(std::make_pair(dst, i));
+            }
+            NS_TEST_EXPECT_MSG_EQ(rtable.InvalidateRoutesWithDst(unreachable),
+                                  30,
+                                  "Valid routes invalidated");
+            for (const auto& un : unreachable)
+            {
+                const RoutingTableEntry* rt = rtable.FindRoute(un.first);
+                if (rt)
+                {
+                    NS_TEST_EXPECT_MSG_EQ(rt->GetFlag(), INVALID, "Route invalidated");
+                }
+            }
+            NS_TEST_EXPECT_MSG_EQ(rtable.FindRoute(Ipv4Address(base + 101))->GetFlag(),
+                                  VALID,
+                                  "Other routes untouched");
+        }
+        Simulator::Destroy();
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for lazy lifetime refresh of the AODV routing table
+ *
+ * Refreshes routes with TouchRoute() in one table and with the equivalent
+ * ModifyRoute() in another, and checks that lifetimes, states and expiry
+ * agree at every step.
+ */
+struct AodvRtableTouchTest : public TestCase
+{
+    AodvRtableTouchTest()
+        : TestCase("RtableTouch"),
+          eager(Seconds(2)),
+          lazy(Seconds(2))
+    {
+    }
+
+    void DoRun() override
+    {
+        for (RoutingTable* rtable : {&eager, &lazy})
+        {
+            for (const char* dst : {"10.0.0.1", "10.0.0.2"})
+            {
+                RoutingTableEntry rt(/*output device*/ nullptr,
+                                     /*dst*/ Ipv4Address(dst),
+                                     /*validSeqNo*/ true,
+                                     /*seqNo*/ 1,
+                                     /*interface*/ Ipv4InterfaceAddress(),
+                                     /*hop*/ 1,
+                                     /*next hop*/ Ipv4Address(dst),
+                                     /*lifetime*/ Seconds(1));
+                rtable->AddRoute(rt);
+            }
+        }
+        Simulator::Schedule(MilliSeconds(500), &AodvRtableTouchTest::Refresh, this);
+        Simulator::Schedule(MilliSeconds(1500), &AodvRtableTouchTest::Compare, this);
+        Simulator::Schedule(MilliSeconds(2000), &AodvRtableTouchTest::Refresh, this);
+        Simulator::Schedule(MilliSeconds(2600), &AodvRtableTouchTest::Compare, this);
+        Simulator::Schedule(MilliSeconds(5000), &AodvRtableTouchTest::Compare, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// Refresh the route to 10.0.0.1 in both tables, by 2 s then by 0.5 s
+    void Refresh()
+    {
+        Time lifetime = Simulator::Now() < Seconds(1) ? Seconds(2) : MilliSeconds(500);
+        Ipv4Address dst("10.0.0.1");
+        bool modified = eager.ModifyRoute(dst, [lifetime](RoutingTableEntry& rt) {
+            if (rt.GetFlag() != VALID)
+            {
+                return false;
+            }
+            rt.SetRreqCnt(0);
+            rt.SetLifeTime(std::max(lifetime, rt.GetLifeTime()));
+            return true;
+        });
+        NS_TEST_EXPECT_MSG_EQ(lazy.TouchRoute(dst, lifetime), modified, "Refresh result");
+    }
+
+    /// Check that both tables hold the same routes
+    void Compare()
+    {
+        for (const char* dst : {"10.0.0.1", "10.0.0.2"})
+        {
+            const RoutingTableEntry* a = eager.FindRoute(Ipv4Address(dst));
+            const RoutingTableEntry* b = lazy.FindRoute(Ipv4Address(dst));
+            NS_TEST_ASSERT_MSG_EQ((a == nullptr), (b == nullptr), "Route presence");
+            if (a)
+            {
+                NS_TEST_EXPECT_MSG_EQ(b->GetFlag(), a->GetFlag(), "Route state");
+                NS_TEST_EXPECT_MSG_EQ(b->GetLifeTime(), a->GetLifeTime(), "Route lifetime");
+            }
+        }
+        const RoutingTableEntry* touched = lazy.FindRoute(Ipv4Address("10.0.0.1"));
+        if (Simulator::Now() < Seconds(2))
+        {
+            NS_TEST_EXPECT_MSG_EQ(touched->GetFlag(), VALID, "Touched route kept alive");
+            NS_TEST_EXPECT_MSG_EQ(touched->GetLifeTime(), Seconds(1), "Touched lifetime");
+        }
+        else if (Simulator::Now() < Seconds(3))
+        {
+            NS_TEST_EXPECT_MSG_EQ(touched->GetFlag(), INVALID, "Touched route expired");
+        }
+        else
+        {
+            NS_TEST_EXPECT_MSG_EQ(touched, nullptr, "Touched route deleted");
+        }
+    }
+
+    /// Routes refreshed with ModifyRoute()
+    RoutingTable eager;
+    /// Routes refreshed with TouchRoute()
+    RoutingTable lazy;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Allocation test for routing table entry temporaries
+ *
+ * Replays the routing table accesses made for 10000 forwarded packets,
+ * including the scratch entries filled in by LookupRoute(), and checks that
+ * every packet is sent on the Ipv4Route built for the destination on its
+ * first use rather than on a new one. In the compact layout, where the
+ * route of the first use is still held, a new one is built per forwarded
+ * packet instead; one that is no longer held is reused.
+ */
+struct AodvRtableAllocationTest : public TestCase
+{
+    AodvRtableAllocationTest()
+        : TestCase("RtableAllocation")
+    {
+    }
+
+    /**
+     * Forward packets through a routing table
+     * @param compact whether to use the compact layout
+     */
+    void Forward(bool compact)
+    {
+        Ipv4Address origin("10.0.0.1");
+        Ipv4Address dst("10.0.0.2");
+        Ipv4Address prevHop("10.0.0.3");
+        Ipv4Address nextHop("10.0.0.4");
+        RoutingTable rtable(Seconds(2));
+        rtable.SetCompact(compact);
+        const Ipv4Address dsts[] = {origin, dst, prevHop, nextHop};
+        const Ipv4Address nextHops[] = {prevHop, nextHop, prevHop, nextHop};
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            RoutingTableEntry rt(/*output device*/ nullptr,
+                                 /*dst*/ dsts[i],
+                                 /*validSeqNo*/ true,
+                                 /*seqNo*/ 1,
+                                 /*interface*/ Ipv4InterfaceAddress(),
+                                 /*hop*/ i < 2 ? 2 : 1,
+                                 /*next hop*/ nextHops[i],
+                                 /*lifetime*/ Seconds(10));
+            rtable.AddRoute(rt);
+        }
+        // The route of an entry is built on its first use
+        Ptr<Ipv4Route> first = rtable.FindRoute(dst)->GetRoute();
+
+        uint32_t forwarded = 0;
+        uint32_t shared = 0;
+        for (uint32_t packet = 0; packet < 10000; ++packet)
+        {
+            // DeferredRouteOutput and UpdateRouteToNeighbor
+            RoutingTableEntry rt;
+            if (!rtable.LookupRoute(dst, rt) || rt.GetFlag() != VALID)
+            {
+                continue;
+            }
+            // Forwarding
+            const RoutingTableEntry* toDst = rtable.FindRoute(dst);
+            Ptr<Ipv4Route> route = toDst->GetRoute();
+            NS_TEST_EXPECT_MSG_EQ(route->GetGateway(), nextHop, "Route to the next hop");
+            shared += (route == first);
+            rtable.TouchRoute(origin, Seconds(3));
+            rtable.TouchRoute(dst, Seconds(3));
+            rtable.TouchRoute(route->GetGateway(), Seconds(3));
+            const RoutingTableEntry* toOrigin = rtable.FindRoute(origin);
+            rtable.TouchRoute(toOrigin->GetNextHop(), Seconds(3));
+            ++forwarded;
+        }
+        NS_TEST_EXPECT_MSG_EQ(forwarded, 10000, "All packets forwarded");
+        NS_TEST_EXPECT_MSG_EQ(shared,
+                              compact ? 0 : forwarded,
+                              "Packets sent on the route built on first use");
+    }
+
+    void DoRun() override
+    {
+        Forward(/*compact*/ false);
+        Forward(/*compact*/ true);
+
+        // A compact lookup reuses the route of the previous one unless it is held
+        RoutingTable rtable(Seconds(2));
+        rtable.SetCompact(true);
+        for (uint8_t i = 1; i <= 2; ++i)
+        {
+            Ipv4Address dst(0x0a000000 | i);
+            RoutingTableEntry rt(/*output device*/ nullptr,
+                                 /*dst*/ dst,
+                                 /*validSeqNo*/ true,
+                                 /*seqNo*/ 1,
+                                 /*interface*/ Ipv4InterfaceAddress(),
+                                 /*hop*/ 1,
+                                 /*next hop*/ dst,
+                                 /*lifetime*/ Seconds(10));
+            rtable.AddRoute(rt);
+        }
+        Ipv4Route* released = PeekPointer(rtable.FindRoute("10.0.0.1")->GetRoute());
+        Ptr<Ipv4Route> held = rtable.FindRoute("10.0.0.2")->GetRoute();
+        NS_TEST_EXPECT_MSG_EQ((PeekPointer(held) == released), true, "Released route reused");
+        NS_TEST_EXPECT_MSG_NE(rtable.FindRoute("10.0.0.1")->GetRoute(), held, "Held route kept");
+        NS_TEST_EXPECT_MSG_EQ(held->GetDestination(), Ipv4Address("10.0.0.2"), "Held route");
+
+        // A scratch entry gets a route with the default fields once needed
+        RoutingTableEntry scratch;
+        NS_TEST_EXPECT_MSG_EQ(scratch.GetNextHop(), Ipv4Address(), "Default next hop");
+        Ptr<Ipv4Route> route = scratch.GetRoute();
+        NS_TEST_EXPECT_MSG_EQ(route->GetDestination(), Ipv4Address(), "Default destination");
+        NS_TEST_EXPECT_MSG_EQ(scratch.GetRoute(), route, "Route kept");
+        scratch.SetNextHop(Ipv4Address("10.0.0.4"));
+        NS_TEST_EXPECT_MSG_EQ(route->GetGateway(), Ipv4Address("10.0.0.4"), "Route updated");
+        Simulator::Destroy();
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the RREP-ACK wait list and blacklist
+ */
+struct BlacklistTest : public TestCase
+{
+    BlacklistTest()
+        : TestCase("Blacklist")
+    {
+    }
+
+    void DoRun() override
+    {
+        blacklist.ExpectAck(Ipv4Address("1.1.1.1"), Seconds(1), Seconds(3));
+        blacklist.ExpectAck(Ipv4Address("2.2.2.2"), Seconds(1), Seconds(3));
+        Simulator::Schedule(MilliSeconds(500), &BlacklistTest::CheckAck, this);
+        Simulator::Schedule(MilliSeconds(1500), &BlacklistTest::CheckBlacklisted, this);
+        Simulator::Schedule(MilliSeconds(3500), &BlacklistTest::CheckBlacklisted, this);
+        Simulator::Schedule(MilliSeconds(4500), &BlacklistTest::CheckExpired, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// Check at 0.5 s: 2.2.2.2 acknowledges in time
+    void CheckAck()
+    {
+        NS_TEST_EXPECT_MSG_EQ(blacklist.AckReceived(Ipv4Address("2.2.2.2")), true, "ACK pending");
+        NS_TEST_EXPECT_MSG_EQ(blacklist.AckReceived(Ipv4Address("2.2.2.2")), false, "ACK received");
+        NS_TEST_EXPECT_MSG_EQ(blacklist.AckReceived(Ipv4Address("3.3.3.3")), false, "No ACK pending");
+        NS_TEST_EXPECT_MSG_EQ(blacklist.IsBlacklisted(Ipv4Address("1.1.1.1")), false, "Still waiting");
+    }
+
+    /// Check at 1.5 s and 3.5 s: 1.1.1.1 missed its ACK and is blacklisted until 4 s
+    void CheckBlacklisted()
+    {
+        NS_TEST_EXPECT_MSG_EQ(blacklist.IsBlacklisted(Ipv4Address("1.1.1.1")), true, "No ACK");
+        NS_TEST_EXPECT_MSG_EQ(blacklist.IsBlacklisted(Ipv4Address("2.2.2.2")), false, "ACK in time");
+        NS_TEST_EXPECT_MSG_EQ(blacklist.AckReceived(Ipv4Address("1.1.1.1")),
+                              false,
+                              "Late ACK does not lift the blacklisting");
+    }
+
+    /// Check at 4.5 s: the blacklisting has expired
+    void CheckExpired()
+    {
+        NS_TEST_EXPECT_MSG_EQ(blacklist.IsBlacklisted(Ipv4Address("1.1.1.1")), false, "Expired");
+    }
+
+    /// The blacklist under test
+    Blacklist blacklist;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for precursor sets
+ *
+ * Inserts precursors out of address order and checks that they are kept
+ * sorted, that copies do not share storage and that the precursors of
+ * several entries merge without duplicates.
+ */
+struct PrecursorSetTest : public TestCase
+{
+    PrecursorSetTest()
+        : TestCase("PrecursorSet")
+    {
+    }
+
+    void DoRun() override
+    {
+        const uint32_t base = Ipv4Address("10.1.0.1").Get();
+        RoutingTableEntry a(/*output device*/ nullptr, /*dst*/ Ipv4Address("10.2.0.1"));
+        RoutingTableEntry b(/*output device*/ nullptr, /*dst*/ Ipv4Address("10.2.0.2"));
+        for (uint32_t i = 20; i-- > 0;)
+        {
+            RoutingTableEntry& rt = (i % 2) ? a : b;
+            NS_TEST_EXPECT_MSG_EQ(rt.InsertPrecursor(Ipv4Address(base + i)), true, "New precursor");
+            NS_TEST_EXPECT_MSG_EQ(rt.InsertPrecursor(Ipv4Address(base + i)), false, "Duplicate");
+        }
+        // One precursor shared by both entries
+        NS_TEST_EXPECT_MSG_EQ(b.InsertPrecursor(Ipv4Address(base + 19)), true, "Shared precursor");
+        NS_TEST_EXPECT_MSG_EQ(a.LookupPrecursor(Ipv4Address(base + 19)), true, "Odd precursor");
+        NS_TEST_EXPECT_MSG_EQ(a.LookupPrecursor(Ipv4Address(base + 18)), false, "Even precursor");
+        NS_TEST_EXPECT_MSG_EQ(a.LookupPrecursor(Ipv4Address("10.3.0.1")), false, "Unknown address");
+        NS_TEST_EXPECT_MSG_EQ(std::is_sorted(a.GetPrecursorSet().begin(), a.GetPrecursorSet().end()),
+                              true,
+                              "Precursors in address order");
+
+        // Copies do not share storage
+        RoutingTableEntry c = a;
+        NS_TEST_EXPECT_MSG_EQ(c.DeletePrecursor(Ipv4Address(base + 19)), true, "Deleted in copy");
+        NS_TEST_EXPECT_MSG_EQ(c.DeletePrecursor(Ipv4Address(base + 19)), false, "Already deleted");
+        NS_TEST_EXPECT_MSG_EQ(a.LookupPrecursor(Ipv4Address(base + 19)), true, "Kept in original");
+
+        std::vector<Ipv4Address> all;
+        a.MergePrecursors(all);
+        b.MergePrecursors(all);
+        a.MergePrecursors(all);
+        NS_TEST_EXPECT_MSG_EQ(all.size(), 20, "Union of both precursor sets");
+        NS_TEST_EXPECT_MSG_EQ(std::is_sorted(all.begin(), all.end()), true, "Union in address order");
+
+        std::vector<Ipv4Address> prec;
+        a.GetPrecursors(prec);
+        b.GetPrecursors(prec);
+        a.GetPrecursors(prec);
+        NS_TEST_EXPECT_MSG_EQ(prec.size(), 20, "No duplicate addresses");
+
+        a.DeleteAllPrecursors();
+        NS_TEST_EXPECT_MSG_EQ(a.IsPrecursorListEmpty(), true, "Cleared");
+        NS_TEST_EXPECT_MSG_EQ(c.IsPrecursorListEmpty(), false, "Copy not cleared");
+        Simulator::Destroy();
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the address index
+ */
+struct AddressIndexTest : public TestCase
+{
+    AddressIndexTest()
+        : TestCase("AddressIndex")
+    {
+    }
+
+    void DoRun() override
+    {
+        AddressIndex index;
+        NS_TEST_EXPECT_MSG_EQ(index.FindId(Ipv4Address("1.1.1.1")), AddressIndex::NONE, "Empty");
+        const char* addrs[] = {"1.1.1.1", "2.2.2.2", "3.3.3.3", "4.4.4.4"};
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            NS_TEST_EXPECT_MSG_EQ(index.GetId(Ipv4Address(addrs[i])), i, "Dense ids");
+        }
+        NS_TEST_EXPECT_MSG_EQ(index.GetId(Ipv4Address("2.2.2.2")), 1, "Id kept");
+        NS_TEST_EXPECT_MSG_EQ(index.GetSize(), 4, "No new id for a known address");
+        NS_TEST_EXPECT_MSG_EQ(index.FindId(Ipv4Address("4.4.4.4")), 3, "Find");
+        NS_TEST_EXPECT_MSG_EQ(index.FindId(Ipv4Address("5.5.5.5")), AddressIndex::NONE, "Unknown");
+        NS_TEST_EXPECT_MSG_EQ(index.GetSize(), 4, "FindId assigns no id");
+        NS_TEST_EXPECT_MSG_EQ(index.GetAddress(1), Ipv4Address("2.2.2.2"), "Reverse table");
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the compact routing table layout
+ *
+ * Applies the same pseudo-random sequence of operations to a table in each
+ * layout and checks that all entries agree after every step, then lets the
+ * entries expire. Lifetimes are whole milliseconds, so the rounding of the
+ * compact layout does not show.
+ */
+struct AodvRtableCompactTest : public TestCase
+{
+    AodvRtableCompactTest()
+        : TestCase("RtableCompact"),
+          full(Seconds(2)),
+          compact(Seconds(2)),
+          state(1)
+    {
+    }
+
+    void DoRun() override
+    {
+        compact.SetCompact(true);
+        for (uint32_t step = 0; step < 400; ++step)
+        {
+            Simulator::Schedule(MilliSeconds(100 * step), &AodvRtableCompactTest::Step, this);
+        }
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// @returns the next pseudo-random number
+    uint32_t Random()
+    {
+        state = state * 1103515245 + 12345;
+        return (state >> 16) & 0x7fff;
+    }
+
+    /**
+     * @param n the number of addresses
+     * @returns a pseudo-random address among n
+     */
+    Ipv4Address RandomAddress(uint32_t n)
+    {
+        return Ipv4Address(Ipv4Address("10.0.0.1").Get() + Random() % n);
+    }
+
+    /// Apply a few operations to both tables for 30 s, and compare them
+    void Step()
+    {
+        for (uint32_t op = 0; op < 4 && Simulator::Now() < Seconds(30); ++op)
+        {
+            Ipv4Address dst = RandomAddress(16);
+            Time lifetime = MilliSeconds(100 * (1 + Random() % 40));
+            switch (Random() % 9)
+            {
+            case 0:
+            case 1: {
+                RoutingTableEntry rt(/*output device*/ nullptr,
+                                     /*dst*/ dst,
+                                     /*validSeqNo*/ Random() % 2,
+                                     /*seqNo*/ Random(),
+                                     /*interface*/ Ipv4InterfaceAddress(),
+                                     /*hop*/ 1 + Random() % 10,
+                                     /*next hop*/ RandomAddress(4),
+                                     /*lifetime*/ lifetime);
+                RoutingTableEntry copy = rt;
+                NS_TEST_EXPECT_MSG_EQ(full.AddRoute(rt), compact.AddRoute(copy), "AddRoute");
+                break;
+            }
+            case 2: {
+                Ipv4Address nextHop = RandomAddress(4);
+                uint32_t seqNo = Random();
+                auto fn = [&](RoutingTableEntry& rt) {
+                    rt.SetNextHop(nextHop);
+                    rt.SetSeqNo(seqNo);
+                    rt.SetLifeTime(lifetime);
+                    rt.IncrementRreqCnt();
+                    rt.SetFlag(rt.GetRreqCnt() % 2 ? IN_SEARCH : VALID);
+                    return true;
+                };
+                NS_TEST_EXPECT_MSG_EQ(full.ModifyRoute(dst, fn), compact.ModifyRoute(dst, fn), "Modify");
+                break;
+            }
+            case 3:
+                NS_TEST_EXPECT_MSG_EQ(full.TouchRoute(dst, lifetime),
+                                      compact.TouchRoute(dst, lifetime),
+                                      "TouchRoute");
+                break;
+            case 4: {
+                std::map<Ipv4Address, uint32_t> unreachable;
+                unreachable[dst] = 0;
+                NS_TEST_EXPECT_MSG_EQ(full.InvalidateRoutesWithDst(unreachable),
+                                      compact.InvalidateRoutesWithDst(unreachable),
+                                      "InvalidateRoutesWithDst");
+                break;
+            }
+            case 5: {
+                Ipv4Address precursor = RandomAddress(8);
+                auto fn = [&](RoutingTableEntry& rt) { return rt.InsertPrecursor(precursor); };
+                NS_TEST_EXPECT_MSG_EQ(full.ModifyRoute(dst, fn), compact.ModifyRoute(dst, fn), "Precursor");
+                break;
+            }
+            case 6:
+                NS_TEST_EXPECT_MSG_EQ(full.SetEntryState(dst, INVALID),
+                                      compact.SetEntryState(dst, INVALID),
+                                      "SetEntryState");
+                break;
+            case 7:
+                NS_TEST_EXPECT_MSG_EQ(full.SetEntryState(dst, VALID),
+                                      compact.SetEntryState(dst, VALID),
+                                      "SetEntryState");
+                break;
+            default:
+                NS_TEST_EXPECT_MSG_EQ(full.DeleteRoute(dst), compact.DeleteRoute(dst), "DeleteRoute");
+            }
+        }
+        Compare();
+    }
+
+    /// Check that both tables hold the same entries
+    void Compare()
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            Ipv4Address dst(Ipv4Address("10.0.0.1").Get() + i);
+            RoutingTableEntry a;
+            RoutingTableEntry b;
+            bool found = full.LookupRoute(dst, a);
+            NS_TEST_ASSERT_MSG_EQ(compact.LookupRoute(dst, b), found, "Same destinations");
+            if (!found)
+            {
+                continue;
+            }
+            NS_TEST_EXPECT_MSG_EQ(b.GetDestination(), dst, "Destination");
+            NS_TEST_EXPECT_MSG_EQ(b.GetNextHop(), a.GetNextHop(), "Next hop");
+            NS_TEST_EXPECT_MSG_EQ(b.GetFlag(), a.GetFlag(), "Flag");
+            NS_TEST_EXPECT_MSG_EQ(b.GetSeqNo(), a.GetSeqNo(), "Sequence number");
+            NS_TEST_EXPECT_MSG_EQ(b.GetValidSeqNo(), a.GetValidSeqNo(), "Valid sequence number");
+            NS_TEST_EXPECT_MSG_EQ(b.GetHop(), a.GetHop(), "Hops");
+            NS_TEST_EXPECT_MSG_EQ(b.GetRreqCnt(), a.GetRreqCnt(), "RREQ count");
+            NS_TEST_EXPECT_MSG_EQ(b.GetLifeTime(), a.GetLifeTime(), "Lifetime");
+            std::vector<Ipv4Address> pa;
+            std::vector<Ipv4Address> pb;
+            a.GetPrecursors(pa);
+            b.GetPrecursors(pb);
+            NS_TEST_EXPECT_MSG_EQ((pa == pb), true, "Precursors");
+        }
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            Ipv4Address nextHop(Ipv4Address("10.0.0.1").Get() + i);
+            std::map<Ipv4Address, uint32_t> ua;
+            std::map<Ipv4Address, uint32_t> ub;
+            full.GetListOfDestinationWithNextHop(nextHop, ua);
+            compact.GetListOfDestinationWithNextHop(nextHop, ub);
+            NS_TEST_EXPECT_MSG_EQ((ua == ub), true, "Destinations by next hop");
+        }
+        NS_TEST_EXPECT_MSG_EQ(compact.GetSize(), full.GetSize(), "Size");
+    }
+
+    /// Table in the default layout
+    RoutingTable full;
+    /// Table in the compact layout
+    RoutingTable compact;
+    /// Pseudo-random generator state
+    uint32_t state;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for RoutingTable::GetRoutes in both layouts
+ */
+struct AodvRtableGetRoutesTest : public TestCase
+{
+    AodvRtableGetRoutesTest()
+        : TestCase("RtableGetRoutes"),
+          full(Seconds(3)),
+          compact(Seconds(3))
+    {
+    }
+
+    void DoRun() override
+    {
+        compact.SetCompact(true);
+        for (RoutingTable* rtable : {&full, &compact})
+        {
+            for (const char* dst : {"10.0.0.3", "10.0.0.1", "10.0.0.2"})
+            {
+                RoutingTableEntry rt(/*output device*/ nullptr,
+                                     /*dst*/ Ipv4Address(dst),
+                                     /*validSeqNo*/ true,
+                                     /*seqNo*/ 7,
+                                     /*interface*/ Ipv4InterfaceAddress(),
+                                     /*hop*/ 2,
+                                     /*next hop*/ Ipv4Address("10.0.0.9"),
+                                     /*lifetime*/ Ipv4Address(dst) == Ipv4Address("10.0.0.2")
+                                         ? Seconds(1)
+                                         : Seconds(10));
+                rtable->AddRoute(rt);
+            }
+        }
+        Simulator::Schedule(Seconds(2), &AodvRtableGetRoutesTest::Check, this, 3);
+        Simulator::Schedule(Seconds(6), &AodvRtableGetRoutesTest::Check, this, 2);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /**
+     * Check the routes returned by both tables, then purge the tables
+     * @param expected the expected number of routes
+     */
+    void Check(uint32_t expected)
+    {
+        for (RoutingTable* rtable : {&full, &compact})
+        {
+            std::vector<RoutingTableEntry> routes;
+            rtable->GetRoutes(routes);
+            NS_TEST_ASSERT_MSG_EQ(routes.size(), expected, "Expired routes are left out");
+            for (uint32_t i = 0; i + 1 < routes.size(); ++i)
+            {
+                NS_TEST_EXPECT_MSG_EQ((routes[i].GetDestination() < routes[i + 1].GetDestination()),
+                                      true,
+                                      "Destination order");
+            }
+            for (const auto& rt : routes)
+            {
+                bool expired = rt.GetDestination() == Ipv4Address("10.0.0.2");
+                NS_TEST_EXPECT_MSG_EQ(rt.GetFlag(), (expired ? INVALID : VALID), "Flag");
+                NS_TEST_EXPECT_MSG_EQ(rt.GetSeqNo(), 7, "Sequence number");
+                NS_TEST_EXPECT_MSG_EQ(rt.GetHop(), 2, "Hops");
+                NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("10.0.0.9"), "Next hop");
+            }
+            rtable->Purge();
+        }
+    }
+
+    /// Table in the default layout
+    RoutingTable full;
+    /// Table in the compact layout
+    RoutingTable compact;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for RoutingTable::Print and RoutingTable::WriteSnapshot
+ */
+struct AodvRtablePrintTest : public TestCase
+{
+    AodvRtablePrintTest()
+        : TestCase("RtablePrint"),
+          full(Seconds(3)),
+          compact(Seconds(3))
+    {
+    }
+
+    void DoRun() override
+    {
+        compact.SetCompact(true);
+        Ipv4InterfaceAddress iface(Ipv4Address("10.0.0.1"), Ipv4Mask("255.0.0.0"));
+        for (RoutingTable* rtable : {&full, &compact})
+        {
+            // Up at the check; expired, so down; expired while invalid, so gone
+            for (uint32_t i = 2; i <= 4; ++i)
+            {
+                RoutingTableEntry rt(/*output device*/ nullptr,
+                                     /*dst*/ Ipv4Address(Ipv4Address("10.0.0.0").Get() + i),
+                                     /*validSeqNo*/ true,
+                                     /*seqNo*/ 10 + i,
+                                     /*interface*/ iface,
+                                     /*hop*/ i - 1,
+                                     /*next hop*/ Ipv4Address("10.0.0.2"),
+                                     /*lifetime*/ i == 2 ? Seconds(5) : MilliSeconds(500));
+                if (i == 4)
+                {
+                    rt.SetFlag(INVALID);
+                }
+                rtable->AddRoute(rt);
+            }
+        }
+        Simulator::Schedule(Seconds(2), &AodvRtablePrintTest::Check, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// Check the printed table and the snapshot records of both tables
+    void Check()
+    {
+        const std::string expected =
+            "\nAODV Routing table\n"
+            "Destination     Gateway         Interface       Flag            Expire          Hops\n"
+            "10.0.0.2        10.0.0.2        10.0.0.1        UP              +3.00s          1\n"
+            "10.0.0.3        10.0.0.2        10.0.0.1        DOWN            +3.00s          2\n"
+            "\n";
+        for (RoutingTable* rtable : {&full, &compact})
+        {
+            std::ostringstream os;
+            rtable->Print(Create<OutputStreamWrapper>(&os));
+            NS_TEST_EXPECT_MSG_EQ(os.str(), expected, "Printed table");
+
+            std::ostringstream snapshot;
+            NS_TEST_ASSERT_MSG_EQ(rtable->WriteSnapshot(snapshot, 7), 2, "Records written");
+            std::string bytes = snapshot.str();
+            NS_TEST_ASSERT_MSG_EQ(bytes.size(), 2 * RouteRecord::SIZE, "Record size");
+            for (uint32_t r = 0; r < 2; ++r)
+            {
+                RouteRecord record;
+                record.Read(reinterpret_cast<const uint8_t*>(bytes.data()) + r * RouteRecord::SIZE);
+                bool up = Ipv4Address(record.dst) == Ipv4Address("10.0.0.2");
+                NS_TEST_EXPECT_MSG_EQ(record.node, 7, "Node");
+                NS_TEST_EXPECT_MSG_EQ(Ipv4Address(record.nextHop), Ipv4Address("10.0.0.2"), "Next hop");
+                NS_TEST_EXPECT_MSG_EQ(Ipv4Address(record.iface), Ipv4Address("10.0.0.1"), "Interface");
+                NS_TEST_EXPECT_MSG_EQ(record.seqNo, (up ? 12 : 13), "Sequence number");
+                NS_TEST_EXPECT_MSG_EQ(record.expire, 3000, "Expire");
+                NS_TEST_EXPECT_MSG_EQ(record.hops, (up ? 1 : 2), "Hops");
+                NS_TEST_EXPECT_MSG_EQ(record.state, (up ? VALID : INVALID) | 0x04, "State");
+            }
+        }
+    }
+
+    /// Table in the default layout
+    RoutingTable full;
+    /// Table in the compact layout
+    RoutingTable compact;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for RouteJournal and the changes RoutingTable records in it
+ */
+struct AodvRtableJournalTest : public TestCase
+{
+    AodvRtableJournalTest()
+        : TestCase("RtableJournal"),
+          full(Seconds(3)),
+          compact(Seconds(3))
+    {
+    }
+
+    void DoRun() override
+    {
+        RouteJournal journal;
+        journal.Record(ROUTE_ADDED, Ipv4Address("10.0.0.1"), Ipv4Address("10.0.0.9"));
+        NS_TEST_EXPECT_MSG_EQ(journal.GetHead(), 0, "Nothing recorded without capacity");
+        journal.SetCapacity(3);
+        for (uint32_t i = 1; i <= 5; ++i)
+        {
+            journal.Record(ROUTE_ADDED, Ipv4Address(0x0a000000 + i), Ipv4Address("10.0.0.9"));
+        }
+        NS_TEST_EXPECT_MSG_EQ(journal.GetHead(), 5, "Head");
+        NS_TEST_EXPECT_MSG_EQ(journal.GetTail(), 2, "Oldest events overwritten");
+        NS_TEST_EXPECT_MSG_EQ(journal.IsLost(1), true, "Cursor behind the tail");
+        NS_TEST_EXPECT_MSG_EQ(journal.IsLost(2), false, "Cursor at the tail");
+        std::vector<Ipv4Address> dsts;
+        uint64_t cursor =
+            journal.Read(0, [&dsts](const RouteEvent& event) { dsts.push_back(event.dst); });
+        NS_TEST_EXPECT_MSG_EQ(cursor, 5, "Read returns the head");
+        NS_TEST_ASSERT_MSG_EQ(dsts.size(), 3, "Events kept");
+        NS_TEST_EXPECT_MSG_EQ(dsts[0], Ipv4Address("10.0.0.3"), "Oldest event kept");
+        NS_TEST_EXPECT_MSG_EQ(dsts[2], Ipv4Address("10.0.0.5"), "Newest event");
+        journal.Clear();
+        NS_TEST_EXPECT_MSG_EQ(journal.IsLost(cursor), true, "Clear loses every cursor");
+        journal.Record(ROUTE_DELETED, Ipv4Address("10.0.0.6"), Ipv4Address("10.0.0.9"));
+        dsts.clear();
+        journal.Read(journal.GetTail(),
+                     [&dsts](const RouteEvent& event) { dsts.push_back(event.dst); });
+        NS_TEST_ASSERT_MSG_EQ(dsts.size(), 1, "Events after Clear");
+        NS_TEST_EXPECT_MSG_EQ(dsts[0], Ipv4Address("10.0.0.6"), "Event after Clear");
+
+        compact.SetCompact(true);
+        for (RoutingTable* rtable : {&full, &compact})
+        {
+            rtable->GetJournal().SetCapacity(16);
+            for (const char* dst : {"10.0.0.1", "10.0.0.2"})
+            {
+                RoutingTableEntry rt(/*output device*/ nullptr,
+                                     /*dst*/ Ipv4Address(dst),
+                                     /*validSeqNo*/ true,
+                                     /*seqNo*/ 7,
+                                     /*interface*/ Ipv4InterfaceAddress(),
+                                     /*hop*/ 2,
+                                     /*next hop*/ Ipv4Address("10.0.0.9"),
+                                     /*lifetime*/ Ipv4Address(dst) == Ipv4Address("10.0.0.1")
+                                         ? Seconds(1)
+                                         : Seconds(10));
+                rtable->AddRoute(rt);
+            }
+            RoutingTableEntry rt(/*output device*/ nullptr,
+                                 /*dst*/ Ipv4Address("10.0.0.2"),
+                                 /*validSeqNo*/ true,
+                                 /*seqNo*/ 7,
+                                 /*interface*/ Ipv4InterfaceAddress(),
+                                 /*hop*/ 2,
+                                 /*next hop*/ Ipv4Address("10.0.0.8"),
+                                 /*lifetime*/ Seconds(10));
+            rtable->Update(rt);
+            rtable->ModifyRoute(Ipv4Address("10.0.0.2"), [](RoutingTableEntry& entry) {
+                entry.SetHop(3);
+                return true;
+            });
+            rtable->TouchRoute(Ipv4Address("10.0.0.2"), Seconds(20));
+            std::map<Ipv4Address, uint32_t> unreachable;
+            unreachable[Ipv4Address("10.0.0.2")] = 8;
+            rtable->InvalidateRoutesWithDst(unreachable);
+            rtable->DeleteRoute(Ipv4Address("10.0.0.2"));
+        }
+        Simulator::Schedule(Seconds(2), &AodvRtableJournalTest::Check, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// Purge the tables and check their journals
+    void Check()
+    {
+        const RouteEventType expected[] = {ROUTE_ADDED,
+                                           ROUTE_ADDED,
+                                           ROUTE_NEXT_HOP_CHANGED,
+                                           ROUTE_UPDATED,
+                                           ROUTE_INVALIDATED,
+                                           ROUTE_DELETED,
+                                           ROUTE_EXPIRED};
+        for (RoutingTable* rtable : {&full, &compact})
+        {
+            rtable->Purge();
+            std::vector<RouteEvent> events;
+            rtable->GetJournal().Read(0, [&events](const RouteEvent& event) {
+                events.push_back(event);
+            });
+            NS_TEST_ASSERT_MSG_EQ(events.size(), 7, "One event per change");
+            for (uint32_t i = 0; i < events.size(); ++i)
+            {
+                NS_TEST_EXPECT_MSG_EQ(events[i].type, expected[i], "Event type");
+            }
+            NS_TEST_EXPECT_MSG_EQ(events[2].nextHop, Ipv4Address("10.0.0.8"), "New next hop");
+            NS_TEST_EXPECT_MSG_EQ(events[5].dst, Ipv4Address("10.0.0.2"), "Deleted route");
+            NS_TEST_EXPECT_MSG_EQ(events[6].dst, Ipv4Address("10.0.0.1"), "Expired route");
+            NS_TEST_EXPECT_MSG_EQ(events[6].time, Seconds(2), "Time of expiry");
+            rtable->Clear();
+            NS_TEST_EXPECT_MSG_EQ(rtable->GetJournal().IsLost(events.size()),
+                                  true,
+                                  "Clearing the table loses every cursor");
+        }
+    }
+
+    /// Table in the default layout
+    RoutingTable full;
+    /// Table in the compact layout
+    RoutingTable compact;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the path order of MultipathRouteEntry
+ */
+struct MultipathRouteEntryTest : public TestCase
+{
+    MultipathRouteEntryTest()
+        : TestCase("MultipathRouteEntry"),
+          entry(Ipv4Address("10.0.0.1"))
+    {
+    }
+
+    void DoRun() override
+    {
+        entry.AddPath(Ipv4Address("10.0.0.2"), 3, Seconds(10), 7);
+        entry.AddPath(Ipv4Address("10.0.0.3"), 1, Seconds(5), 7);
+        entry.AddPath(Ipv4Address("10.0.0.4"), 2, Seconds(20), 7);
+        NS_TEST_EXPECT_MSG_EQ(entry.GetNextExpiry(), Seconds(5), "Earliest expiry");
+        // With equal metrics the hop count decides
+        CheckOrder("10.0.0.3", "10.0.0.4", "10.0.0.2");
+
+        BLEMetrics weak;
+        weak.residualEnergy = 0.1;
+        weak.rssiValue = -100;
+        weak.stabilityScore = 0.1;
+        NS_TEST_EXPECT_MSG_EQ(entry.UpdatePathMetrics(Ipv4Address("10.0.0.3"), weak),
+                              true,
+                              "Metrics of an existing path");
+        NS_TEST_EXPECT_MSG_EQ(entry.UpdatePathMetrics(Ipv4Address("10.0.0.9"), weak),
+                              false,
+                              "Metrics of a missing path");
+        CheckOrder("10.0.0.4", "10.0.0.2", "10.0.0.3");
+
+        WeightFactors hopsOnly;
+        hopsOnly.hopWeight = 1;
+        hopsOnly.energyWeight = 0;
+        hopsOnly.rssiWeight = 0;
+        hopsOnly.stabilityWeight = 0;
+        entry.SetWeights(hopsOnly);
+        CheckOrder("10.0.0.3", "10.0.0.4", "10.0.0.2");
+        NS_TEST_EXPECT_MSG_EQ_TOL(entry.GetBestPath().compositeScore, 0.5, 1e-9, "Rescored");
+
+        Simulator::Schedule(Seconds(6), &MultipathRouteEntryTest::CheckExpiry, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /**
+     * Check the order of the three paths
+     * @param first the next hop of the best path
+     * @param second the next hop of the second path
+     * @param third the next hop of the worst path
+     */
+    void CheckOrder(const char* first, const char* second, const char* third)
+    {
+        std::vector<MultipathRouteEntry::PathInfo> paths = entry.GetAllPaths();
+        NS_TEST_ASSERT_MSG_EQ(paths.size(), 3, "Paths");
+        NS_TEST_EXPECT_MSG_EQ(paths[0].nextHop, Ipv4Address(first), "Best path");
+        NS_TEST_EXPECT_MSG_EQ(paths[1].nextHop, Ipv4Address(second), "Second path");
+        NS_TEST_EXPECT_MSG_EQ(paths[2].nextHop, Ipv4Address(third), "Worst path");
+        NS_TEST_EXPECT_MSG_EQ(entry.GetBestPath().nextHop, Ipv4Address(first), "GetBestPath");
+    }
+
+    /// Check the paths after the first one expired
+    void CheckExpiry()
+    {
+        NS_TEST_EXPECT_MSG_EQ(entry.GetBestPath().nextHop, Ipv4Address("10.0.0.4"), "Expired");
+        NS_TEST_EXPECT_MSG_EQ(entry.GetNextExpiry(), Seconds(10), "Next expiry");
+        entry.RemovePath(Ipv4Address("10.0.0.2"));
+        NS_TEST_EXPECT_MSG_EQ(entry.GetNextExpiry(), Seconds(20), "Expiry after removal");
+        entry.RemovePath(Ipv4Address("10.0.0.4"));
+        NS_TEST_EXPECT_MSG_EQ(entry.HasValidPath(), false, "No paths left");
+        NS_TEST_EXPECT_MSG_EQ(entry.GetBestPath().isValid, false, "Invalid best path");
+        NS_TEST_EXPECT_MSG_EQ(entry.GetNextExpiry(), Time::Max(), "No expiry");
+    }
+
+    /// The entry under test
+    MultipathRouteEntry entry;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for MultipathRouteEntry::SelectNextHop
+ */
+struct MultipathSelectionTest : public TestCase
+{
+    MultipathSelectionTest()
+        : TestCase("MultipathSelection")
+    {
+    }
+
+    void DoRun() override
+    {
+        MultipathRouteEntry entry(Ipv4Address("10.0.0.1"));
+        WeightFactors hopsOnly;
+        hopsOnly.hopWeight = 1;
+        hopsOnly.energyWeight = 0;
+        hopsOnly.rssiWeight = 0;
+        hopsOnly.stabilityWeight = 0;
+        entry.SetWeights(hopsOnly);
+        // Scores 0.5 and 0.25: two packets in three go through 10.0.0.2
+        entry.AddPath(Ipv4Address("10.0.0.2"), 1, Seconds(10), 7);
+        entry.AddPath(Ipv4Address("10.0.0.3"), 3, Seconds(10), 7);
+
+        uint32_t first = 0;
+        Ipv4Address last;
+        bool alternated = true;
+        for (uint32_t i = 0; i < 300; ++i)
+        {
+            Ipv4Address nextHop = entry.SelectNextHop(WEIGHTED_ROUND_ROBIN, 0, Ipv4Address(), 7, 3);
+            first += nextHop == Ipv4Address("10.0.0.2");
+            // The lighter path never gets two packets in a row
+            alternated &= !(nextHop == Ipv4Address("10.0.0.3") && last == nextHop);
+            last = nextHop;
+        }
+        NS_TEST_EXPECT_MSG_EQ(first, 200, "Round robin shares");
+        NS_TEST_EXPECT_MSG_EQ(alternated, true, "Round robin interleaves the paths");
+
+        first = 0;
+        for (uint32_t i = 0; i < 300; ++i)
+        {
+            uint32_t hash = static_cast<uint32_t>((uint64_t(2 * i + 1) << 31) / 300);
+            Ipv4Address nextHop = entry.SelectNextHop(FLOW_HASH, hash, Ipv4Address(), 7, 3);
+            first += nextHop == Ipv4Address("10.0.0.2");
+            NS_TEST_EXPECT_MSG_EQ(entry.SelectNextHop(FLOW_HASH, hash, Ipv4Address(), 7, 3),
+                                  nextHop,
+                                  "A flow sticks to its path");
+        }
+        NS_TEST_EXPECT_MSG_EQ(first, 200, "Flow hash shares");
+
+        for (MultipathSelection mode : {WEIGHTED_ROUND_ROBIN, FLOW_HASH})
+        {
+            NS_TEST_EXPECT_MSG_EQ(entry.SelectNextHop(mode, 0, Ipv4Address("10.0.0.2"), 7, 3),
+                                  Ipv4Address("10.0.0.3"),
+                                  "Excluded next hop");
+            // Only paths as fresh and as short as the route in use are picked
+            NS_TEST_EXPECT_MSG_EQ(entry.SelectNextHop(mode, 0, Ipv4Address("10.0.0.2"), 7, 2),
+                                  Ipv4Address(),
+                                  "Path longer than the route");
+            NS_TEST_EXPECT_MSG_EQ(entry.SelectNextHop(mode, 0, Ipv4Address("10.0.0.2"), 8, 3),
+                                  Ipv4Address(),
+                                  "Path older than the route");
+        }
+        entry.AddPath(Ipv4Address("10.0.0.4"), 1, Seconds(10), 6);
+        for (uint32_t i = 0; i < 10; ++i)
+        {
+            NS_TEST_EXPECT_MSG_NE(entry.SelectNextHop(WEIGHTED_ROUND_ROBIN, 0, Ipv4Address(), 7, 3),
+                                  Ipv4Address("10.0.0.4"),
+                                  "Stale path never picked");
+        }
+        entry.RemovePath(Ipv4Address("10.0.0.3"));
+        NS_TEST_EXPECT_MSG_EQ(
+            entry.SelectNextHop(WEIGHTED_ROUND_ROBIN, 0, Ipv4Address("10.0.0.2"), 7, 3),
+            Ipv4Address(),
+            "No path left to pick");
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for FlowTable
+ */
+struct FlowTableTest : public TestCase
+{
+    FlowTableTest()
+        : TestCase("FlowTable")
+    {
+    }
+
+    void DoRun() override
+    {
+        table.SetCapacity(5);
+        NS_TEST_EXPECT_MSG_EQ(table.GetCapacity(), 8, "Capacity rounded up to whole sets");
+        // A single set, so that every flow competes for the same four slots
+        table.SetCapacity(4);
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(1, dst), Ipv4Address(), "Unknown flow");
+        NS_TEST_EXPECT_MSG_EQ(table.GetCapacity(), 4, "Capacity kept before the first flow");
+        table.Pin(1, dst, Ipv4Address("10.0.0.2"));
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(1, dst), Ipv4Address("10.0.0.2"), "Pinned flow");
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(1, Ipv4Address("10.0.0.9")),
+                              Ipv4Address(),
+                              "Same hash, other destination");
+        table.Pin(1, dst, Ipv4Address("10.0.0.3"));
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(1, dst), Ipv4Address("10.0.0.3"), "Repinned flow");
+        NS_TEST_EXPECT_MSG_EQ(table.GetRepins(), 1, "Repin counted");
+        for (uint32_t hash = 2; hash <= 4; ++hash)
+        {
+            table.Pin(hash, dst, Ipv4Address("10.0.0.2"));
+        }
+        NS_TEST_EXPECT_MSG_EQ(table.GetPins(), 4, "Flows pinned");
+
+        Simulator::Schedule(Seconds(1), &FlowTableTest::CheckEviction, this);
+        Simulator::Schedule(Seconds(12), &FlowTableTest::CheckAging, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// Evict the least recently used flow of a full set
+    void CheckEviction()
+    {
+        table.Lookup(1, dst);
+        table.Lookup(3, dst);
+        table.Lookup(4, dst);
+        table.Pin(5, dst, Ipv4Address("10.0.0.3"));
+        NS_TEST_EXPECT_MSG_EQ(table.GetEvictions(), 1, "Active flow evicted");
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(2, dst), Ipv4Address(), "Least recent flow evicted");
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(5, dst), Ipv4Address("10.0.0.3"), "New flow pinned");
+    }
+
+    /// Forget the flows idle for the idle timeout
+    void CheckAging()
+    {
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(1, dst), Ipv4Address(), "Idle flow forgotten");
+        table.Pin(6, dst, Ipv4Address("10.0.0.2"));
+        table.Pin(7, dst, Ipv4Address("10.0.0.2"));
+        NS_TEST_EXPECT_MSG_EQ(table.GetEvictions(), 1, "Idle flows replaced without eviction");
+        table.Clear();
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(6, dst), Ipv4Address(), "Table cleared");
+        table.SetCapacity(0);
+        table.Pin(6, dst, Ipv4Address("10.0.0.2"));
+        NS_TEST_EXPECT_MSG_EQ(table.Lookup(6, dst), Ipv4Address(), "No flow kept without capacity");
+    }
+
+    /// The table under test
+    FlowTable table;
+    /// Destination of the flows
+    Ipv4Address dst{"10.0.0.1"};
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for RoutingTable::PromoteMultipathRoute
+ */
+struct MultipathFailoverTest : public TestCase
+{
+    MultipathFailoverTest()
+        : TestCase("MultipathFailover")
+    {
+    }
+
+    void DoRun() override
+    {
+        const Ipv4Address dst("10.0.0.1");
+        const Ipv4Address first("10.0.0.2");
+        const Ipv4Address second("10.0.0.3");
+        const Ipv4Address stranger("10.0.0.4");
+        const Ipv4Address stale("10.0.0.5");
+        const Ipv4Address longer("10.0.0.6");
+        for (bool compact : {false, true})
+        {
+            RoutingTable rtable(Seconds(3));
+            rtable.SetCompact(compact);
+            rtable.GetJournal().SetCapacity(16);
+            for (Ipv4Address neighbor : {first, second, stale, longer})
+            {
+                RoutingTableEntry toNeighbor(/*output device*/ nullptr,
+                                             /*dst*/ neighbor,
+                                             /*validSeqNo*/ true,
+                                             /*seqNo*/ 1,
+                                             /*interface*/ Ipv4InterfaceAddress(),
+                                             /*hop*/ 1,
+                                             /*next hop*/ neighbor,
+                                             /*lifetime*/ Seconds(10));
+                rtable.AddRoute(toNeighbor);
+            }
+            RoutingTableEntry toDst(/*output device*/ nullptr,
+                                    /*dst*/ dst,
+                                    /*validSeqNo*/ true,
+                                    /*seqNo*/ 7,
+                                    /*interface*/ Ipv4InterfaceAddress(),
+                                    /*hop*/ 4,
+                                    /*next hop*/ first,
+                                    /*lifetime*/ Seconds(5));
+            rtable.AddRoute(toDst);
+            rtable.AddMultipathRoute(dst, first, 2, Seconds(10), 7);
+            rtable.AddMultipathRoute(dst, second, 4, Seconds(20), 7);
+            // Best scored, but its next hop is not a neighbor
+            rtable.AddMultipathRoute(dst, stranger, 1, Seconds(10), 7);
+            // Reachable, but older or longer than the route, so they could loop
+            rtable.AddMultipathRoute(dst, stale, 1, Seconds(10), 6);
+            rtable.AddMultipathRoute(dst, longer, 5, Seconds(10), 7);
+            uint64_t cursor = rtable.GetJournal().GetHead();
+
+            NS_TEST_EXPECT_MSG_EQ(rtable.PromoteMultipathRoute(dst, first),
+                                  true,
+                                  "Route moved to another path");
+            const RoutingTableEntry* rt = rtable.FindRoute(dst);
+            NS_TEST_ASSERT_MSG_NE(rt, nullptr, "Route kept");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetFlag(), VALID, "Route still valid");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetNextHop(), second, "Reachable path promoted");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetHop(), 4, "Hop count of the path");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetSeqNo(), 7, "Sequence number kept");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetLifeTime(), Seconds(20), "Lifetime of the path");
+            NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst, first),
+                                  false,
+                                  "Broken path dropped");
+            NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst, stale),
+                                  false,
+                                  "Older path dropped");
+            NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst, longer),
+                                  false,
+                                  "Longer path dropped");
+            std::map<Ipv4Address, uint32_t> unreachable;
+            rtable.GetListOfDestinationWithNextHop(second, unreachable);
+            NS_TEST_EXPECT_MSG_EQ(unreachable.count(dst), 1, "Next hop index updated");
+            std::vector<RouteEventType> events;
+            rtable.GetJournal().Read(cursor, [&events](const RouteEvent& event) {
+                events.push_back(event.type);
+            });
+            NS_TEST_ASSERT_MSG_EQ(events.size(), 1, "One change recorded");
+            NS_TEST_EXPECT_MSG_EQ(events[0], ROUTE_NEXT_HOP_CHANGED, "Next hop change recorded");
+
+            NS_TEST_EXPECT_MSG_EQ(rtable.PromoteMultipathRoute(dst, first),
+                                  false,
+                                  "Route no longer through the broken next hop");
+            NS_TEST_EXPECT_MSG_EQ(rtable.PromoteMultipathRoute(dst, second),
+                                  false,
+                                  "No reachable path left");
+            NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst, second),
+                                  false,
+                                  "Broken path dropped without promotion");
+            rtable.RemoveMultipathRoute(dst, stranger);
+            NS_TEST_EXPECT_MSG_EQ(rtable.PromoteMultipathRoute(dst, second),
+                                  false,
+                                  "No multipath route");
+        }
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for link-disjoint multipath routes
+ */
+struct DisjointPathTest : public TestCase
+{
+    DisjointPathTest()
+        : TestCase("DisjointPath")
+    {
+    }
+
+    void DoRun() override
+    {
+        MultipathRouteEntry entry(Ipv4Address("10.0.0.1"));
+        const Ipv4Address a("10.0.0.2");
+        const Ipv4Address b("10.0.0.3");
+        const Ipv4Address c("10.0.0.4");
+        const Ipv4Address d("10.0.0.5");
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(a, c, 3, Seconds(10), 5), true, "First path");
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(a, d, 3, Seconds(10), 5),
+                              false,
+                              "Same next hop");
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(b, c, 3, Seconds(10), 5),
+                              false,
+                              "Same first hop");
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(b, d, 5, Seconds(10), 5),
+                              true,
+                              "Disjoint path");
+        NS_TEST_EXPECT_MSG_EQ(entry.Advertise(), 5, "Longest path advertised");
+        entry.RemovePath(b);
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(b, d, 6, Seconds(10), 5),
+                              false,
+                              "Longer than advertised");
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(b, d, 4, Seconds(10), 5),
+                              true,
+                              "Within the advertised hop count");
+        NS_TEST_EXPECT_MSG_EQ(entry.Advertise(), 5, "Advertised hop count fixed");
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(c, b, 2, Seconds(10), 4),
+                              false,
+                              "Older sequence number");
+
+        NS_TEST_EXPECT_MSG_EQ(entry.AddDisjointPath(b, c, 8, Seconds(10), 6),
+                              true,
+                              "Newer sequence number");
+        std::vector<MultipathRouteEntry::PathInfo> paths = entry.GetAllPaths();
+        NS_TEST_ASSERT_MSG_EQ(paths.size(), 1, "Older paths dropped");
+        NS_TEST_EXPECT_MSG_EQ(paths[0].firstHop, c, "First hop kept");
+        NS_TEST_EXPECT_MSG_EQ(entry.Advertise(), 8, "Advertised hop count reset");
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the reranking of multipath paths and preemptive switches
+ */
+struct MultipathRerankTest : public TestCase
+{
+    MultipathRerankTest()
+        : TestCase("MultipathRerank")
+    {
+    }
+
+    /**
+     * Record a reranked destination
+     * @param dst the destination
+     */
+    void Reranked(Ipv4Address dst)
+    {
+        reranked.push_back(dst);
+    }
+
+    void DoRun() override
+    {
+        const Ipv4Address dst("10.0.0.1");
+        const Ipv4Address first("10.0.0.2");
+        const Ipv4Address second("10.0.0.3");
+        for (bool compact : {false, true})
+        {
+            reranked.clear();
+            RoutingTable rtable(Seconds(3));
+            rtable.SetCompact(compact);
+            rtable.SetMultipathRerankCallback(MakeCallback(&MultipathRerankTest::Reranked, this));
+            for (Ipv4Address neighbor : {first, second})
+            {
+                RoutingTableEntry toNeighbor(/*output device*/ nullptr,
+                                             /*dst*/ neighbor,
+                                             /*validSeqNo*/ true,
+                                             /*seqNo*/ 1,
+                                             /*interface*/ Ipv4InterfaceAddress(),
+                                             /*hop*/ 1,
+                                             /*next hop*/ neighbor,
+                                             /*lifetime*/ Seconds(10));
+                rtable.AddRoute(toNeighbor);
+            }
+            RoutingTableEntry toDst(/*output device*/ nullptr,
+                                    /*dst*/ dst,
+                                    /*validSeqNo*/ true,
+                                    /*seqNo*/ 7,
+                                    /*interface*/ Ipv4InterfaceAddress(),
+                                    /*hop*/ 3,
+                                    /*next hop*/ first,
+                                    /*lifetime*/ Seconds(5));
+            rtable.AddRoute(toDst);
+            rtable.AddMultipathRoute(dst, first, 2, Seconds(10), 7);
+            rtable.AddMultipathRoute(dst, second, 3, Seconds(10), 7);
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), 2, "Added paths rerank");
+            NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst).front().nextHop,
+                                  first,
+                                  "Shorter path first");
+
+            // A weak, drained neighbor drops its path below the other one
+            BLEMetrics weak;
+            weak.residualEnergy = 0.1;
+            weak.rssiValue = -100;
+            weak.stabilityScore = 0;
+            rtable.UpdateMultipathLinkMetrics(first, weak);
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), 3, "Link metrics rerank");
+            NS_TEST_EXPECT_MSG_EQ(reranked.back(), dst, "Only the destination through it");
+            NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst).front().nextHop,
+                                  second,
+                                  "Weak path ranked down");
+            NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst)[1].bleMetrics.stabilityScore,
+                                  1.0,
+                                  "Stability of the path kept");
+            rtable.UpdateMultipathLinkMetrics(Ipv4Address("10.0.0.9"), weak);
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), 3, "No path through a stranger");
+
+            NS_TEST_EXPECT_MSG_EQ(rtable.UpdateMultipathStability(dst, second, false),
+                                  true,
+                                  "Stability recorded");
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), 3, "Same leader, no rerank");
+            // The route comes within the switch margin of the best path,
+            // which stays the best path
+            for (int i = 0; i < 200; ++i)
+            {
+                rtable.UpdateMultipathStability(dst, first, true);
+                rtable.UpdateMultipathStability(dst, second, false);
+            }
+            NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst).front().nextHop,
+                                  second,
+                                  "Leader kept");
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), 4, "Stability reranks on the margin");
+            NS_TEST_EXPECT_MSG_EQ(rtable.UpdateMultipathStability(dst, dst, true),
+                                  false,
+                                  "No such path");
+
+            NS_TEST_EXPECT_MSG_EQ(rtable.SwitchMultipathRoute(dst, second), true, "Switched");
+            const RoutingTableEntry* rt = rtable.FindRoute(dst);
+            NS_TEST_ASSERT_MSG_NE(rt, nullptr, "Route kept");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetNextHop(), second, "Route on the new path");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetHop(), 3, "Hop count of the path");
+            NS_TEST_EXPECT_MSG_EQ(rt->GetSeqNo(), 7, "Sequence number kept");
+            NS_TEST_EXPECT_MSG_EQ(rtable.SwitchMultipathRoute(dst, second),
+                                  false,
+                                  "Already on the path");
+            NS_TEST_EXPECT_MSG_EQ(rtable.SwitchMultipathRoute(dst, Ipv4Address("10.0.0.9")),
+                                  false,
+                                  "Not a neighbor");
+
+            // The index forgets removed paths
+            rtable.RemoveMultipathRoute(dst, first);
+            rtable.UpdateMultipathLinkMetrics(first, weak);
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), 4, "Removed path not reranked");
+
+            // A path found under an older sequence number could loop
+            rtable.AddMultipathRoute(dst, first, 2, Seconds(10), 6);
+            NS_TEST_EXPECT_MSG_EQ(rtable.SwitchMultipathRoute(dst, first),
+                                  false,
+                                  "Older path not taken");
+            NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst, first), false, "Older path dropped");
+            NS_TEST_EXPECT_MSG_EQ(rtable.FindRoute(dst)->GetNextHop(), second, "Route unchanged");
+
+            size_t before = reranked.size();
+            rtable.Clear();
+            NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathSize(), 0, "Multipath entries cleared");
+            rtable.UpdateMultipathLinkMetrics(second, weak);
+            NS_TEST_EXPECT_MSG_EQ(reranked.size(), before, "Next hop index cleared");
+        }
+    }
+
+    /// Destinations reported by the routing table
+    std::vector<Ipv4Address> reranked;
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the hysteresis of preemptive route switches
+ */
+struct PreemptiveSwitchTest : public TestCase
+{
+    PreemptiveSwitchTest()
+        : TestCase("PreemptiveSwitch")
+    {
+    }
+
+    void DoRun() override
+    {
+        protocol = CreateObject<RoutingProtocol>();
+        protocol->SetMultipathEnabled(true);
+        protocol->SetAttribute("PreemptiveSwitchMargin", DoubleValue(0.1));
+        protocol->SetAttribute("PreemptiveSwitchDwell", TimeValue(Seconds(1)));
+        RoutingTable& rtable = protocol->GetRoutingTable();
+        for (Ipv4Address neighbor : {first, second, third})
+        {
+            RoutingTableEntry toNeighbor(/*output device*/ nullptr,
+                                         /*dst*/ neighbor,
+                                         /*validSeqNo*/ true,
+                                         /*seqNo*/ 1,
+                                         /*interface*/ Ipv4InterfaceAddress(),
+                                         /*hop*/ 1,
+                                         /*next hop*/ neighbor,
+                                         /*lifetime*/ Seconds(20));
+            rtable.AddRoute(toNeighbor);
+        }
+        RoutingTableEntry toDst(/*output device*/ nullptr,
+                                /*dst*/ dst,
+                                /*validSeqNo*/ true,
+                                /*seqNo*/ 7,
+                                /*interface*/ Ipv4InterfaceAddress(),
+                                /*hop*/ 2,
+                                /*next hop*/ first,
+                                /*lifetime*/ Seconds(20));
+        rtable.AddRoute(toDst);
+        rtable.AddMultipathRoute(dst, first, 2, Seconds(20), 7);
+        rtable.AddMultipathRoute(dst, second, 2, Seconds(20), 7);
+
+        Simulator::Schedule(Seconds(1), &PreemptiveSwitchTest::Weaken, this, first, 0.9);
+        Simulator::Schedule(Seconds(3), &PreemptiveSwitchTest::CheckNextHop, this, first);
+        Simulator::Schedule(Seconds(4), &PreemptiveSwitchTest::Weaken, this, first, 0.2);
+        Simulator::Schedule(Seconds(4.5), &PreemptiveSwitchTest::CheckNextHop, this, first);
+        Simulator::Schedule(Seconds(5.5), &PreemptiveSwitchTest::CheckNextHop, this, second);
+        // A third path leads from 6 s; the route moving to the first path at
+        // 6.5 s, which the third one also leads, restarts that lead when the
+        // dwell check at 7 s reads the route journal
+        Simulator::Schedule(Seconds(5.75), &PreemptiveSwitchTest::AddThird, this);
+        Simulator::Schedule(Seconds(6), &PreemptiveSwitchTest::Weaken, this, second, 0.2);
+        Simulator::Schedule(Seconds(6.5), &PreemptiveSwitchTest::MoveRoute, this, first);
+        Simulator::Schedule(Seconds(7.5), &PreemptiveSwitchTest::CheckNextHop, this, first);
+        Simulator::Schedule(Seconds(8.5), &PreemptiveSwitchTest::CheckNextHop, this, third);
+        Simulator::Run();
+        Simulator::Destroy();
+        protocol->Dispose();
+        protocol = nullptr;
+    }
+
+    /**
+     * Lower the residual energy of a next hop, which lowers the score of its
+     * path by a fifth of the drop
+     * @param nextHop the next hop
+     * @param energy the residual energy
+     */
+    void Weaken(Ipv4Address nextHop, double energy)
+    {
+        BLEMetrics metrics;
+        metrics.residualEnergy = energy;
+        protocol->GetRoutingTable().UpdateMultipathLinkMetrics(nextHop, metrics);
+    }
+
+    /// Add a path through the third next hop, scored as the second one
+    void AddThird()
+    {
+        protocol->GetRoutingTable().AddMultipathRoute(dst, third, 2, Seconds(20), 7);
+    }
+
+    /**
+     * Move the route to dst to another next hop, as a RREP would
+     * @param nextHop the next hop
+     */
+    void MoveRoute(Ipv4Address nextHop)
+    {
+        protocol->GetRoutingTable().ModifyRoute(dst, [nextHop](RoutingTableEntry& rt) {
+            rt.SetNextHop(nextHop);
+            return true;
+        });
+    }
+
+    /**
+     * Check the next hop of the route to dst
+     * @param nextHop the expected next hop
+     */
+    void CheckNextHop(Ipv4Address nextHop)
+    {
+        const RoutingTableEntry* rt = protocol->GetRoutingTable().FindRoute(dst);
+        NS_TEST_ASSERT_MSG_NE(rt, nullptr, "Route kept");
+        NS_TEST_EXPECT_MSG_EQ(rt->GetNextHop(),
+                              nextHop,
+                              "Next hop at " << Simulator::Now().As(Time::S));
+    }
+
+    /// The protocol under test
+    Ptr<RoutingProtocol> protocol;
+    /// Destination of the route
+    Ipv4Address dst{"10.0.0.1"};
+    /// Next hops of the paths
+    Ipv4Address first{"10.0.0.2"};
+    Ipv4Address second{"10.0.0.3"}; //!< Second next hop
+    Ipv4Address third{"10.0.0.4"};  //!< Third next hop
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the delivery ratios of neighbors and multipath paths
+ */
+struct DeliveryRatioTest : public TestCase
+{
+    DeliveryRatioTest()
+        : TestCase("DeliveryRatio")
+    {
+    }
+
+    void DoRun() override
+    {
+        Ipv4Address neighbor("10.0.0.1");
+        Mac48Address mac("00:00:00:00:00:01");
+        Ptr<ArpCache> arp = CreateObject<ArpCache>();
+        arp->Add(neighbor)->MarkAlive(mac);
+        {
+            Neighbors nb(Seconds(1));
+            nb.AddArpCache(arp);
+            nb.SetDeliveryRatioWeight(0.5);
+            NS_TEST_EXPECT_MSG_EQ(nb.UpdateDeliveryRatio(mac, true),
+                                  Ipv4Address(),
+                                  "Not a neighbor yet");
+            nb.Update(neighbor, Seconds(10));
+            NS_TEST_EXPECT_MSG_EQ(nb.GetDeliveryRatio(neighbor), 1.0, "Optimistic start");
+            NS_TEST_EXPECT_MSG_EQ(nb.UpdateDeliveryRatio(mac, false), neighbor, "Attributed");
+            NS_TEST_EXPECT_MSG_EQ(nb.GetDeliveryRatio(neighbor), 0.5, "Failure averaged");
+            nb.UpdateDeliveryRatio(mac, false);
+            nb.UpdateDeliveryRatio(mac, true);
+            NS_TEST_EXPECT_MSG_EQ(nb.GetDeliveryRatio(neighbor), 0.625, "Moving average");
+            NS_TEST_EXPECT_MSG_EQ(nb.UpdateDeliveryRatio(Mac48Address("00:00:00:00:00:02"), false),
+                                  Ipv4Address(),
+                                  "Unknown MAC address");
+            NS_TEST_EXPECT_MSG_EQ(nb.GetDeliveryRatio(Ipv4Address("10.0.0.2")),
+                                  1.0,
+                                  "Not a neighbor");
+
+            // A neighbor lost forgets its MAC address, and the neighbors
+            // after it keep theirs
+            Ipv4Address second("10.0.0.2");
+            Mac48Address secondMac("00:00:00:00:00:02");
+            arp->Add(second)->MarkAlive(secondMac);
+            nb.Update(second, Seconds(10));
+            WifiMacHeader hdr;
+            hdr.SetAddr1(mac);
+            nb.GetTxErrorCallback()(hdr);
+            NS_TEST_EXPECT_MSG_EQ(nb.GetNeighbors().size(), 1, "Neighbor lost");
+            NS_TEST_EXPECT_MSG_EQ(nb.UpdateDeliveryRatio(mac, true),
+                                  Ipv4Address(),
+                                  "MAC address of the lost neighbor");
+            NS_TEST_EXPECT_MSG_EQ(nb.UpdateDeliveryRatio(secondMac, false),
+                                  second,
+                                  "MAC address of the neighbor left");
+            NS_TEST_EXPECT_MSG_EQ(nb.GetDeliveryRatio(second), 0.5, "Its ratio");
+            nb.Clear();
+            NS_TEST_EXPECT_MSG_EQ(nb.UpdateDeliveryRatio(mac, true),
+                                  Ipv4Address(),
+                                  "Neighbor gone");
+        }
+        Simulator::Destroy();
+
+        RoutingTable rtable(Seconds(5));
+        rtable.SetMultipathStabilityWeight(0.5);
+        Ipv4Address dst("10.0.0.9");
+        rtable.AddMultipathRoute(dst, neighbor, 2, Seconds(10), 7);
+        rtable.UpdateMultipathStability(dst, neighbor, false);
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst).front().bleMetrics.stabilityScore,
+                              0.5,
+                              "Path failure averaged");
+        rtable.UpdateMultipathStability(dst, neighbor, true);
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst).front().bleMetrics.stabilityScore,
+                              0.75,
+                              "Path success averaged");
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the non-copying views of multipath paths
+ */
+struct MultipathViewTest : public TestCase
+{
+    MultipathViewTest()
+        : TestCase("MultipathView")
+    {
+    }
+
+    void DoRun() override
+    {
+        RoutingTable rtable(Seconds(5));
+        Ipv4Address dst("10.1.0.1");
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathPaths(dst).empty(), true, "Unknown destination");
+        rtable.AddMultipathRoute(dst, Ipv4Address("10.2.0.1"), 3, Seconds(10), 7);
+        rtable.AddMultipathRoute(dst, Ipv4Address("10.2.0.2"), 1, Seconds(10), 7);
+        rtable.AddMultipathRoute(dst, Ipv4Address("10.2.0.3"), 2, Seconds(10), 7);
+        // Already expired, so never shown
+        rtable.AddMultipathRoute(dst, Ipv4Address("10.2.0.4"), 1, Seconds(0), 7);
+
+        MultipathRouteEntry::PathSpan paths = rtable.GetMultipathPaths(dst);
+        std::vector<MultipathRouteEntry::PathInfo> copies = rtable.GetAllMultipathRoutes(dst);
+        NS_TEST_EXPECT_MSG_EQ(paths.size(), 3, "Expired path hidden");
+        NS_TEST_EXPECT_MSG_EQ(paths.size(), copies.size(), "Same paths as the copy");
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            NS_TEST_EXPECT_MSG_EQ(paths[i].nextHop, copies[i].nextHop, "Same order as the copy");
+        }
+        NS_TEST_EXPECT_MSG_EQ(paths.front().nextHop, Ipv4Address("10.2.0.2"), "Best path first");
+
+        uint32_t visited = 0;
+        uint32_t longest = 0;
+        rtable.ForEachMultipathPath(dst, [&](const MultipathRouteEntry::PathInfo& path) {
+            ++visited;
+            longest = std::max(longest, path.hopCount);
+        });
+        NS_TEST_EXPECT_MSG_EQ(visited, 3, "All paths visited");
+        NS_TEST_EXPECT_MSG_EQ(longest, 3, "Paths inspected");
+        rtable.ForEachMultipathPath(Ipv4Address("10.1.0.2"),
+                                    [&](const MultipathRouteEntry::PathInfo&) { ++visited; });
+        NS_TEST_EXPECT_MSG_EQ(visited, 3, "No path to an unknown destination");
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the expiry of multipath entries
+ */
+struct MultipathExpiryTest : public TestCase
+{
+    MultipathExpiryTest()
+        : TestCase("MultipathExpiry"),
+          rtable(Seconds(5))
+    {
+    }
+
+    void DoRun() override
+    {
+        rtable.AddMultipathRoute(dst1, hop1, 2, Seconds(5), 7);
+        rtable.AddMultipathRoute(dst1, hop2, 3, Seconds(10), 7);
+        rtable.AddMultipathRoute(dst2, hop1, 1, Seconds(3), 7);
+        Simulator::Schedule(Seconds(4), &MultipathExpiryTest::CheckEmptyEntry, this);
+        Simulator::Schedule(Seconds(6), &MultipathExpiryTest::CheckRefreshed, this);
+        Simulator::Schedule(Seconds(11), &MultipathExpiryTest::CheckExpiredPath, this);
+        Simulator::Schedule(Seconds(15), &MultipathExpiryTest::CheckAllExpired, this);
+        Simulator::Run();
+        Simulator::Destroy();
+    }
+
+    /// An entry whose only path expired is removed, then refresh a path of the other
+    void CheckEmptyEntry()
+    {
+        rtable.Purge();
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathSize(), 1, "Empty entry removed");
+        NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathRoute(dst2), false, "No path left");
+        rtable.AddMultipathRoute(dst1, hop1, 2, Seconds(10), 7);
+    }
+
+    /// The event of the refreshed path fires without removing anything
+    void CheckRefreshed()
+    {
+        rtable.Purge();
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathSize(), 1, "Entry kept");
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetAllMultipathRoutes(dst1).size(), 2, "Paths kept");
+    }
+
+    /// The requeued event removes the path that expired
+    void CheckExpiredPath()
+    {
+        rtable.Purge();
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathSize(), 1, "Entry kept");
+        NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst1, hop2), false, "Path expired");
+        NS_TEST_EXPECT_MSG_EQ(rtable.HasMultipathPath(dst1, hop1), true, "Refreshed path kept");
+    }
+
+    /// The last path expires with its entry
+    void CheckAllExpired()
+    {
+        rtable.Purge();
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetMultipathSize(), 0, "All entries removed");
+    }
+
+    /// The routing table under test
+    RoutingTable rtable;
+    /// Destinations of the multipath entries
+    Ipv4Address dst1{"10.1.0.1"};
+    Ipv4Address dst2{"10.1.0.2"}; //!< Second destination
+    /// Next hops of the paths
+    Ipv4Address hop1{"10.2.0.1"};
+    Ipv4Address hop2{"10.2.0.2"}; //!< Second next hop
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the routing table hash map
+ */
+struct AddressMapTest : public TestCase
+{
+    AddressMapTest()
+        : TestCase("AddressMap")
+    {
+    }
+
+    void DoRun() override
+    {
+        AddressMap<uint32_t> table;
+        NS_TEST_EXPECT_MSG_EQ(table.empty(), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ((table.find(Ipv4Address("1.2.3.4")) == table.end()), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(table.erase(Ipv4Address("1.2.3.4")), 0, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(table.insert(std::make_pair(Ipv4Address("1.2.3.4"), 1)).second,
+                              true,
+                              "trivial");
+        NS_TEST_EXPECT_MSG_EQ(table.insert(std::make_pair(Ipv4Address("1.2.3.4"), 2)).second,
+                              false,
+                              "Existing value must be kept");
+        NS_TEST_EXPECT_MSG_EQ(table.find(Ipv4Address("1.2.3.4"))->second, 1, "trivial");
+
+        // Mirror a random sequence of operations on std::map, with keys drawn from two subnets
+        // so that the table grows, probe sequences collide and backward shifts wrap around.
+        std::map<Ipv4Address, uint32_t> reference;
+        reference[Ipv4Address("1.2.3.4")] = 1;
+        uint32_t state = 12345;
+        for (uint32_t i = 0; i < 20000; ++i)
+        {
+            state = state * 1103515245 + 12345;
+            uint32_t host = (state >> 8) % 600;
+            Ipv4Address key(((state >> 4) & 1 ? 0x0a000000 : 0xc0a80000) + host);
+            if ((state >> 24) % 3 == 0)
+            {
+                NS_TEST_EXPECT_MSG_EQ(table.erase(key), reference.erase(key), "erase mismatch");
+            }
+            else
+            {
+                NS_TEST_EXPECT_MSG_EQ(table.insert(std::make_pair(key, i)).second,
+                                      reference.insert(std::make_pair(key, i)).second,
+                                      "insert mismatch");
+            }
+        }
+        NS_TEST_EXPECT_MSG_EQ(table.size(), reference.size(), "size mismatch");
+        for (const auto& i : reference)
+        {
+            auto j = table.find(i.first);
+            NS_TEST_ASSERT_MSG_EQ((j != table.end()), true, "key lost");
+            NS_TEST_EXPECT_MSG_EQ(j->second, i.second, "value mismatch");
+        }
+
+        // Erase while iterating visits every entry once
+        uint32_t visited = 0;
+        uint32_t before = table.size();
+        for (auto i = table.begin(); i != table.end();)
+        {
+            ++visited;
+            if (i->second % 2 == 0)
+            {
+                reference.erase(i->first);
+                i = table.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        NS_TEST_EXPECT_MSG_EQ(visited, before, "entry skipped or visited twice");
+        NS_TEST_EXPECT_MSG_EQ(table.size(), reference.size(), "size mismatch");
+        for (const auto& i : table)
+        {
+            NS_TEST_EXPECT_MSG_EQ(i.second % 2, 1, "even value survived");
+            NS_TEST_EXPECT_MSG_EQ(reference.count(i.first), 1, "unexpected key");
+        }
+        table.clear();
+        NS_TEST_EXPECT_MSG_EQ(table.size(), 0, "trivial");
+        NS_TEST_EXPECT_MSG_EQ((table.find(Ipv4Address("1.2.3.4")) == table.end()), true, "trivial");
+    }
+};
+
+/**
+ * @ingroup aodv-test
+ *
+ * @brief Unit test for the batch scoring of the multipath paths
+ */
+struct PathScoreBatchTest : public TestCase
+{
+    PathScoreBatchTest()
+        : TestCase("PathScoreBatch")
+    {
+    }
+
+    void DoRun() override
+    {
+        // The kernel matches the scalar code on every row, the tail included,
+        // and clamps the RSSI like it
+        WeightFactors weights;
+        weights.hopWeight = 0.3;
+        weights.energyWeight = 0.1;
+        weights.rssiWeight = 0.35;
+        weights.stabilityWeight = 0.25;
+        PathScoreBatch batch;
+        for (uint32_t i = 0; i < 11; ++i)
+        {
+            NS_TEST_EXPECT_MSG_EQ(batch.Allocate(), i, "Rows in order");
+            batch.Set(i, i % 5, 0.1 * i, -120.0 + 9.0 * i, 1.0 - 0.05 * i);
+        }
+        batch.Score(weights);
+        for (uint32_t i = 0; i < 11; ++i)
+        {
+            double expected =
+                PathScoreBatch::ScoreOne(weights, i % 5, 0.1 * i, -120.0 + 9.0 * i, 1.0 - 0.05 * i);
+            NS_TEST_EXPECT_MSG_EQ_TOL(batch.GetScore(i), expected, 1e-12, "Kernel and scalar agree");
+            NS_TEST_EXPECT_MSG_EQ_TOL(batch.ScoreRow(i, weights), expected, 1e-12, "Scalar row");
+        }
+        NS_TEST_EXPECT_MSG_EQ_TOL(PathScoreBatch::ScoreOne(weights, 0, 0, -20, 0),
+                                  0.65,
+                                  1e-12,
+                                  "RSSI clamped above");
+        NS_TEST_EXPECT_MSG_EQ_TOL(PathScoreBatch::ScoreOne(weights, 0, 0, -130, 0),
+                                  0.3,
+                                  1e-12,
+                                  "RSSI clamped below");
+        batch.Release(4);
+        NS_TEST_EXPECT_MSG_EQ(batch.GetUsed(), 10, "Row released");
+        NS_TEST_EXPECT_MSG_EQ(batch.Allocate(), 4, "Released row reused");
+        NS_TEST_EXPECT_MSG_EQ(batch.GetSize(), 11, "No row added");
+
+        // The routing table keeps the rows of its paths and scores them in
+        // one pass when the weights change
+        const Ipv4Address dst1("10.1.0.1");
+        const Ipv4Address dst2("10.1.0.2");
+        const Ipv4Address hop1("10.2.0.1");
+        const Ipv4Address hop2("10.2.0.2");
+        const Ipv4Address hop3("10.2.0.3");
+        RoutingTable rtable(Seconds(3));
+        rtable.AddMultipathRoute(dst1, hop1, 2, Seconds(10), 7);
+        rtable.AddMultipathRoute(dst1, hop2, 4, Seconds(10), 7);
+        rtable.AddMultipathRoute(dst1, hop3, 3, Seconds(10), 7);
+        rtable.AddMultipathRoute(dst2, hop2, 1, Seconds(10), 3);
+        rtable.AddMultipathRoute(dst2, hop3, 5, Seconds(10), 3);
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetPathMetrics().GetUsed(), 5, "One row per path");
+        BLEMetrics link;
+        link.residualEnergy = 0.4;
+        link.rssiValue = -75;
+        rtable.UpdateMultipathLinkMetrics(hop3, link);
+        for (int i = 0; i < 3; ++i)
+        {
+            rtable.UpdateMultipathStability(dst1, hop2, false);
+        }
+        rtable.SetMultipathWeights(weights);
+        for (Ipv4Address dst : {dst1, dst2})
+        {
+            MultipathRouteEntry::PathSpan paths = rtable.GetMultipathPaths(dst);
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                NS_TEST_EXPECT_MSG_EQ_TOL(paths[i].compositeScore,
+                                          paths[i].CalculateCompositeScore(weights),
+                                          1e-12,
+                                          "Batch score of the path");
+                if (i > 0)
+                {
+                    NS_TEST_EXPECT_MSG_GT_OR_EQ(paths[i - 1].compositeScore,
+                                                paths[i].compositeScore,
+                                                "Best path first");
+                }
+            }
+        }
+
+        // A transmission outcome rescores its path alone, with the scalar code
+        rtable.UpdateMultipathStability(dst2, hop3, false);
+        for (const auto& path : rtable.GetMultipathPaths(dst2))
+        {
+            NS_TEST_EXPECT_MSG_EQ_TOL(path.compositeScore,
+                                      path.CalculateCompositeScore(weights),
+                                      1e-12,
+                                      "Scalar score of the path");
+        }
+
+        // Removed, expired and dropped paths give their rows back
+        rtable.RemoveMultipathRoute(dst1, hop2);
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetPathMetrics().GetUsed(), 4, "Removed path");
+        rtable.RemoveMultipathRoute(dst2, hop2);
+        rtable.RemoveMultipathRoute(dst2, hop3);
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetPathMetrics().GetUsed(), 2, "Removed entry");
+        rtable.AddMultipathRoute(dst2, hop1, 2, Seconds(10), 4);
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetPathMetrics().GetUsed(), 3, "Row reused");
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetPathMetrics().GetSize(), 5, "Row reused");
+        rtable.Clear();
+        NS_TEST_EXPECT_MSG_EQ(rtable.GetPathMetrics().GetUsed(), 0, "Cleared");
+    }
+};
+
 /**
  * @ingroup aodv-test
  *
@@ -740,6 +2985,31 @@ class AodvTestSuite : public TestSuite
         AddTestCase(new AodvRqueueTest, TestCase::Duration::QUICK);
         AddTestCase(new AodvRtableEntryTest, TestCase::Duration::QUICK);
         AddTestCase(new AodvRtableTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableExpiryTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableInPlaceTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableNextHopTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableInvalidateTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableTouchTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableAllocationTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableCompactTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableGetRoutesTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtablePrintTest, TestCase::Duration::QUICK);
+        AddTestCase(new AodvRtableJournalTest, TestCase::Duration::QUICK);
+        AddTestCase(new MultipathRouteEntryTest, TestCase::Duration::QUICK);
+        AddTestCase(new MultipathSelectionTest, TestCase::Duration::QUICK);
+        AddTestCase(new FlowTableTest, TestCase::Duration::QUICK);
+        AddTestCase(new MultipathFailoverTest, TestCase::Duration::QUICK);
+        AddTestCase(new DisjointPathTest, TestCase::Duration::QUICK);
+        AddTestCase(new BlacklistTest, TestCase::Duration::QUICK);
+        AddTestCase(new PrecursorSetTest, TestCase::Duration::QUICK);
+        AddTestCase(new AddressIndexTest, TestCase::Duration::QUICK);
+        AddTestCase(new MultipathRerankTest, TestCase::Duration::QUICK);
+        AddTestCase(new PreemptiveSwitchTest, TestCase::Duration::QUICK);
+        AddTestCase(new DeliveryRatioTest, TestCase::Duration::QUICK);
+        AddTestCase(new MultipathViewTest, TestCase::Duration::QUICK);
+        AddTestCase(new MultipathExpiryTest, TestCase::Duration::QUICK);
+        AddTestCase(new AddressMapTest, TestCase::Duration::QUICK);
+        AddTestCase(new PathScoreBatchTest, TestCase::Duration::QUICK);
     }
 } g_aodvTestSuite; ///< the test suite
 
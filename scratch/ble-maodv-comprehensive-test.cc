@@ -892,7 +892,9 @@ void ScheduleBLEMAODVDemonstrations(MultipathRouteEntry& route, WeightFactors in
 
 // ==================== BLE-MAODV SIMULATION ENGINE ====================
 void RunBLEMAODVSimulation(uint32_t nodeCount, double simulationTime, 
-                          const std::string& scenario, ResearchMetricsCollector& metrics) {
+                          const std::string& scenario, ResearchMetricsCollector& metrics,
+                          const std::string& saveState = "", double saveTime = 0,
+                          const std::string& restoreState = "", bool preseed = false) {
     
     std::cout << "\n=== RUNNING BLE-MAODV SIMULATION ===" << std::endl;
     std::cout << "Scenario: " << scenario << std::endl;
@@ -928,6 +930,21 @@ void RunBLEMAODVSimulation(uint32_t nodeCount, double simulationTime,
     address.SetBase("10.1.1.0", "255.255.255.0");
     Ipv4InterfaceContainer interfaces = address.Assign(devices);
     
+    // Warm start: save the converged AODV state once, restore it in later runs
+    if (!saveState.empty()) {
+        AodvHelper::SaveRoutingStateAt(Seconds(saveTime), nodes, saveState);
+    }
+    if (!restoreState.empty()) {
+        std::cout << "Restored AODV state of "
+                  << AodvHelper::RestoreRoutingState(nodes, restoreState) << " nodes" << std::endl;
+    }
+    
+    // Static grids: install the shortest paths up front instead of discovering them
+    if (preseed) {
+        std::cout << "Seeded " << AodvHelper::SeedRoutes(nodes, maxRange, Seconds(simulationTime))
+                  << " routes" << std::endl;
+    }
+    
     // Initialize BLE-MAODV components
     NetworkContext networkContext;
     AdaptiveWeightCalculator weightCalculator;
@@ -1026,12 +1043,20 @@ int main(int argc, char *argv[])
     double simulationTime = 60.0;  // KURANGI WAKTU SIMULASI
     std::string scenario = "balanced";
     bool runComparativeAnalysis = true;
+    std::string saveState;
+    double saveTime = 10.0;
+    std::string restoreState;
+    bool preseed = false;
 
     CommandLine cmd;
     cmd.AddValue("nodes", "Number of nodes", nodeCount);
     cmd.AddValue("time", "Simulation time (seconds)", simulationTime);
     cmd.AddValue("scenario", "Test scenario (balanced, high-mobility, high-density, energy-critical)", scenario);
     cmd.AddValue("compare", "Run comparative analysis", runComparativeAnalysis);
+    cmd.AddValue("saveState", "Save the AODV state to this file", saveState);
+    cmd.AddValue("saveTime", "Time to save the AODV state at (seconds)", saveTime);
+    cmd.AddValue("restoreState", "Restore the AODV state from this file", restoreState);
+    cmd.AddValue("preseed", "Install shortest path routes before the start (static scenarios)", preseed);
     cmd.Parse(argc, argv);
     
     std::cout << "=== BLE-MAODV COMPLETE RESEARCH IMPLEMENTATION ===" << std::endl;
@@ -1047,7 +1072,8 @@ int main(int argc, char *argv[])
         
         // Test BLE-MAODV
         ResearchMetricsCollector bleMetrics;
-        RunBLEMAODVSimulation(nodeCount, simulationTime, scenario, bleMetrics);
+        RunBLEMAODVSimulation(nodeCount, simulationTime, scenario, bleMetrics,
+                              saveState, saveTime, restoreState, preseed);
         bleMetrics.PrintProtocolMetrics("BLE-MAODV");
         bleMetrics.ExportToCSV("BLE-MAODV", scenario);
         comparativeAnalysis.AddProtocolResult("BLE-MAODV", scenario, bleMetrics);
@@ -1080,7 +1106,8 @@ int main(int argc, char *argv[])
     } else {
         // Run single BLE-MAODV simulation
         ResearchMetricsCollector metrics;
-        RunBLEMAODVSimulation(nodeCount, simulationTime, scenario, metrics);
+        RunBLEMAODVSimulation(nodeCount, simulationTime, scenario, metrics,
+                              saveState, saveTime, restoreState, preseed);
         metrics.PrintProtocolMetrics("BLE-MAODV");
         metrics.ExportToCSV("BLE-MAODV", scenario);
     }